@@ -24,67 +24,135 @@
 #include <ArduinoJson.h>
 #include <HTTPClient.h>
 #include <WiFi.h>
+#include "config.h"
 
 #define OWM_NUM_MINUTELY       1 // 61
-#define OWM_NUM_HOURLY        48 // 48
-#define OWM_NUM_DAILY          8 // 8
+#define OWM_NUM_HOURLY        24 // 48, only HOURLY_GRAPH_MAX are drawn
+#define OWM_NUM_DAILY          5 // 8, today + 4 day forecast
 #define OWM_NUM_ALERTS         8 // OpenWeatherMaps does not specify a limit, but if you need more alerts you are probably doomed.
 #define OWM_NUM_AIR_POLLUTION 24 // Depending on AQI scale, hourly concentrations will need to be averaged over a period of 1h to 24h
+#define OWM_NUM_AQI_POLLUTANTS 7 // Most pollutants used by any AQI scale (India)
 
+#define OWM_ALERT_EVENT_LEN   64 // bytes kept of an alert event name (incl. '\0'), about two 12pt lines of the alert area
+#define OWM_ALERT_TAGS_LEN    32 // bytes kept of an alert's first tag (incl. '\0'), used only to dedup alerts
+
+/*
+ * Weather icon id without its day/night suffix. Values match the number in the
+ * icon id, i.e. "10d" and "10n" are both OWM_ICON_RAIN.
+ */
+typedef enum owm_icon : uint8_t
+{
+  OWM_ICON_UNKNOWN          =  0,
+  OWM_ICON_CLEAR_SKY        =  1,
+  OWM_ICON_FEW_CLOUDS       =  2,
+  OWM_ICON_SCATTERED_CLOUDS =  3,
+  OWM_ICON_BROKEN_CLOUDS    =  4,
+  OWM_ICON_SHOWER_RAIN      =  9,
+  OWM_ICON_RAIN             = 10,
+  OWM_ICON_THUNDERSTORM     = 11,
+  OWM_ICON_SNOW             = 13,
+  OWM_ICON_MIST             = 50,
+} owm_icon_t;
+
+/*
+ * Compact weather condition. The group ("main") is implied by the id, and the
+ * description is not drawn, so it is not stored.
+ */
 typedef struct owm_weather
 {
-  int     id;               // Weather condition id
-  String  main;             // Group of weather parameters (Rain, Snow, Extreme etc.)
-  String  description;      // Weather condition within the group (full list of weather conditions). Get the output in your language
-  String  icon;             // Weather icon id.
+  int16_t     id;           // Weather condition id
+  owm_icon_t  icon;         // Weather icon id.
+  uint8_t     day;          // 1 if the icon id ends in 'd' (sun is up)
 } owm_weather_t;
 
 /*
- * Units – default: kelvin, metric: Celsius, imperial: Fahrenheit.
+ * Field manifests
+ *
+ * Only the fields listed here are requested from the API, parsed and stored.
+ * The structs below, the ArduinoJson filter and both parsers in
+ * api_response.cpp are generated from these lists, so anything that is not
+ * listed costs neither parse time nor RAM, and drawing code that reads a field
+ * that is not listed fails to compile. To use another OneCall field, add it to
+ * the manifest of its section.
+ *
+ *   X(type, member, json key)  a value, or an owm_weather_t/owm_temp_t object
+ *   X1H(member, json key)      the "1h" member of a "rain" or "snow" object
  */
-typedef struct owm_temp
-{
-  float   morn;             // Morning temperature.
-  float   day;              // Day temperature.
-  float   eve;              // Evening temperature.
-  float   night;            // Night temperature.
-  float   min;              // Min daily temperature.
-  float   max;              // Max daily temperature.
-} owm_temp_t;
 
 /*
- * This accounts for the human perception of weather. Units – default: kelvin, metric: Celsius, imperial: Fahrenheit.
+ * Units – default: kelvin, metric: Celsius, imperial: Fahrenheit.
  */
-typedef struct owm_feels_like
-{
-  float   morn;             // Morning temperature.
-  float   day;              // Day temperature.
-  float   eve;              // Evening temperature.
-  float   night;            // Night temperature.
-} owm_owm_feels_like_t;
+#define OWM_TEMP_FIELDS(X)                                                     \
+  X(float,   min,        "min")        /* Min daily temperature. */            \
+  X(float,   max,        "max")        /* Max daily temperature. */
 
 /*
  * Current weather data API response
  */
+#define OWM_CURRENT_FIELDS(X, X1H)                                             \
+  X(int64_t, dt,         "dt")         /* Current time, Unix, UTC */           \
+  X(int64_t, sunrise,    "sunrise")    /* Sunrise time, Unix, UTC */           \
+  X(int64_t, sunset,     "sunset")     /* Sunset time, Unix, UTC */            \
+  X(float,   temp,       "temp")       /* Temperature. */                      \
+  X(float,   feels_like, "feels_like") /* Human perceived temperature. */      \
+  X(int,     pressure,   "pressure")   /* Sea level pressure, hPa */           \
+  X(int,     humidity,   "humidity")   /* Humidity, % */                       \
+  X(int,     clouds,     "clouds")     /* Cloudiness, % */                     \
+  X(float,   uvi,        "uvi")        /* Current UV index */                  \
+  X(int,     visibility, "visibility") /* Average visibility, metres */        \
+  X(float,   wind_speed, "wind_speed") /* Wind speed. */                       \
+  X(float,   wind_gust,  "wind_gust")  /* (where available) Wind gust. */      \
+  X(int,     wind_deg,   "wind_deg")   /* Wind direction, degrees */           \
+  X(owm_weather_t, weather, "weather")
+
+/*
+ * Hourly forecast weather data API response
+ *
+ * Hourly icons additionally need the fields used to pick the icon.
+ */
+#if DISPLAY_HOURLY_ICONS
+#define OWM_HOURLY_ICON_FIELDS(X)                                              \
+  X(int,     clouds,     "clouds")     /* Cloudiness, % */                     \
+  X(float,   wind_speed, "wind_speed") /* Wind speed. */                       \
+  X(float,   wind_gust,  "wind_gust")  /* (where available) Wind gust. */      \
+  X(owm_weather_t, weather, "weather")
+#else
+#define OWM_HOURLY_ICON_FIELDS(X)
+#endif
+#define OWM_HOURLY_FIELDS(X, X1H)                                              \
+  X(int64_t, dt,         "dt")         /* Time of the forecast, Unix, UTC */   \
+  X(float,   temp,       "temp")       /* Temperature. */                      \
+  X(float,   pop,        "pop")        /* Probability of precipitation, 0-1 */ \
+  X1H(       rain_1h,    "rain")       /* (where available) Rain, mm */        \
+  X1H(       snow_1h,    "snow")       /* (where available) Snow, mm */        \
+  OWM_HOURLY_ICON_FIELDS(X)
+
+/*
+ * Daily forecast weather data API response
+ */
+#define OWM_DAILY_FIELDS(X, X1H)                                               \
+  X(int64_t, moonrise,   "moonrise")   /* Moonrise time, Unix, UTC */          \
+  X(int64_t, moonset,    "moonset")    /* Moonset time, Unix, UTC */           \
+  X(float,   moon_phase, "moon_phase") /* 0 and 1 new moon, 0.5 full moon */   \
+  X(owm_temp_t, temp,    "temp")                                               \
+  X(int,     clouds,     "clouds")     /* Cloudiness, % */                     \
+  X(float,   wind_speed, "wind_speed") /* Wind speed. */                       \
+  X(float,   wind_gust,  "wind_gust")  /* (where available) Wind gust. */      \
+  X(float,   rain,       "rain")       /* (where available) Rain, mm */        \
+  X(float,   snow,       "snow")       /* (where available) Snow, mm */        \
+  X(owm_weather_t, weather, "weather")
+
+#define OWM_DECLARE_FIELD(type, member, key) type member;
+#define OWM_DECLARE_1H_FIELD(member, key)    float member;
+
+typedef struct owm_temp
+{
+  OWM_TEMP_FIELDS(OWM_DECLARE_FIELD)
+} owm_temp_t;
+
 typedef struct owm_current
 {
-  int64_t dt;               // Current time, Unix, UTC
-  int64_t sunrise;          // Sunrise time, Unix, UTC
-  int64_t sunset;           // Sunset time, Unix, UTC
-  float   temp;             // Temperature. Units - default: kelvin, metric: Celsius, imperial: Fahrenheit.
-  float   feels_like;       // Temperature. This temperature parameter accounts for the human perception of weather. Units – default: kelvin, metric: Celsius, imperial: Fahrenheit.
-  int     pressure;         // Atmospheric pressure on the sea level, hPa
-  int     humidity;         // Humidity, %
-  float   dew_point;        // Atmospheric temperature (varying according to pressure and humidity) below which water droplets begin to condense and dew can form. Units – default: kelvin, metric: Celsius, imperial: Fahrenheit.
-  int     clouds;           // Cloudiness, %
-  float   uvi;              // Current UV index
-  int     visibility;       // Average visibility, metres. The maximum value of the visibility is 10km
-  float   wind_speed;       // Wind speed. Wind speed. Units – default: metre/sec, metric: metre/sec, imperial: miles/hour.
-  float   wind_gust;        // (where available) Wind gust. Units – default: metre/sec, metric: metre/sec, imperial: miles/hour.
-  int     wind_deg;         // Wind direction, degrees (meteorological)
-  float   rain_1h;          // (where available) Rain volume for last hour, mm
-  float   snow_1h;          // (where available) Snow volume for last hour, mm
-  owm_weather_t         weather;
+  OWM_CURRENT_FIELDS(OWM_DECLARE_FIELD, OWM_DECLARE_1H_FIELD)
 } owm_current_t;
 
 /*
@@ -96,55 +164,14 @@ typedef struct owm_minutely
   float   precipitation;    // Precipitation volume, mm
 } owm_minutely_t;
 
-/*
- * Hourly forecast weather data API response
- */
 typedef struct owm_hourly
 {
-  int64_t dt;               // Time of the forecasted data, unix, UTC
-  float   temp;             // Temperature. Units - default: kelvin, metric: Celsius, imperial: Fahrenheit.
-  float   feels_like;       // Temperature. This temperature parameter accounts for the human perception of weather. Units – default: kelvin, metric: Celsius, imperial: Fahrenheit.
-  int     pressure;         // Atmospheric pressure on the sea level, hPa
-  int     humidity;         // Humidity, %
-  float   dew_point;        // Atmospheric temperature (varying according to pressure and humidity) below which water droplets begin to condense and dew can form. Units – default: kelvin, metric: Celsius, imperial: Fahrenheit.
-  int     clouds;           // Cloudiness, %
-  float   uvi;              // Current UV index
-  int     visibility;       // Average visibility, metres. The maximum value of the visibility is 10km
-  float   wind_speed;       // Wind speed. Wind speed. Units – default: metre/sec, metric: metre/sec, imperial: miles/hour.
-  float   wind_gust;        // (where available) Wind gust. Units – default: metre/sec, metric: metre/sec, imperial: miles/hour.
-  int     wind_deg;         // Wind direction, degrees (meteorological)
-  float   pop;              // Probability of precipitation. The values of the parameter vary between 0 and 1, where 0 is equal to 0%, 1 is equal to 100%
-  float   rain_1h;          // (where available) Rain volume for last hour, mm
-  float   snow_1h;          // (where available) Snow volume for last hour, mm
-  owm_weather_t         weather;
+  OWM_HOURLY_FIELDS(OWM_DECLARE_FIELD, OWM_DECLARE_1H_FIELD)
 } owm_hourly_t;
 
-/*
- * Daily forecast weather data API response
- */
 typedef struct owm_daily
 {
-  int64_t dt;               // Time of the forecasted data, unix, UTC
-  int64_t sunrise;          // Sunrise time, Unix, UTC
-  int64_t sunset;           // Sunset time, Unix, UTC
-  int64_t moonrise;         // The time of when the moon rises for this day, Unix, UTC
-  int64_t moonset;          // The time of when the moon sets for this day, Unix, UTC
-  float   moon_phase;       // Moon phase. 0 and 1 are 'new moon', 0.25 is 'first quarter moon', 0.5 is 'full moon' and 0.75 is 'last quarter moon'. The periods in between are called 'waxing crescent', 'waxing gibous', 'waning gibous', and 'waning crescent', respectively.
-  owm_temp_t            temp;
-  owm_owm_feels_like_t  feels_like;
-  int     pressure;         // Atmospheric pressure on the sea level, hPa
-  int     humidity;         // Humidity, %
-  float   dew_point;        // Atmospheric temperature (varying according to pressure and humidity) below which water droplets begin to condense and dew can form. Units – default: kelvin, metric: Celsius, imperial: Fahrenheit.
-  int     clouds;           // Cloudiness, %
-  float   uvi;              // Current UV index
-  int     visibility;       // Average visibility, metres. The maximum value of the visibility is 10km
-  float   wind_speed;       // Wind speed. Wind speed. Units – default: metre/sec, metric: metre/sec, imperial: miles/hour.
-  float   wind_gust;        // (where available) Wind gust. Units – default: metre/sec, metric: metre/sec, imperial: miles/hour.
-  int     wind_deg;         // Wind direction, degrees (meteorological)
-  float   pop;              // Probability of precipitation. The values of the parameter vary between 0 and 1, where 0 is equal to 0%, 1 is equal to 100%
-  float   rain;             // (where available) Precipitation volume, mm
-  float   snow;             // (where available) Snow volume, mm
-  owm_weather_t         weather;
+  OWM_DAILY_FIELDS(OWM_DECLARE_FIELD, OWM_DECLARE_1H_FIELD)
 } owm_daily_t;
 
 /*
@@ -152,14 +179,26 @@ typedef struct owm_daily
  */
 typedef struct owm_alerts
 {
-  String  sender_name;      // Name of the alert source.
-  String  event;            // Alert event name
+  // sender_name and description are not drawn, so they are not stored
+  char    event[OWM_ALERT_EVENT_LEN]; // Alert event name
   int64_t start;            // Date and time of the start of the alert, Unix, UTC
   int64_t end;              // Date and time of the end of the alert, Unix, UTC
-  String  description;      // Description of the alert
-  String  tags;             // Type of severe weather
+  char    tags[OWM_ALERT_TAGS_LEN];   // Type of severe weather (first tag only)
 } owm_alerts_t;
 
+/*
+ * Alerts of one response, stored inline so that parsing, filtering and drawing
+ * them never allocates.
+ */
+typedef struct owm_alert_list
+{
+  owm_alerts_t alert[OWM_NUM_ALERTS];
+  uint8_t  count;           // Number of alerts stored
+  uint8_t  dropped;         // Alerts beyond OWM_NUM_ALERTS (those read before an early stop)
+  uint8_t  truncatedEvents; // Event names cut to OWM_ALERT_EVENT_LEN - 1
+  uint8_t  truncatedTags;   // Tags cut to OWM_ALERT_TAGS_LEN - 1
+} owm_alert_list_t;
+
 /*
  * Response from OpenWeatherMap's OneCall API
  *
@@ -167,16 +206,12 @@ typedef struct owm_alerts
  */
 typedef struct owm_resp_onecall
 {
-  float   lat;              // Geographical coordinates of the location (latitude)
-  float   lon;              // Geographical coordinates of the location (longitude)
-  String  timezone;         // Timezone name for the requested location
-  int     timezone_offset;  // Shift in seconds from UTC
   owm_current_t   current;
   // owm_minutely_t  minutely[OWM_NUM_MINUTELY];
 
   owm_hourly_t    hourly[OWM_NUM_HOURLY];
   owm_daily_t     daily[OWM_NUM_DAILY];
-  std::vector<owm_alerts_t> alerts;
+  owm_alert_list_t alerts;
 } owm_resp_onecall_t;
 
 /*
@@ -188,33 +223,83 @@ typedef struct owm_coord
   float   lon;
 } owm_coord_t;
 
-typedef struct owm_components
+/*
+ * Pollutants reported by the Air Pollution API.
+ */
+typedef enum owm_pollutant : uint8_t
+{
+  OWM_CO,                   // Сoncentration of CO (Carbon monoxide), μg/m^3
+  OWM_NH3,                  // Сoncentration of NH3 (Ammonia), μg/m^3
+  OWM_NO,                   // Сoncentration of NO (Nitrogen monoxide), μg/m^3
+  OWM_NO2,                  // Сoncentration of NO2 (Nitrogen dioxide), μg/m^3
+  OWM_O3,                   // Сoncentration of O3 (Ozone), μg/m^3
+  OWM_SO2,                  // Сoncentration of SO2 (Sulphur dioxide), μg/m^3
+  OWM_PM10,                 // Сoncentration of PM10 (Coarse particulate matter), μg/m^3
+  OWM_PM2_5,                // Сoncentration of PM2.5 (Fine particles matter), μg/m^3
+  OWM_NUM_POLLUTANTS
+} owm_pollutant_t;
+
+/*
+ * Averaging periods used by the AQI scales.
+ */
+typedef enum owm_aqi_window : uint8_t
+{
+  OWM_AQI_1H,
+  OWM_AQI_3H,
+  OWM_AQI_4H,
+  OWM_AQI_8H,
+  OWM_AQI_24H,
+  OWM_NUM_AQI_WINDOWS
+} owm_aqi_window_t;
+extern const int OWM_AQI_WINDOW_HOURS[OWM_NUM_AQI_WINDOWS]; // {1, 3, 4, 8, 24}
+
+/*
+ * Running concentrations of one pollutant. Each hourly sample is added to the
+ * window sums as it is parsed, and the sample that falls out of each window is
+ * taken back out, so only the last OWM_NUM_AIR_POLLUTION samples are kept no
+ * matter how long a history is parsed.
+ */
+typedef struct owm_conc_window
 {
-  float   co[OWM_NUM_AIR_POLLUTION];    // Сoncentration of CO (Carbon monoxide), μg/m^3
-  float   no[OWM_NUM_AIR_POLLUTION];    // Сoncentration of NO (Nitrogen monoxide), μg/m^3
-  float   no2[OWM_NUM_AIR_POLLUTION];   // Сoncentration of NO2 (Nitrogen dioxide), μg/m^3
-  float   o3[OWM_NUM_AIR_POLLUTION];    // Сoncentration of O3 (Ozone), μg/m^3
-  float   so2[OWM_NUM_AIR_POLLUTION];   // Сoncentration of SO2 (Sulphur dioxide), μg/m^3
-  float   pm2_5[OWM_NUM_AIR_POLLUTION]; // Сoncentration of PM2.5 (Fine particles matter), μg/m^3
-  float   pm10[OWM_NUM_AIR_POLLUTION];  // Сoncentration of PM10 (Coarse particulate matter), μg/m^3
-  float   nh3[OWM_NUM_AIR_POLLUTION];   // Сoncentration of NH3 (Ammonia), μg/m^3
-} owm_components_t;
+  float   ring[OWM_NUM_AIR_POLLUTION];  // Most recent hourly samples, μg/m^3
+  float   sum[OWM_NUM_AQI_WINDOWS];     // Sum of the samples in each window
+} owm_conc_window_t;
 
 /*
  * Response from OpenWeatherMap's Air Pollution API
+ *
+ * Only the pollutants that AQI_SCALE needs are tracked, see getAvgConc().
  */
 typedef struct owm_resp_air_pollution
 {
-  owm_coord_t      coord;
-  int              main_aqi[OWM_NUM_AIR_POLLUTION];   // Air Quality Index. Possible values: 1, 2, 3, 4, 5. Where 1 = Good, 2 = Fair, 3 = Moderate, 4 = Poor, 5 = Very Poor.
-  owm_components_t components;
-  int64_t          dt[OWM_NUM_AIR_POLLUTION];         // Date and time, Unix, UTC;
+  owm_coord_t       coord;
+  int               main_aqi;   // Most recent Air Quality Index. Possible values: 1, 2, 3, 4, 5. Where 1 = Good, 2 = Fair, 3 = Moderate, 4 = Poor, 5 = Very Poor.
+  int64_t           dt;         // Most recent sample date and time, Unix, UTC;
+  int               samples;    // Number of hourly samples parsed
+  int8_t            slot[OWM_NUM_POLLUTANTS]; // Index into conc, -1 if the pollutant is not tracked
+  owm_conc_window_t conc[OWM_NUM_AQI_POLLUTANTS];
 } owm_resp_air_pollution_t;
 
-DeserializationError deserializeOneCall(WiFiClient &json,
+/*
+ * How much of a response a streaming parser consumed.
+ */
+typedef struct owm_parse_stats
+{
+  size_t  bytesRead;        // Bytes pulled off the connection
+  size_t  bytesSkipped;     // Bytes of values that were read but not stored
+  bool    terminatedEarly;  // Stopped once everything drawn had been read
+} owm_parse_stats_t;
+
+DeserializationError deserializeOneCall(Stream &json,
                                         owm_resp_onecall_t &r);
-DeserializationError deserializeAirQuality(WiFiClient &json,
+DeserializationError deserializeOneCallStream(Stream &json,
+                                              owm_resp_onecall_t &r,
+                                              owm_parse_stats_t *stats = nullptr);
+DeserializationError deserializeAirQuality(Stream &json,
                                            owm_resp_air_pollution_t &r);
+DeserializationError deserializeAirQualityStream(Stream &json,
+                                           owm_resp_air_pollution_t &r,
+                                           owm_parse_stats_t *stats = nullptr);
 
 
 #endif
@@ -21,23 +21,36 @@
 #include <Arduino.h>
 #include "api_response.h"
 #include "config.h"
+#include "http_connection.h"
 #ifdef USE_HTTP
   #include <WiFiClient.h>
 #else
   #include <WiFiClientSecure.h>
 #endif
 
+/*
+ * How the last startWiFi() connected and how long each stage took, measured
+ * from the start of the connection attempt that succeeded.
+ */
+typedef struct wifi_connect_stats
+{
+  bool     fastConnect;     // Joined the cached access point without a scan
+  bool     cachedIP;        // Reused the cached DHCP lease
+  bool     fastFailed;      // Fast connect failed and a full scan followed
+  uint32_t assocMs;         // Until associated with the access point
+  uint32_t ipMs;            // Until an IP address was assigned
+  uint32_t dnsMs;           // Until a DNS server was known
+  uint32_t totalMs;         // Whole startWiFi(), including failed attempts
+} wifi_connect_stats_t;
+
 wl_status_t startWiFi(int &wifiRSSI);
 void killWiFi();
+void forgetWiFiCache();
+const wifi_connect_stats_t &getWiFiConnectStats();
 bool waitForSNTPSync(tm *timeInfo);
 bool printLocalTime(tm *timeInfo);
-#ifdef USE_HTTP
-  int getOWMonecall(WiFiClient &client, owm_resp_onecall_t &r);
-  int getOWMairpollution(WiFiClient &client, owm_resp_air_pollution_t &r);
-#else
-  int getOWMonecall(WiFiClientSecure &client, owm_resp_onecall_t &r);
-  int getOWMairpollution(WiFiClientSecure &client, owm_resp_air_pollution_t &r);
-#endif
+int getOWMonecall(HttpConnection &owm, owm_resp_onecall_t &r);
+int getOWMairpollution(HttpConnection &owm, owm_resp_air_pollution_t &r);
 
 
 #endif
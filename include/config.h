@@ -57,6 +57,13 @@
 // HTTP SETTINGS
 // =============================================================================
 #define USE_HTTPS_NO_CERT_VERIF
+// 1 = ask OpenWeatherMap and Home Assistant for gzip/deflate compressed
+//     responses (~43KB of PSRAM, or heap, while one is decoded), 0 = plain.
+#define HTTP_ACCEPT_COMPRESSION 1
+// 1 = run the weather mode requests (OpenWeatherMap, Home Assistant) as
+//     concurrent tasks on both cores, 0 = one after another. The MQTT
+//     telemetry follows them, it reports on their handshakes.
+#define CONCURRENT_FETCH 1
 
 // =============================================================================
 // WIND INDICATOR
@@ -77,6 +84,26 @@
 #define DISPLAY_DAILY_PRECIP 2 // Smart: show only when precipitation forecasted
 #define DISPLAY_HOURLY_ICONS 0 // Disabled - icons were floating above graph
 #define DISPLAY_ALERTS 1       // Show weather alerts
+// When nothing drawn changed since the last wake except the refresh time:
+// 0 = full refresh anyway, 1 = skip the refresh (the refresh time shown is
+// then that of the last change).
+// 3 = compare the new frame with the one on the panel (see panel_frame.h):
+// skip the refresh if they are identical, partially refresh the changed
+// areas otherwise. Black and white panels only.
+// (2, a partial refresh of the status bar alone, was removed: without the
+// retained frame of 3 the panel controller has no previous image to refresh
+// against after deep sleep.)
+#define DISPLAY_SKIP_UNCHANGED 3
+// Partial refreshes in a row before a full one clears the ghosting
+#define DISPLAY_PARTIAL_REFRESHES 10
+
+// =============================================================================
+// API RESPONSE PARSING
+// =============================================================================
+// 1 = copy OneCall and Air Pollution values into their structs as they stream
+//     in (fixed ~200B parser state), 0 = build a filtered JsonDocument first
+//     (heap use grows with the response size).
+#define OWM_STREAMING_PARSER 1
 
 // =============================================================================
 // STATUS BAR
@@ -134,9 +161,15 @@ extern const uint8_t BME_ADDRESS;
 extern const char *WIFI_SSID;
 extern const char *WIFI_PASSWORD;
 extern const unsigned long WIFI_TIMEOUT;
+extern const unsigned long WIFI_FAST_CONNECT_TIMEOUT;
 extern const unsigned HTTP_CLIENT_TCP_TIMEOUT;
+extern const long DNS_CACHE_TTL;
+extern const unsigned long WAKE_BUDGET;
+extern const unsigned long WAKE_RENDER_RESERVE;
+extern const unsigned long FETCH_GRACE;
 extern const String OWM_APIKEY;
 extern const String OWM_ENDPOINT;
+extern const uint16_t OWM_PORT;
 extern const String OWM_ONECALL_VERSION;
 extern const String LAT;
 extern const String LON;
@@ -149,10 +182,13 @@ extern const char *REFRESH_TIME_FORMAT;
 extern const char *NTP_SERVER_1;
 extern const char *NTP_SERVER_2;
 extern const unsigned long NTP_TIMEOUT;
+extern const int TIME_SYNC_INTERVAL;
+extern const unsigned long TIME_MAX_ERROR;
 extern const int SLEEP_DURATION;
 extern const int BED_TIME;
 extern const int WAKE_TIME;
 extern const int HOURLY_GRAPH_MAX;
+extern const int SNAPSHOT_MAX_AGE;
 extern const uint32_t WARN_BATTERY_VOLTAGE;
 extern const uint32_t LOW_BATTERY_VOLTAGE;
 extern const uint32_t VERY_LOW_BATTERY_VOLTAGE;
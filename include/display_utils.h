@@ -55,17 +55,20 @@ uint32_t calcBatPercent(uint32_t v, uint32_t minv, uint32_t maxv);
 const uint8_t *getBatBitmap24(uint32_t batPercent);
 void getDateStr(String &s, tm *timeInfo);
 void getRefreshTimeStr(String &s, bool timeSuccess, tm *timeInfo);
-void toTitleCase(String &text);
-void truncateExtraAlertInfo(String &text);
-void filterAlerts(std::vector<owm_alerts_t> &resp, int *ignore_list);
+void toTitleCase(char *text);
+void truncateExtraAlertInfo(char *text);
+void filterAlerts(owm_alert_list_t &alerts, bool *ignore_list);
 const char *getUVIdesc(unsigned int uvi);
-float getAvgConc(const float pollutant[], int hours);
+float getAvgConc(const owm_resp_air_pollution_t &p, owm_pollutant_t pollutant,
+                 owm_aqi_window_t window);
 int getAQI(const owm_resp_air_pollution_t &p);
 const char *getAQIdesc(int aqi);
 const char *getWiFidesc(int rssi);
 const uint8_t *getWiFiBitmap16(int rssi);
+#if DISPLAY_HOURLY_ICONS
 const uint8_t *getHourlyForecastBitmap32(const owm_hourly_t &hourly,
                                          const owm_daily_t  &today);
+#endif
 const uint8_t *getDailyForecastBitmap64(const owm_daily_t &daily);
 const uint8_t *getCurrentConditionsBitmap196(const owm_current_t &current,
                                              const owm_daily_t   &today);
@@ -0,0 +1,36 @@
+/* DNS cache for TRMNL OG Weather Station
+ * Remembers the addresses of the hosts the station talks to in RTC memory, so
+ * a wake only queries DNS for hosts whose entry expired or whose address
+ * stopped accepting connections. Connections are still made by host name:
+ * the clients below only swap the lookup, so TLS SNI and the HTTP Host header
+ * are unchanged.
+ *
+ * lwIP does not report the TTL of a record, entries expire DNS_CACHE_TTL
+ * seconds after they were resolved instead.
+ */
+
+#ifndef __DNS_CACHE_H__
+#define __DNS_CACHE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <IPAddress.h>
+#include <WiFiClient.h>
+
+#define DNS_CACHE_SLOTS 4 // OWM, Home Assistant, MQTT and Nextcloud
+
+bool resolveHost(const char *host, IPAddress &ip);
+void forgetHost(const char *host);
+void prefetchHosts(const char *const *hosts, size_t count);
+
+/* A WiFiClient that resolves host names through the DNS cache.
+ */
+class CachedDnsClient : public WiFiClient
+{
+public:
+  using WiFiClient::connect;
+  int connect(const char *host, uint16_t port, int32_t timeout) override;
+  int connect(const char *host, uint16_t port) override;
+};
+
+#endif
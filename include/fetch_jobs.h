@@ -0,0 +1,31 @@
+/* Concurrent network requests for TRMNL OG Weather Station
+ * Runs independent requests (API calls) as FreeRTOS tasks spread
+ * over both cores, so the network phase takes about as long as the slowest
+ * request rather than the sum of all of them.
+ *
+ * Each job writes its result only to memory it owns (e.g. a field of a
+ * results struct passed as arg). The caller reads results only after
+ * runFetchJobs() returned true.
+ */
+
+#ifndef __FETCH_JOBS_H__
+#define __FETCH_JOBS_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <Arduino.h>
+
+typedef struct fetch_job
+{
+  const char *name;         // Task name, shown in debug output
+  void      (*run)(void *arg);
+  void       *arg;
+  uint32_t    stackSize;    // Task stack in bytes, TLS needs ~8KB
+  // set by runFetchJobs
+  uint32_t    ms;           // Time the job took
+  bool        done;
+} fetch_job_t;
+
+bool runFetchJobs(fetch_job_t *jobs, size_t count, unsigned long timeoutMs);
+
+#endif
@@ -0,0 +1,70 @@
+/* Direct frame buffer drawing for TRMNL OG Weather Station
+ * Adafruit GFX draws a bitmap with one drawPixel() call per pixel. On the
+ * black and white panels the kernels here write into the GxEPD2 page buffer
+ * instead, 8 pixels at a time, clipped to the current page and partial window.
+ *
+ * The buffer has 1 bit per pixel, most significant bit first, set for white.
+ * The kernels only depend on that layout; getFrameBuffer() tells them where
+ * the display's current page is.
+ *
+ * The raster ops fill spans of a row with a repeating pattern, 32 pixels at a
+ * time between masked bytes at either end, in place of the per-pixel loops
+ * that draw dotted and dithered areas.
+ */
+
+#ifndef __FRAME_BUFFER_H__
+#define __FRAME_BUFFER_H__
+
+#include <cstdint>
+
+typedef struct frame_buffer
+{
+  uint8_t *data;            // First row of the page
+  int16_t  x;               // Display column of the first pixel, 8-aligned
+  int16_t  y;               // Display row of the first row
+  int16_t  w;               // Pixels per row, a multiple of 8
+  int16_t  h;               // Rows
+  uint16_t stride;          // Bytes per row
+} frame_buffer_t;
+
+// How the set bits of a pattern change the buffer
+typedef enum raster_op
+{
+  RASTER_AND,               // Clear the bits: draw in black
+  RASTER_OR,                // Set the bits: draw in white
+  RASTER_XOR                // Invert the bits
+} raster_op_t;
+
+/* Describes the page of the display currently being drawn.
+ *
+ * Returns false if the display can't be drawn to directly (not black and
+ * white, or rotated or mirrored); draw through GFX then.
+ */
+bool getFrameBuffer(frame_buffer_t &fb);
+
+/* Same as GxEPD2's drawInvertedBitmap(): draws the pixels whose bits are clear
+ * in bitmap (rows padded to whole bytes, PROGMEM), in white if white is set,
+ * otherwise in black.
+ */
+void blitInvertedBitmap(const frame_buffer_t &fb, int16_t x, int16_t y,
+                        const uint8_t *bitmap, int16_t w, int16_t h,
+                        bool white);
+
+/* Applies op to the pixels of the rectangle whose bits are set in an 8x8
+ * pattern: pixel (x, y) of the display takes bit 7 - (x & 7) of
+ * pattern[y & 7], so neighbouring fills line up.
+ */
+void fillPattern(const frame_buffer_t &fb, int16_t x, int16_t y, int16_t w,
+                 int16_t h, const uint8_t pattern[8], raster_op_t op);
+/* Applies op to the pixels of a horizontal or vertical line whose bits are set
+ * in pattern. The pattern repeats every period pixels (1 to 8) from x or y,
+ * its first pixel in the most significant bit.
+ */
+void drawDashedHLine(const frame_buffer_t &fb, int16_t x, int16_t y,
+                     int16_t w, uint8_t pattern, uint8_t period,
+                     raster_op_t op);
+void drawDashedVLine(const frame_buffer_t &fb, int16_t x, int16_t y,
+                     int16_t h, uint8_t pattern, uint8_t period,
+                     raster_op_t op);
+
+#endif
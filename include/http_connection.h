@@ -0,0 +1,94 @@
+/* Persistent HTTP connections for TRMNL OG Weather Station
+ * Serves consecutive requests to one host over a single kept-alive
+ * connection, so e.g. the OneCall and Air Pollution requests cost one TLS
+ * handshake instead of two.
+ *
+ * Response bodies are read through HttpBodyStream, which undoes chunked
+ * transfer encoding and knows where the body ends. That lets a request that
+ * stopped reading early (the streaming parsers do) skip the rest of the body
+ * and leave the connection ready for the next request.
+ */
+
+#ifndef __HTTP_CONNECTION_H__
+#define __HTTP_CONNECTION_H__
+
+#include <cstdint>
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <WiFiClient.h>
+
+// Most bytes skipped at the end of a response to keep the connection open,
+// beyond that reconnecting is cheaper than reading on.
+#define HTTP_KEEPALIVE_DRAIN_MAX 8192
+
+/* Reads one response body off the connection, ending at its Content-Length or
+ * its last chunk.
+ */
+class HttpBodyStream : public Stream
+{
+public:
+  HttpBodyStream()
+    : _in(nullptr), _remaining(0), _chunked(false), _untilClose(false),
+      _chunkEnd(false), _ended(true), _failed(false) {}
+
+  // contentLength < 0 and !chunked: the body ends when the server closes.
+  void begin(Stream &in, int contentLength, bool chunked);
+  // Skips the unread rest of the body. Returns true if the body ended within
+  // maxBytes, so the connection can be reused.
+  bool drain(size_t maxBytes);
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t readBytes(char *buffer, size_t length) override;
+  size_t write(uint8_t) override { return 0; }
+
+private:
+  bool ensure();
+  bool readLine(char *line, size_t size);
+
+  Stream *_in;
+  size_t  _remaining;       // Bytes left in the body, or in the current chunk
+  bool    _chunked;
+  bool    _untilClose;
+  bool    _chunkEnd;        // A chunk was read, its CRLF is next
+  bool    _ended;
+  bool    _failed;
+};
+
+class HttpConnection
+{
+public:
+  HttpConnection(WiFiClient &client, const String &host, uint16_t port);
+  ~HttpConnection();
+
+  /* Sends a GET request, on the open connection if there is one. If the server
+   * closed it in the meantime the request is sent again on a new one.
+   *
+   * Returns the HTTP status code, or a negative HTTPClient error.
+   */
+  int get(const String &uri);
+  // Connect and read timeout of the following requests, in ms.
+  void setTimeout(unsigned timeout);
+  // Response headers; the collected ones are Content-Encoding,
+  // Transfer-Encoding and Date.
+  HTTPClient &http() { return _http; }
+  Stream &body() { return _body; }
+  // Ends the request. The connection stays open if the server allows it and
+  // the rest of the body could be skipped.
+  void end();
+  void close();
+
+private:
+  int send(const String &uri);
+
+  WiFiClient &_client;
+  HTTPClient  _http;
+  HttpBodyStream _body;
+  String      _host;
+  uint16_t    _port;
+  uint16_t    _requests;
+  uint16_t    _connects;
+};
+
+#endif
@@ -0,0 +1,73 @@
+/* Streaming gzip/deflate decoder for TRMNL OG Weather Station
+ * Sits between HTTPClient's stream and a consumer (ArduinoJson, the streaming
+ * JSON reader) and decodes a compressed response body as it is read, using the
+ * miniz inflater in the ESP32 ROM.
+ *
+ * Decoding needs the 32KB deflate window plus ~11KB of decoder state. Both are
+ * allocated by begin() (from PSRAM when available) and only when the response
+ * is actually compressed; an uncompressed body is passed through as is.
+ */
+
+#ifndef __INFLATE_STREAM_H__
+#define __INFLATE_STREAM_H__
+
+#include <cstdint>
+#include <Arduino.h>
+#include <HTTPClient.h>
+
+#define INFLATE_STREAM_IN_SIZE 512 // compressed bytes pulled per read
+
+typedef enum inflate_encoding
+{
+  INFLATE_IDENTITY,  // not compressed
+  INFLATE_GZIP,      // Content-Encoding: gzip
+  INFLATE_DEFLATE    // Content-Encoding: deflate (zlib wrapped)
+} inflate_encoding_t;
+
+// Asks the server to compress the response. Call before GET(). A body read
+// from HTTPClient::getStream() must not be chunked, see HttpBodyStream or
+// HTTPClient::useHTTP10().
+void acceptCompressedResponse(HTTPClient &http);
+// Returns the encoding of the response body. Call after GET().
+inflate_encoding_t getResponseEncoding(HTTPClient &http);
+
+class InflateStream : public Stream
+{
+public:
+  InflateStream(Stream &in, inflate_encoding_t encoding);
+  ~InflateStream();
+
+  // Allocates the decoder and reads the gzip header. Returns false if memory
+  // could not be allocated or the header is invalid.
+  bool begin();
+  // True if the compressed data was invalid or ended early.
+  bool failed() const { return _failed; }
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t readBytes(char *buffer, size_t length) override;
+  size_t write(uint8_t) override { return 0; }
+
+private:
+  bool fill();
+  bool refillInput();
+  bool readInput(uint8_t &c);
+  bool skipGzipHeader();
+
+  Stream            &_in;
+  inflate_encoding_t _encoding;
+  void              *_decomp;    // tinfl_decompressor
+  uint8_t           *_window;    // circular output window
+  size_t             _windowPos; // where the decoder writes next
+  size_t             _outPos;    // decoded bytes not yet read are
+  size_t             _outEnd;    //   _window[_outPos, _outEnd)
+  uint8_t            _inBuf[INFLATE_STREAM_IN_SIZE];
+  size_t             _inPos;
+  size_t             _inLen;
+  bool               _inEnded;
+  bool               _done;
+  bool               _failed;
+};
+
+#endif
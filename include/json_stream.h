@@ -0,0 +1,157 @@
+/* Streaming JSON pull reader for TRMNL OG Weather Station
+ * Walks a JSON document token by token as the bytes arrive from a Stream, so
+ * callers can copy values straight into their own structs without building an
+ * ArduinoJson JsonDocument first.
+ *
+ * Peak memory is fixed and independent of the document size:
+ *   sizeof(JsonStreamReader)  ~= JSON_STREAM_BUF_SIZE + JSON_STREAM_TOKEN_SIZE
+ *                                + 32 bytes of state
+ *   plus one small stack frame per nesting level walked by the caller.
+ * Strings longer than JSON_STREAM_TOKEN_SIZE - 1 bytes are truncated, which
+ * readString() reports.
+ */
+
+#ifndef __JSON_STREAM_H__
+#define __JSON_STREAM_H__
+
+#include <cstdint>
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#define JSON_STREAM_BUF_SIZE   64 // bytes pulled from the Stream per read
+#define JSON_STREAM_TOKEN_SIZE 96 // longest key/string/number kept (incl. '\0')
+#define JSON_STREAM_MAX_DEPTH  32 // deepest nesting of objects and arrays
+
+typedef enum json_stream_event
+{
+  JSON_STREAM_OBJECT_BEGIN,
+  JSON_STREAM_OBJECT_END,
+  JSON_STREAM_ARRAY_BEGIN,
+  JSON_STREAM_ARRAY_END,
+  JSON_STREAM_KEY,
+  JSON_STREAM_STRING,
+  JSON_STREAM_NUMBER,
+  JSON_STREAM_TRUE,
+  JSON_STREAM_FALSE,
+  JSON_STREAM_NULL,
+  JSON_STREAM_ERROR
+} json_stream_event_t;
+
+class JsonStreamReader
+{
+public:
+  explicit JsonStreamReader(Stream &in);
+
+  // Returns the next event. Keys, strings and numbers are available through
+  // text() until the following call to next().
+  json_stream_event_t next();
+  // Returns the next event without consuming it.
+  json_stream_event_t peek();
+
+  const char *text() const { return _token; }
+  uint8_t depth() const { return _depth; }
+  DeserializationError::Code error() const { return _error; }
+  // Number of bytes pulled off the underlying Stream so far.
+  size_t bytesRead() const { return _bytesRead; }
+  // Number of those bytes that belonged to values passed to skip().
+  size_t bytesSkipped() const { return _bytesSkipped; }
+
+  // Skips the value that begins with event e (the whole container for
+  // *_BEGIN events). Returns false if the document is malformed.
+  bool skip(json_stream_event_t e);
+  bool skipValue() { return skip(next()); }
+
+  // Each of these consumes exactly one value. Values of a different type are
+  // skipped and read as 0 (or an empty string), like JsonVariant::as<T>().
+  // readString returns the full length of the string read, like strlcpy.
+  // dst holds at most JSON_STREAM_TOKEN_SIZE - 1 bytes of it, so a result
+  // >= size or >= JSON_STREAM_TOKEN_SIZE means dst holds a truncated copy.
+  float   readFloat();
+  int     readInt();
+  int64_t readInt64();
+  size_t  readString(char *dst, size_t size);
+
+private:
+  bool readByte(char &c);
+  void unreadByte(char c);
+  json_stream_event_t fail(DeserializationError::Code code);
+  json_stream_event_t push(bool isArray);
+  json_stream_event_t pop(bool isArray);
+  json_stream_event_t readStringToken();
+  json_stream_event_t readNumberToken(char first);
+  json_stream_event_t readLiteralToken(char first);
+  bool inObject() const;
+  size_t bytesConsumed() const;
+
+  Stream  &_in;
+  char     _buf[JSON_STREAM_BUF_SIZE];
+  char     _token[JSON_STREAM_TOKEN_SIZE];
+  uint8_t  _pos;
+  uint8_t  _len;
+  uint8_t  _depth;
+  bool     _expectKey;
+  bool     _afterKey;
+  bool     _hasUnread;
+  char     _unread;
+  bool     _hasPeeked;
+  json_stream_event_t        _peeked;
+  uint32_t                   _arrayMask; // bit n set if level n is an array
+  size_t                     _bytesRead;
+  size_t                     _bytesSkipped;
+  size_t                     _tokenStart; // bytesConsumed() at last token
+  size_t                     _stringLength; // of the last string, untruncated
+  DeserializationError::Code _error;
+};
+
+/* Calls onMember(key) for each member of the object at the reader's current
+ * position. onMember must consume the member's value (read it or skip it) and
+ * return false to abort. A non-object value is skipped and yields no members.
+ *
+ * Returns false if the document is malformed or onMember aborted.
+ */
+template <typename F>
+bool jsonStreamForEachMember(JsonStreamReader &rd, F onMember)
+{
+  json_stream_event_t e = rd.next();
+  if (e != JSON_STREAM_OBJECT_BEGIN)
+  {
+    return rd.skip(e);
+  }
+  while ((e = rd.next()) == JSON_STREAM_KEY)
+  {
+    if (!onMember(rd.text()))
+    {
+      return false;
+    }
+  }
+  return e == JSON_STREAM_OBJECT_END;
+} // end jsonStreamForEachMember
+
+/* Calls onElement(i) for each element of the array at the reader's current
+ * position. onElement must consume the element (read it or skip it) and return
+ * false to abort. A non-array value is skipped and yields no elements.
+ *
+ * Returns false if the document is malformed or onElement aborted.
+ */
+template <typename F>
+bool jsonStreamForEachElement(JsonStreamReader &rd, F onElement)
+{
+  json_stream_event_t e = rd.next();
+  if (e != JSON_STREAM_ARRAY_BEGIN)
+  {
+    return rd.skip(e);
+  }
+  int i = 0;
+  while ((e = rd.peek()) != JSON_STREAM_ARRAY_END)
+  {
+    if (e == JSON_STREAM_ERROR || !onElement(i))
+    {
+      return false;
+    }
+    ++i;
+  }
+  rd.next();
+  return true;
+} // end jsonStreamForEachElement
+
+#endif
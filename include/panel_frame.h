@@ -0,0 +1,59 @@
+/* Retained panel frame for TRMNL OG Weather Station
+ * Keeps a copy of the frame last shown on the panel across deep sleep, so the
+ * next frame can be compared with it: an identical frame leaves the panel
+ * alone, and a frame that changed in a few places is refreshed there only.
+ *
+ * Neither RTC slow memory (8 KB) nor PSRAM (powered down) keep a 48 KB frame
+ * through deep sleep; it is PackBits compressed into a LittleFS file instead,
+ * which the mostly white frames shrink well for. The header, with the number
+ * of partial refreshes since the last full one, stays in RTC memory; after a
+ * power loss there is no frame and the panel is fully refreshed.
+ */
+
+#ifndef __PANEL_FRAME_H__
+#define __PANEL_FRAME_H__
+
+#include <cstddef>
+#include <cstdint>
+
+#define PANEL_FRAME_FILE      "/panel.frame"
+#define PANEL_FRAME_BAND      8   // Rows compared as one
+#define PANEL_FRAME_MAX_RECTS 4   // Partial windows refreshed per frame
+
+typedef struct panel_rect
+{
+  int16_t x;                // Multiples of 8
+  int16_t y;
+  int16_t w;
+  int16_t h;
+} panel_rect_t;
+
+/* Loads the retained frame into a new buffer, to be released with free().
+ *
+ * Returns nullptr if there is none of the given size.
+ */
+uint8_t *loadPanelFrame(size_t size);
+/* Retains frame as the one on the panel. partial counts its refresh towards
+ * the next full one.
+ *
+ * Returns true if the frame was saved.
+ */
+bool savePanelFrame(const uint8_t *frame, size_t size, bool partial);
+// Drops the retained frame, for when the panel shows something else.
+void forgetPanelFrame();
+// The partial refreshes since the last full one reached
+// DISPLAY_PARTIAL_REFRESHES.
+bool isFullRefreshDue();
+
+/* Compares two frames of rows x stride bytes in bands of PANEL_FRAME_BAND
+ * rows. Changed bands that touch are joined; beyond maxRects the last
+ * rectangle takes in the rest.
+ *
+ * Returns the number of rectangles covering the changes, 0 if the frames are
+ * identical.
+ */
+uint8_t diffPanelFrame(const uint8_t *previous, const uint8_t *current,
+                       uint16_t stride, uint16_t rows, panel_rect_t *rects,
+                       uint8_t maxRects);
+
+#endif
@@ -0,0 +1,79 @@
+/* API response parse profiling for TRMNL OG Weather Station
+ * Measures what deserializing one API response costs on the device (time,
+ * bytes pulled off the connection and heap) and prints it as a single JSON
+ * line prefixed with "[profile] ", e.g.
+ *
+ *   [profile] {"fn":"deserializeOneCallStream","err":0,"us":48210,
+ *              "bytes":16384,"skipped":9120,"early":1,"heap_delta":-1204,
+ *              "block_delta":3,"heap_peak":1532,"heap_min":201876,
+ *              "max_block":110580}
+ *
+ * so the serial logs of two firmware versions can be grepped and compared.
+ * heap_peak is only known when the parse set a new heap low-water mark, it is
+ * -1 otherwise.
+ */
+
+#ifndef __PARSE_PROFILE_H__
+#define __PARSE_PROFILE_H__
+
+#include <cstdint>
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "api_response.h"
+
+/* Passes reads through to another Stream and counts the bytes, so the same
+ * count is available for the DOM and the streaming parsers.
+ */
+class CountingStream : public Stream
+{
+public:
+  explicit CountingStream(Stream &in) : _in(in), _count(0) {}
+
+  size_t count() const { return _count; }
+
+  int available() override { return _in.available(); }
+  int peek() override { return _in.peek(); }
+  int read() override
+  {
+    int c = _in.read();
+    if (c >= 0)
+    {
+      ++_count;
+    }
+    return c;
+  }
+  size_t readBytes(char *buffer, size_t length) override
+  {
+    size_t n = _in.readBytes(buffer, length);
+    _count += n;
+    return n;
+  }
+  size_t write(uint8_t) override { return 0; }
+
+private:
+  Stream &_in;
+  size_t  _count;
+};
+
+typedef struct parse_profile
+{
+  uint32_t startUs;
+  uint32_t us;              // Time spent parsing
+  size_t   bytes;           // Bytes pulled off the connection
+  int32_t  heapDelta;       // Change in free heap, negative if it shrank
+  int32_t  blockDelta;      // Change in the number of allocated heap blocks
+  int32_t  heapPeak;        // Most heap in use above the start, -1 if unknown
+  size_t   heapMin;         // Heap low-water mark after the parse
+  size_t   maxBlock;        // Largest allocatable block after the parse
+  size_t   freeStart;
+  size_t   blocksStart;
+  size_t   minStart;
+} parse_profile_t;
+
+void beginParseProfile(parse_profile_t &p);
+void endParseProfile(parse_profile_t &p, const CountingStream &in);
+void printParseProfile(const char *fn, const parse_profile_t &p,
+                       DeserializationError err,
+                       const owm_parse_stats_t &stats);
+
+#endif
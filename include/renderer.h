@@ -53,6 +53,9 @@
                    GxEPD2_750::HEIGHT> display;
 #endif
 
+extern uint32_t panelContentHash;
+extern uint32_t panelStatusBarHash;
+
 typedef enum alignment
 {
   LEFT,
@@ -68,21 +71,34 @@ void drawMultiLnString(int16_t x, int16_t y, const String &text,
                        alignment_t alignment, uint16_t max_width,
                        uint16_t max_lines, int16_t line_spacing,
                        uint16_t color=GxEPD_BLACK);
+typedef enum frame_refresh
+{
+  FRAME_UNCHANGED,
+  FRAME_PARTIAL,
+  FRAME_FULL
+} frame_refresh_t;
+
 void initDisplay();
+void beginFrame();
+frame_refresh_t refreshFrame(bool full);
 void powerOffDisplay();
 void drawCurrentConditions(const owm_current_t &current,
                            const owm_daily_t &today,
-                           const owm_resp_air_pollution_t &owm_air_pollution,
-                           bool airPollutionSuccess,
-                           float inTemp, float inHumidity);
+                           int aqi, float inTemp, float inHumidity);
 void drawForecast(const owm_daily_t *daily, tm timeInfo);
-void drawAlerts(std::vector<owm_alerts_t> &alerts,
+void drawAlerts(owm_alert_list_t &alerts,
                 const String &city, const String &date);
 void drawLocationDate(const String &city, const String &date);
 void drawOutlookGraph(const owm_hourly_t *hourly, const owm_daily_t *daily,
                       tm timeInfo);
 void drawStatusBar(const String &statusStr, const String &refreshTimeStr,
                    int rssi, uint32_t batVoltage);
+uint32_t getWeatherContentHash(const owm_resp_onecall_t &onecall, int aqi,
+                               float inTemp, float inHumidity,
+                               const String &city, const String &date,
+                               const tm &timeInfo);
+uint32_t getStatusBarHash(const String &statusStr, int rssi,
+                          uint32_t batVoltage);
 void drawError(const uint8_t *bitmap_196x196,
                const String &errMsgLn1, const String &errMsgLn2="");
 
@@ -0,0 +1,59 @@
+/* Deadline-aware request retries for TRMNL OG Weather Station
+ * Every request made during a wake shares one budget: the wake must end
+ * within WAKE_BUDGET ms of starting (watchdogCheckAndSleep() enforces it) and
+ * WAKE_RENDER_RESERVE ms of that are kept for drawing. Each attempt gets a
+ * connect/read timeout that ends at that deadline at the latest, so timeouts
+ * shrink as the budget runs out. Retries wait a jittered exponential backoff
+ * and are only made if they can still finish in time.
+ *
+ * The policy functions take the current time, so they can be exercised off
+ * the device with any clock.
+ */
+
+#ifndef __REQUEST_SCHEDULER_H__
+#define __REQUEST_SCHEDULER_H__
+
+#include <cstdint>
+
+#define REQUEST_BACKOFF_BASE  500  // ms before the first retry, doubled after
+#define REQUEST_BACKOFF_MAX   4000 // ms
+#define REQUEST_MIN_TIMEOUT   1500 // ms, attempts that would get less are not made
+
+typedef enum request_outcome
+{
+  REQUEST_PENDING,
+  REQUEST_OK,
+  REQUEST_REJECTED,         // Response that retrying won't change, e.g. 401
+  REQUEST_NO_WIFI,          // WiFi disconnected
+  REQUEST_OUT_OF_ATTEMPTS,
+  REQUEST_OUT_OF_TIME       // Another attempt would not finish before deadline
+} request_outcome_t;
+
+typedef struct request_schedule
+{
+  const char       *name;
+  unsigned long     deadline;     // millis() by which the request must end
+  unsigned long     nextAt;       // millis() of the next attempt
+  unsigned          maxTimeout;   // Longest timeout an attempt gets
+  uint8_t           attempts;     // Attempts made so far
+  uint8_t           maxAttempts;
+  int               status;       // Result of the last attempt
+  request_outcome_t outcome;
+} request_schedule_t;
+
+void beginWakeBudget(unsigned long startMs);
+unsigned long getRequestDeadline();
+unsigned long getRequestTimeLeft();
+
+void beginRequest(request_schedule_t &req, const char *name,
+                  uint8_t maxAttempts, unsigned maxTimeout);
+unsigned nextAttempt(request_schedule_t &req);
+void endAttempt(request_schedule_t &req, int status);
+const char *getRequestOutcomeName(request_outcome_t outcome);
+
+// policy, independent of the clock
+unsigned getAttemptTimeout(const request_schedule_t &req, unsigned long now);
+unsigned long getBackoffDelay(uint8_t attempt, uint32_t random);
+request_outcome_t classifyStatus(int status);
+
+#endif
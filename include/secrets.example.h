@@ -18,6 +18,10 @@
 // Get your free API key at: https://openweathermap.org/api
 // =============================================================================
 #define SECRET_OWM_APIKEY    "your_openweathermap_api_key"
+// Optional, to use another server instead (plain HTTP needs USE_HTTP in
+// config.h)
+// #define SECRET_OWM_ENDPOINT  "192.168.1.10"
+// #define SECRET_OWM_PORT      8080
 
 // =============================================================================
 // LOCATION
@@ -51,6 +55,7 @@
 // =============================================================================
 // NEXTCLOUD WEBDAV (optional - for photo/cartoon display modes)
 // Set URL to empty string to disable image modes
+// An http:// URL is fetched without TLS
 // =============================================================================
 #define SECRET_NEXTCLOUD_URL      "https://your-nextcloud.com/remote.php/dav/files/username/path/"
 #define SECRET_NEXTCLOUD_USER     "your_username"
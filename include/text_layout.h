@@ -0,0 +1,45 @@
+/* Text measurement for TRMNL OG Weather Station
+ * Adafruit GFX measures a string glyph by glyph with getTextBounds(), through
+ * a virtual charBounds() call per character that also handles wrapping and
+ * text size.
+ *
+ * measureText() reads the bounds of a run straight from the glyph table of the
+ * current font instead: one table lookup and four compares per character.
+ * Results are not cached, a lookup would have to walk the text as well.
+ */
+
+#ifndef __TEXT_LAYOUT_H__
+#define __TEXT_LAYOUT_H__
+
+#include <cstdint>
+#include <Arduino.h>
+
+typedef struct text_bounds
+{
+  int16_t  x1;              // Left edge, relative to the cursor
+  int16_t  y1;              // Top edge, relative to the baseline
+  uint16_t w;
+  uint16_t h;
+} text_bounds_t;
+
+/* Bounds of text drawn at the cursor in the display's current font, the same
+ * as display.getTextBounds() at (0, 0).
+ */
+text_bounds_t measureText(const String &text);
+
+typedef struct text_line
+{
+  uint16_t len;             // Characters drawn
+  uint16_t next;            // Offset of the next line's text
+  uint16_t w;               // Width drawn, the ellipsis included
+  bool     ellipsis;        // "..." follows the characters drawn
+} text_line_t;
+
+/* Breaks the first line off text to fit max_width, in one pass over it.
+ * Lines break after the last space or hyphen that fits; the space is dropped.
+ * The last line only breaks at spaces, and ends in an ellipsis if that fits.
+ * A line without a break that fits runs up to the first one, or to the end.
+ */
+text_line_t breakTextLine(const char *text, uint16_t max_width, bool lastLine);
+
+#endif
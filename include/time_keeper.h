@@ -0,0 +1,52 @@
+/* Clock maintenance for TRMNL OG Weather Station
+ * The RTC keeps time during deep sleep, but its slow clock drifts. The drift
+ * is learned from the clock error found at each SNTP sync, kept in RTC memory
+ * and corrected for on every wake, so a full SNTP sync is only needed every
+ * TIME_SYNC_INTERVAL hours, or earlier once the estimated clock error exceeds
+ * TIME_MAX_ERROR. In between, the Date header of the OWM response keeps the
+ * clock within about a second.
+ *
+ * The estimated error grows from that of the last reference (SNTP or Date
+ * header) by the uncertainty of the drift, which is how far off the previous
+ * drift estimate turned out to be.
+ */
+
+#ifndef __TIME_KEEPER_H__
+#define __TIME_KEEPER_H__
+
+#include <cstdint>
+#include <Arduino.h>
+
+#define TIME_DRIFT_UNKNOWN_PPM  5000  // drift uncertainty before it is learned
+#define TIME_DRIFT_MIN_PPM      50    // drift uncertainty once learned, at least
+#define TIME_DRIFT_MAX_PPM      50000 // larger drift estimates are discarded
+#define TIME_DRIFT_MIN_INTERVAL 1800  // s between syncs to learn drift from
+#define TIME_SNTP_ERROR_MS      100   // error right after an SNTP sync
+#define TIME_DATE_ERROR_MS      1500  // error right after reading a Date header
+#define TIME_DATE_STEP_MIN_MS   2000  // smaller Date header offsets are noise
+
+typedef enum time_reference
+{
+  TIME_REF_NONE,            // The clock has never been set
+  TIME_REF_SNTP,
+  TIME_REF_HTTP_DATE
+} time_reference_t;
+
+typedef struct time_confidence
+{
+  time_reference_t reference; // Last reference the clock was set from
+  bool     synced;          // SNTP synced during this wake
+  uint32_t errorMs;         // Estimated clock error
+  int32_t  driftPpm;        // RTC drift, positive if the RTC runs fast
+  uint32_t syncAgeS;        // Time since the last SNTP sync
+} time_confidence_t;
+
+void beginTimeKeeping();
+bool isTimeSyncDue();
+void beginTimeSync();
+bool endTimeSync();
+void disciplineClock(const String &httpDate);
+time_confidence_t getTimeConfidence();
+const char *getTimeReferenceName(time_reference_t reference);
+
+#endif
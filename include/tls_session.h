@@ -0,0 +1,47 @@
+/* TLS session resumption for TRMNL OG Weather Station
+ * A WiFiClientSecure that remembers the TLS session (session ID or session
+ * ticket) of the last connection to each host in RTC memory and offers it on
+ * the next connection, including the first one after deep sleep. When the
+ * server accepts it, the handshake skips the certificate exchange and the
+ * public-key operations, which dominate the connection time.
+ *
+ * Sessions are stored without the server certificate, so each fits in
+ * TLS_SESSION_MAX_SIZE bytes. Only insecure and CA certificate verification
+ * are supported; other modes connect exactly like WiFiClientSecure.
+ */
+
+#ifndef __TLS_SESSION_H__
+#define __TLS_SESSION_H__
+
+#include <cstdint>
+#include <WiFiClientSecure.h>
+
+#define TLS_SESSION_SLOTS    2   // hosts remembered (OWM and Nextcloud)
+#define TLS_SESSION_MAX_SIZE 512 // serialized session bytes per host
+
+/*
+ * Handshakes since power-on, and the time spent in them during this wake.
+ */
+typedef struct tls_handshake_stats
+{
+  uint32_t full;            // Full handshakes
+  uint32_t resumed;         // Handshakes that resumed a stored session
+  uint32_t failed;          // Handshakes that failed
+  uint32_t lastMs;          // Duration of the last handshake
+  uint32_t wakeMs;          // Total handshake time during this wake
+} tls_handshake_stats_t;
+
+class TlsSessionClient : public WiFiClientSecure
+{
+public:
+  using WiFiClientSecure::connect;
+  int connect(const char *host, uint16_t port, int32_t timeout) override;
+  int connect(const char *host, uint16_t port) override;
+
+private:
+  int startTls(IPAddress ip, uint16_t port, const char *host);
+};
+
+tls_handshake_stats_t getTlsHandshakeStats();
+
+#endif
@@ -0,0 +1,60 @@
+/* Wake profiling for TRMNL OG Weather Station
+ * Adds up where the time of a wake goes, phase by phase, and the heap low-water
+ * marks. The record of a wake is kept in RTC memory through deep sleep, so it
+ * can be published on the next wake, once the numbers are complete.
+ *
+ * Phases may overlap: the fetch jobs run concurrently, and parsing happens
+ * within the OWM requests.
+ *
+ * Wakes are numbered from power on. Built for the stand-in servers
+ * (STANDIN_HOST), every request carries the number in a WAKE_HEADER header,
+ * so tools/standin/standin.py can tell the wakes apart however the requests
+ * of one are ordered.
+ */
+
+#ifndef __WAKE_PROFILE_H__
+#define __WAKE_PROFILE_H__
+
+#include <cstdint>
+
+// Request header with the wake number, sent to the stand-in servers only
+#define WAKE_HEADER "X-Wake"
+
+typedef enum wake_phase
+{
+  WAKE_PHASE_BOOT,          // Reset until setup()
+  WAKE_PHASE_WIFI_ASSOC,    // Association with the access point
+  WAKE_PHASE_DHCP,          // Association until an IP address is set
+  WAKE_PHASE_DNS,           // DNS lookups
+  WAKE_PHASE_TLS,           // TLS handshakes
+  WAKE_PHASE_HTTP_ONECALL,  // OneCall request, retries included
+  WAKE_PHASE_HTTP_AIR,      // Air Pollution request
+  WAKE_PHASE_HTTP_HA,       // Home Assistant request
+  WAKE_PHASE_HTTP_IMAGE,    // Nextcloud image request
+  WAKE_PHASE_PARSE,         // Parsing responses
+  WAKE_PHASE_RENDER,        // Drawing the display pages
+  WAKE_PHASE_REFRESH,       // Display init, transfer, refresh and power off
+  WAKE_PHASE_MQTT,          // Telemetry
+  WAKE_PHASE_RADIO,         // WiFi on
+  WAKE_PHASE_COUNT
+} wake_phase_t;
+
+typedef struct wake_profile
+{
+  uint32_t wake;            // Number of the wake, see getWakeNumber()
+  uint32_t phaseMs[WAKE_PHASE_COUNT];
+  uint32_t awakeMs;         // Reset until deep sleep
+  uint32_t minFreeHeap;     // Least free heap during the wake
+  uint32_t minMaxAlloc;     // Smallest largest allocatable block seen
+} wake_profile_t;
+
+void beginWakeProfile();
+uint32_t getWakeNumber();
+void addWakePhase(wake_phase_t phase, uint32_t ms);
+void sampleWakeHeap();
+void endWakeProfile();
+bool getLastWakeProfile(wake_profile_t &profile);
+void markLastWakeProfilePublished();
+const char *getWakePhaseName(wake_phase_t phase);
+
+#endif
@@ -0,0 +1,44 @@
+/* Persisted weather snapshot for TRMNL OG Weather Station
+ * Keeps the last successfully fetched OneCall response, AQI and indoor
+ * readings across deep sleep so a button press can redraw the weather display
+ * without powering the radio.
+ *
+ * The snapshot is a versioned binary record: a small header that always lives
+ * in RTC slow memory, followed by the payload. The payload is stored in RTC
+ * memory as well when it fits in WEATHER_SNAPSHOT_RTC_SIZE bytes and in a
+ * LittleFS file otherwise (e.g. with more hourly entries or alerts).
+ */
+
+#ifndef __WEATHER_SNAPSHOT_H__
+#define __WEATHER_SNAPSHOT_H__
+
+#include <cstdint>
+#include <time.h>
+#include "api_response.h"
+
+// Bump whenever the payload layout changes, older snapshots are then ignored.
+#define WEATHER_SNAPSHOT_VERSION   3
+#define WEATHER_SNAPSHOT_RTC_SIZE  2048 // RTC slow memory reserved for payloads
+#define WEATHER_SNAPSHOT_FILE      "/weather.snap"
+#define WEATHER_SNAPSHOT_STATUS_LEN 48
+
+/*
+ * Everything besides the OneCall response that the weather display draws.
+ */
+typedef struct weather_snapshot_meta
+{
+  int64_t fetchedAt;        // Time the data was fetched, Unix, UTC
+  int16_t aqi;              // Air quality index, -1 if unavailable
+  int16_t wifiRSSI;         // WiFi RSSI when the data was fetched
+  int16_t timeErrorS;       // Estimated clock error when the data was fetched
+  float   inTemp;           // Indoor temperature, NAN if unavailable
+  float   inHumidity;       // Indoor humidity, NAN if unavailable
+  char    status[WEATHER_SNAPSHOT_STATUS_LEN]; // Status bar message
+} weather_snapshot_meta_t;
+
+bool saveWeatherSnapshot(const owm_resp_onecall_t &onecall,
+                         const weather_snapshot_meta_t &meta);
+bool loadWeatherSnapshot(owm_resp_onecall_t &onecall,
+                         weather_snapshot_meta_t &meta, int maxAgeMinutes);
+
+#endif
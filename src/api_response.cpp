@@ -15,21 +15,121 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <cstring>
 #include <vector>
 #include <ArduinoJson.h>
+#include <aqi.h>
+#include "_locale.h"
 #include "api_response.h"
 #include "config.h"
+#include "json_stream.h"
 
-DeserializationError deserializeOneCall(WiFiClient &json,
+/* Sets the icon and day flag of weather from an OpenWeatherMap icon id such as
+ * "10d".
+ */
+static void setWeatherIcon(owm_weather_t &weather, const char *icon)
+{
+  weather.icon = OWM_ICON_UNKNOWN;
+  weather.day  = 0;
+  if (icon == nullptr
+   || icon[0] < '0' || icon[0] > '9' || icon[1] < '0' || icon[1] > '9')
+  {
+    return;
+  }
+  weather.icon = static_cast<owm_icon_t>((icon[0] - '0') * 10
+                                         + (icon[1] - '0'));
+  // OpenWeatherMap indicates sun is up with d otherwise n for night
+  weather.day  = icon[2] == 'd';
+} // end setWeatherIcon
+
+/* Copies alert text into one of the fixed buffers of owm_alerts_t, counting
+ * the copy in truncated if src did not fit.
+ */
+static void setAlertText(char *dst, size_t size, const char *src,
+                         uint8_t &truncated)
+{
+  if (src == nullptr)
+  {
+    dst[0] = '\0';
+    return;
+  }
+  if (strlcpy(dst, src, size) >= size)
+  {
+    ++truncated;
+  }
+} // end setAlertText
+
+/* Helpers used by the manifest expansions below. Each is overloaded for the
+ * field types that can appear in a manifest (see api_response.h).
+ */
+static void setFilter(JsonObject f, const char *key, const void *)
+{
+  f[key] = true;
+}
+
+static void setFilter(JsonObject f, const char *key, const owm_weather_t *)
+{
+  f[key][0]["id"]   = true;
+  f[key][0]["icon"] = true;
+}
+
+static void setFilter(JsonObject f, const char *key, const owm_temp_t *)
+{
+#define OWM_FILTER_TEMP_FIELD(type, member, name) f[key][name] = true;
+  OWM_TEMP_FIELDS(OWM_FILTER_TEMP_FIELD)
+#undef OWM_FILTER_TEMP_FIELD
+}
+
+template <typename T>
+static void domRead(JsonVariantConst v, T &out)
+{
+  out = v.as<T>();
+}
+
+static void domRead(JsonVariantConst v, owm_weather_t &out)
+{
+  JsonVariantConst w = v[0];
+  out.id = w["id"].as<int>();
+  setWeatherIcon(out, w["icon"].as<const char *>());
+}
+
+static void domRead(JsonVariantConst v, owm_temp_t &out)
+{
+#define OWM_DOM_TEMP_FIELD(type, member, name) domRead(v[name], out.member);
+  OWM_TEMP_FIELDS(OWM_DOM_TEMP_FIELD)
+#undef OWM_DOM_TEMP_FIELD
+}
+
+// Expansions shared by the filter and the DOM copy. f is the filter object of
+// the section, src its JsonObject in the document and dst the destination.
+#define OWM_FILTER_FIELD(type, member, name)                                   \
+  setFilter(f, name, static_cast<type *>(nullptr));
+#define OWM_FILTER_1H_FIELD(member, name)                                      \
+  f[name]["1h"] = true;
+#define OWM_DOM_FIELD(type, member, name)                                      \
+  domRead(src[name], dst.member);
+#define OWM_DOM_1H_FIELD(member, name)                                         \
+  dst.member = src[name]["1h"].as<float>();
+
+DeserializationError deserializeOneCall(Stream &json,
                                         owm_resp_onecall_t &r)
 {
   int i;
 
   JsonDocument filter;
-  filter["current"]  = true;
+  {
+    JsonObject f = filter["current"].to<JsonObject>();
+    OWM_CURRENT_FIELDS(OWM_FILTER_FIELD, OWM_FILTER_1H_FIELD)
+  }
   filter["minutely"] = false;
-  filter["hourly"]   = true;
-  filter["daily"]    = true;
+  {
+    JsonObject f = filter["hourly"][0].to<JsonObject>();
+    OWM_HOURLY_FIELDS(OWM_FILTER_FIELD, OWM_FILTER_1H_FIELD)
+  }
+  {
+    JsonObject f = filter["daily"][0].to<JsonObject>();
+    OWM_DAILY_FIELDS(OWM_FILTER_FIELD, OWM_FILTER_1H_FIELD)
+  }
 #if !DISPLAY_ALERTS
   filter["alerts"]   = false;
 #else
@@ -61,71 +161,21 @@ DeserializationError deserializeOneCall(WiFiClient &json,
     return error;
   }
 
-  r.lat             = doc["lat"]            .as<float>();
-  r.lon             = doc["lon"]            .as<float>();
-  r.timezone        = doc["timezone"]       .as<const char *>();
-  r.timezone_offset = doc["timezone_offset"].as<int>();
-
-  JsonObject current = doc["current"];
-  r.current.dt         = current["dt"]        .as<int64_t>();
-  r.current.sunrise    = current["sunrise"]   .as<int64_t>();
-  r.current.sunset     = current["sunset"]    .as<int64_t>();
-  r.current.temp       = current["temp"]      .as<float>();
-  r.current.feels_like = current["feels_like"].as<float>();
-  r.current.pressure   = current["pressure"]  .as<int>();
-  r.current.humidity   = current["humidity"]  .as<int>();
-  r.current.dew_point  = current["dew_point"] .as<float>();
-  r.current.clouds     = current["clouds"]    .as<int>();
-  r.current.uvi        = current["uvi"]       .as<float>();
-  r.current.visibility = current["visibility"].as<int>();
-  r.current.wind_speed = current["wind_speed"].as<float>();
-  r.current.wind_gust  = current["wind_gust"] .as<float>();
-  r.current.wind_deg   = current["wind_deg"]  .as<int>();
-  r.current.rain_1h    = current["rain"]["1h"].as<float>();
-  r.current.snow_1h    = current["snow"]["1h"].as<float>();
-  JsonObject current_weather = current["weather"][0];
-  r.current.weather.id          = current_weather["id"]         .as<int>();
-  r.current.weather.main        = current_weather["main"]       .as<const char *>();
-  r.current.weather.description = current_weather["description"].as<const char *>();
-  r.current.weather.icon        = current_weather["icon"]       .as<const char *>();
+  {
+    JsonObject src = doc["current"];
+    owm_current_t &dst = r.current;
+    dst = {};
+    OWM_CURRENT_FIELDS(OWM_DOM_FIELD, OWM_DOM_1H_FIELD)
+  }
 
   // minutely forecast is currently unused
-  // i = 0;
-  // for (JsonObject minutely : doc["minutely"].as<JsonArray>())
-  // {
-  //   r.minutely[i].dt            = minutely["dt"]           .as<int64_t>();
-  //   r.minutely[i].precipitation = minutely["precipitation"].as<float>();
-
-  //   if (i == OWM_NUM_MINUTELY - 1)
-  //   {
-  //     break;
-  //   }
-  //   ++i;
-  // }
 
   i = 0;
-  for (JsonObject hourly : doc["hourly"].as<JsonArray>())
-  {
-    r.hourly[i].dt         = hourly["dt"]        .as<int64_t>();
-    r.hourly[i].temp       = hourly["temp"]      .as<float>();
-    r.hourly[i].feels_like = hourly["feels_like"].as<float>();
-    r.hourly[i].pressure   = hourly["pressure"]  .as<int>();
-    r.hourly[i].humidity   = hourly["humidity"]  .as<int>();
-    r.hourly[i].dew_point  = hourly["dew_point"] .as<float>();
-    r.hourly[i].clouds     = hourly["clouds"]    .as<int>();
-    r.hourly[i].uvi        = hourly["uvi"]       .as<float>();
-    r.hourly[i].visibility = hourly["visibility"].as<int>();
-    r.hourly[i].wind_speed = hourly["wind_speed"].as<float>();
-    r.hourly[i].wind_gust  = hourly["wind_gust"] .as<float>();
-    r.hourly[i].wind_deg   = hourly["wind_deg"]  .as<int>();
-    r.hourly[i].pop        = hourly["pop"]       .as<float>();
-    r.hourly[i].rain_1h    = hourly["rain"]["1h"].as<float>();
-    r.hourly[i].snow_1h    = hourly["snow"]["1h"].as<float>();
-    JsonObject hourly_weather = hourly["weather"][0];
-    r.hourly[i].weather.id          = hourly_weather["id"]         .as<int>();
-    r.hourly[i].weather.main        = hourly_weather["main"]       .as<const char *>();
-    r.hourly[i].weather.description = hourly_weather["description"].as<const char *>();
-    r.hourly[i].weather.icon        = hourly_weather["icon"]       .as<const char *>();
+  for (JsonObject src : doc["hourly"].as<JsonArray>())
+  {
+    owm_hourly_t &dst = r.hourly[i];
+    dst = {};
+    OWM_HOURLY_FIELDS(OWM_DOM_FIELD, OWM_DOM_1H_FIELD)
 
     if (i == OWM_NUM_HOURLY - 1)
     {
@@ -135,43 +185,11 @@ DeserializationError deserializeOneCall(WiFiClient &json,
   }
 
   i = 0;
-  for (JsonObject daily : doc["daily"].as<JsonArray>())
-  {
-    r.daily[i].dt         = daily["dt"]        .as<int64_t>();
-    r.daily[i].sunrise    = daily["sunrise"]   .as<int64_t>();
-    r.daily[i].sunset     = daily["sunset"]    .as<int64_t>();
-    r.daily[i].moonrise   = daily["moonrise"]  .as<int64_t>();
-    r.daily[i].moonset    = daily["moonset"]   .as<int64_t>();
-    r.daily[i].moon_phase = daily["moon_phase"].as<float>();
-    JsonObject daily_temp = daily["temp"];
-    r.daily[i].temp.morn  = daily_temp["morn"] .as<float>();
-    r.daily[i].temp.day   = daily_temp["day"]  .as<float>();
-    r.daily[i].temp.eve   = daily_temp["eve"]  .as<float>();
-    r.daily[i].temp.night = daily_temp["night"].as<float>();
-    r.daily[i].temp.min   = daily_temp["min"]  .as<float>();
-    r.daily[i].temp.max   = daily_temp["max"]  .as<float>();
-    JsonObject daily_feels_like = daily["feels_like"];
-    r.daily[i].feels_like.morn  = daily_feels_like["morn"] .as<float>();
-    r.daily[i].feels_like.day   = daily_feels_like["day"]  .as<float>();
-    r.daily[i].feels_like.eve   = daily_feels_like["eve"]  .as<float>();
-    r.daily[i].feels_like.night = daily_feels_like["night"].as<float>();
-    r.daily[i].pressure   = daily["pressure"]  .as<int>();
-    r.daily[i].humidity   = daily["humidity"]  .as<int>();
-    r.daily[i].dew_point  = daily["dew_point"] .as<float>();
-    r.daily[i].clouds     = daily["clouds"]    .as<int>();
-    r.daily[i].uvi        = daily["uvi"]       .as<float>();
-    r.daily[i].visibility = daily["visibility"].as<int>();
-    r.daily[i].wind_speed = daily["wind_speed"].as<float>();
-    r.daily[i].wind_gust  = daily["wind_gust"] .as<float>();
-    r.daily[i].wind_deg   = daily["wind_deg"]  .as<int>();
-    r.daily[i].pop        = daily["pop"]       .as<float>();
-    r.daily[i].rain       = daily["rain"]      .as<float>();
-    r.daily[i].snow       = daily["snow"]      .as<float>();
-    JsonObject daily_weather = daily["weather"][0];
-    r.daily[i].weather.id          = daily_weather["id"]         .as<int>();
-    r.daily[i].weather.main        = daily_weather["main"]       .as<const char *>();
-    r.daily[i].weather.description = daily_weather["description"].as<const char *>();
-    r.daily[i].weather.icon        = daily_weather["icon"]       .as<const char *>();
+  for (JsonObject src : doc["daily"].as<JsonArray>())
+  {
+    owm_daily_t &dst = r.daily[i];
+    dst = {};
+    OWM_DAILY_FIELDS(OWM_DOM_FIELD, OWM_DOM_1H_FIELD)
 
     if (i == OWM_NUM_DAILY - 1)
     {
@@ -180,38 +198,366 @@ DeserializationError deserializeOneCall(WiFiClient &json,
     ++i;
   }
 
+  r.alerts = {};
 #if DISPLAY_ALERTS
-  i = 0;
   for (JsonObject alerts : doc["alerts"].as<JsonArray>())
   {
-    owm_alerts_t new_alert = {};
-    // new_alert.sender_name = alerts["sender_name"].as<const char *>();
-    new_alert.event       = alerts["event"]      .as<const char *>();
+    if (r.alerts.count == OWM_NUM_ALERTS)
+    {
+      ++r.alerts.dropped;
+      continue;
+    }
+    owm_alerts_t &new_alert = r.alerts.alert[r.alerts.count++];
+    new_alert = {};
+    // sender_name and description are not stored
+    setAlertText(new_alert.event, sizeof(new_alert.event),
+                 alerts["event"].as<const char *>(),
+                 r.alerts.truncatedEvents);
     new_alert.start       = alerts["start"]      .as<int64_t>();
     new_alert.end         = alerts["end"]        .as<int64_t>();
-    // new_alert.description = alerts["description"].as<const char *>();
-    new_alert.tags        = alerts["tags"][0]    .as<const char *>();
-    r.alerts.push_back(new_alert);
+    setAlertText(new_alert.tags, sizeof(new_alert.tags),
+                 alerts["tags"][0].as<const char *>(),
+                 r.alerts.truncatedTags);
+  }
+#endif
+
+  return error;
+} // end deserializeOneCall
 
-    if (i == OWM_NUM_ALERTS - 1)
+/* Reads the "weather" array of a current/hourly/daily entry. Only the first
+ * element is kept, matching weather[0] in deserializeOneCall.
+ */
+static bool streamWeather(JsonStreamReader &rd, owm_weather_t &w)
+{
+  char buf[JSON_STREAM_TOKEN_SIZE];
+  return jsonStreamForEachElement(rd, [&](int i) {
+    if (i != 0)
     {
-      break;
+      return rd.skipValue();
     }
-    ++i;
+    return jsonStreamForEachMember(rd, [&](const char *key) {
+      if      (!strcmp(key, "id"))   {w.id = rd.readInt();}
+      else if (!strcmp(key, "icon")) {rd.readString(buf, sizeof(buf));
+                                      setWeatherIcon(w, buf);}
+      else    {return rd.skipValue();}
+      return rd.error() == DeserializationError::Ok;
+    });
+  });
+} // end streamWeather
+
+/* Reads the "1h" member of a current/hourly "rain" or "snow" object.
+ */
+static bool stream1h(JsonStreamReader &rd, float &v)
+{
+  return jsonStreamForEachMember(rd, [&](const char *key) {
+    if (!strcmp(key, "1h"))
+    {
+      v = rd.readFloat();
+      return rd.error() == DeserializationError::Ok;
+    }
+    return rd.skipValue();
+  });
+} // end stream1h
+
+static bool streamRead(JsonStreamReader &rd, float &v)
+{
+  v = rd.readFloat();
+  return rd.error() == DeserializationError::Ok;
+}
+
+static bool streamRead(JsonStreamReader &rd, int &v)
+{
+  v = rd.readInt();
+  return rd.error() == DeserializationError::Ok;
+}
+
+static bool streamRead(JsonStreamReader &rd, int64_t &v)
+{
+  v = rd.readInt64();
+  return rd.error() == DeserializationError::Ok;
+}
+
+static bool streamRead(JsonStreamReader &rd, owm_weather_t &v)
+{
+  return streamWeather(rd, v);
+}
+
+static bool streamRead(JsonStreamReader &rd, owm_temp_t &v)
+{
+  return jsonStreamForEachMember(rd, [&](const char *key) {
+#define OWM_STREAM_TEMP_FIELD(type, member, name)                              \
+    if (!strcmp(key, name)) {return streamRead(rd, v.member);}
+    OWM_TEMP_FIELDS(OWM_STREAM_TEMP_FIELD)
+#undef OWM_STREAM_TEMP_FIELD
+    return rd.skipValue();
+  });
+}
+
+// Expansions for the member loops of deserializeOneCallStream. key is the
+// member name just read and dst the destination struct.
+#define OWM_STREAM_FIELD(type, member, name)                                   \
+  if (!strcmp(key, name)) {return streamRead(rd, dst.member);}
+#define OWM_STREAM_1H_FIELD(member, name)                                      \
+  if (!strcmp(key, name)) {return stream1h(rd, dst.member);}
+
+// A result of readString() >= the size of an alert buffer flags every
+// truncation only while the buffers are no longer than the token buffer
+static_assert(OWM_ALERT_EVENT_LEN <= JSON_STREAM_TOKEN_SIZE
+              && OWM_ALERT_TAGS_LEN <= JSON_STREAM_TOKEN_SIZE,
+              "alert text buffers must not exceed JSON_STREAM_TOKEN_SIZE");
+
+/* Same result as deserializeOneCall, but values are copied into r as they are
+ * read off the stream instead of first building a filtered JsonDocument, so
+ * peak heap use no longer grows with the size of the response. Sections and
+ * fields that are not in the manifests are skipped unread.
+ *
+ * Reading stops as soon as every section that is drawn has been filled, so
+ * the caller should close the connection rather than drain it. If stats is
+ * not null, it is filled with how much of the response was read and skipped.
+ */
+DeserializationError deserializeOneCallStream(Stream &json,
+                                              owm_resp_onecall_t &r,
+                                              owm_parse_stats_t *stats)
+{
+#if DEBUG_LEVEL >= 1
+  unsigned long startMs = millis();
+#endif
+  JsonStreamReader rd(json);
+  bool haveCurrent = false;
+  int numHourly = 0;
+  int numDaily  = 0;
+#if DISPLAY_ALERTS
+  int numAlerts = 0;
+#endif
+  bool terminatedEarly = false;
+
+  r.alerts = {};
+
+  // The response is complete for our purposes once current, OWM_NUM_HOURLY
+  // hours, OWM_NUM_DAILY days and (if displayed) OWM_NUM_ALERTS alerts have
+  // been read. Returning false from a callback then stops the parse.
+  auto moreNeeded = [&]() {
+    terminatedEarly = haveCurrent
+                      && numHourly == OWM_NUM_HOURLY
+                      && numDaily  == OWM_NUM_DAILY
+#if DISPLAY_ALERTS
+                      && numAlerts == OWM_NUM_ALERTS
+#endif
+                      ;
+    return !terminatedEarly;
+  };
+
+  jsonStreamForEachMember(rd, [&](const char *key) {
+    if (!strcmp(key, "current"))
+    {
+      owm_current_t &dst = r.current;
+      dst = {};
+      haveCurrent = jsonStreamForEachMember(rd, [&](const char *key) {
+        OWM_CURRENT_FIELDS(OWM_STREAM_FIELD, OWM_STREAM_1H_FIELD)
+        return rd.skipValue();
+      });
+      return haveCurrent && moreNeeded();
+    }
+    else if (!strcmp(key, "hourly"))
+    {
+      return jsonStreamForEachElement(rd, [&](int i) {
+        if (i >= OWM_NUM_HOURLY)
+        {
+          return rd.skipValue();
+        }
+        owm_hourly_t &dst = r.hourly[i];
+        dst = {};
+        bool ok = jsonStreamForEachMember(rd, [&](const char *key) {
+          OWM_HOURLY_FIELDS(OWM_STREAM_FIELD, OWM_STREAM_1H_FIELD)
+          return rd.skipValue();
+        });
+        numHourly = i + 1;
+        return ok && moreNeeded();
+      });
+    }
+    else if (!strcmp(key, "daily"))
+    {
+      return jsonStreamForEachElement(rd, [&](int i) {
+        if (i >= OWM_NUM_DAILY)
+        {
+          return rd.skipValue();
+        }
+        owm_daily_t &dst = r.daily[i];
+        dst = {};
+        bool ok = jsonStreamForEachMember(rd, [&](const char *key) {
+          OWM_DAILY_FIELDS(OWM_STREAM_FIELD, OWM_STREAM_1H_FIELD)
+          return rd.skipValue();
+        });
+        numDaily = i + 1;
+        return ok && moreNeeded();
+      });
+    }
+#if DISPLAY_ALERTS
+    else if (!strcmp(key, "alerts"))
+    {
+      return jsonStreamForEachElement(rd, [&](int i) {
+        if (i >= OWM_NUM_ALERTS)
+        {
+          ++r.alerts.dropped;
+          return rd.skipValue();
+        }
+        // description can be very long so it is skipped along with
+        // sender_name, and only the first tag is kept
+        owm_alerts_t &new_alert = r.alerts.alert[r.alerts.count++];
+        bool ok = jsonStreamForEachMember(rd, [&](const char *key) {
+          if (!strcmp(key, "event"))
+          {
+            if (rd.readString(new_alert.event, sizeof(new_alert.event))
+                >= sizeof(new_alert.event))
+            {
+              ++r.alerts.truncatedEvents;
+            }
+          }
+          else if (!strcmp(key, "start")) {new_alert.start = rd.readInt64();}
+          else if (!strcmp(key, "end"))   {new_alert.end   = rd.readInt64();}
+          else if (!strcmp(key, "tags"))
+          {
+            return jsonStreamForEachElement(rd, [&](int j) {
+              if (j == 0)
+              {
+                if (rd.readString(new_alert.tags, sizeof(new_alert.tags))
+                    >= sizeof(new_alert.tags))
+                {
+                  ++r.alerts.truncatedTags;
+                }
+                return rd.error() == DeserializationError::Ok;
+              }
+              return rd.skipValue();
+            });
+          }
+          else    {return rd.skipValue();}
+          return rd.error() == DeserializationError::Ok;
+        });
+        numAlerts = i + 1;
+        return ok && moreNeeded();
+      });
+    }
+#endif
+    return rd.skipValue();
+  });
+
+  if (stats != nullptr)
+  {
+    stats->bytesRead       = rd.bytesRead();
+    stats->bytesSkipped    = rd.bytesSkipped();
+    stats->terminatedEarly = terminatedEarly;
   }
+#if DEBUG_LEVEL >= 1
+  Serial.println("[debug] deserializeOneCallStream: "
+                 + String(rd.bytesRead()) + "B read, "
+                 + String(rd.bytesSkipped()) + "B skipped, "
+                 + String(numHourly) + " hourly, "
+                 + String(numDaily) + " daily, "
+                 + (terminatedEarly ? "stopped early, " : "")
+                 + String(millis() - startMs) + "ms");
 #endif
+  return DeserializationError(rd.error());
+} // end deserializeOneCallStream
 
-  return error;
-} // end deserializeOneCall
+// JSON keys of the "components" object, indexed by owm_pollutant_t
+static const char *POLLUTANT_KEYS[OWM_NUM_POLLUTANTS] = {
+  "co", "nh3", "no", "no2", "o3", "so2", "pm10", "pm2_5"
+};
+
+const int OWM_AQI_WINDOW_HOURS[OWM_NUM_AQI_WINDOWS] = {1, 3, 4, 8, 24};
+
+/* Returns a bit mask (1 << owm_pollutant_t) of the pollutants averaged by the
+ * given scale. This must list every pollutant getAQI() uses for that scale.
+ */
+static uint8_t getAQIPollutants(aqi_scale_t scale)
+{
+  const uint8_t co    = 1 << OWM_CO;
+  const uint8_t nh3   = 1 << OWM_NH3;
+  const uint8_t no2   = 1 << OWM_NO2;
+  const uint8_t o3    = 1 << OWM_O3;
+  const uint8_t so2   = 1 << OWM_SO2;
+  const uint8_t pm10  = 1 << OWM_PM10;
+  const uint8_t pm2_5 = 1 << OWM_PM2_5;
+  switch (scale)
+  {
+  case CANADA_AQHI:         return no2 | o3 | pm2_5;
+  case EUROPEAN_UNION_CAQI: return no2 | o3 | pm10 | pm2_5;
+  case HONG_KONG_AQHI:
+  case UNITED_KINGDOM_DAQI: return no2 | o3 | so2 | pm10 | pm2_5;
+  case INDIA_AQI:           return co | nh3 | no2 | o3 | so2 | pm10 | pm2_5;
+  case AUSTRALIA_AQI:
+  case CHINA_AQI:
+  case SINGAPORE_PSI:
+  case SOUTH_KOREA_CAI:
+  case UNITED_STATES_AQI:
+  default:                  return co | no2 | o3 | so2 | pm10 | pm2_5;
+  }
+} // end getAQIPollutants
+
+/* Clears r and assigns a conc slot to each pollutant AQI_SCALE needs.
+ */
+static void resetAirPollution(owm_resp_air_pollution_t &r)
+{
+  r = {};
+  const uint8_t tracked = getAQIPollutants(AQI_SCALE);
+  int8_t n = 0;
+  for (int p = 0; p < OWM_NUM_POLLUTANTS; ++p)
+  {
+    r.slot[p] = (tracked & (1 << p)) && n < OWM_NUM_AQI_POLLUTANTS ? n++ : -1;
+  }
+} // end resetAirPollution
+
+/* Folds one hourly sample (oldest first) into the running window sums.
+ * conc is indexed by owm_pollutant_t; untracked pollutants are ignored.
+ */
+static void addAirPollutionSample(owm_resp_air_pollution_t &r,
+                                  const float conc[OWM_NUM_POLLUTANTS])
+{
+  const int head = r.samples % OWM_NUM_AIR_POLLUTION;
+  for (int p = 0; p < OWM_NUM_POLLUTANTS; ++p)
+  {
+    if (r.slot[p] < 0)
+    {
+      continue;
+    }
+    owm_conc_window_t &w = r.conc[r.slot[p]];
+    for (int k = 0; k < OWM_NUM_AQI_WINDOWS; ++k)
+    {
+      const int hours = OWM_AQI_WINDOW_HOURS[k];
+      if (r.samples >= hours)
+      {
+        // drop the sample that is now more than hours old
+        w.sum[k] -= w.ring[(r.samples - hours) % OWM_NUM_AIR_POLLUTION];
+      }
+      w.sum[k] += conc[p];
+    }
+    w.ring[head] = conc[p];
+  }
+  ++r.samples;
+} // end addAirPollutionSample
 
-DeserializationError deserializeAirQuality(WiFiClient &json,
+DeserializationError deserializeAirQuality(Stream &json,
                                            owm_resp_air_pollution_t &r)
 {
-  int i = 0;
+  resetAirPollution(r);
+
+  JsonDocument filter;
+  filter["coord"] = true;
+  JsonObject f = filter["list"][0].to<JsonObject>();
+  f["dt"]          = true;
+  f["main"]["aqi"] = true;
+  for (int p = 0; p < OWM_NUM_POLLUTANTS; ++p)
+  {
+    if (r.slot[p] >= 0)
+    {
+      f["components"][POLLUTANT_KEYS[p]] = true;
+    }
+  }
 
   JsonDocument doc;
 
-  DeserializationError error = deserializeJson(doc, json);
+  DeserializationError error = deserializeJson(doc, json,
+                                         DeserializationOption::Filter(filter));
 #if DEBUG_LEVEL >= 1
   Serial.println("[debug] doc.overflowed() : "
                  + String(doc.overflowed()));
@@ -228,28 +574,106 @@ DeserializationError deserializeAirQuality(WiFiClient &json,
 
   for (JsonObject list : doc["list"].as<JsonArray>())
   {
-
-    r.main_aqi[i] = list["main"]["aqi"].as<int>();
-
     JsonObject list_components = list["components"];
-    r.components.co[i]    = list_components["co"].as<float>();
-    r.components.no[i]    = list_components["no"].as<float>();
-    r.components.no2[i]   = list_components["no2"].as<float>();
-    r.components.o3[i]    = list_components["o3"].as<float>();
-    r.components.so2[i]   = list_components["so2"].as<float>();
-    r.components.pm2_5[i] = list_components["pm2_5"].as<float>();
-    r.components.pm10[i]  = list_components["pm10"].as<float>();
-    r.components.nh3[i]   = list_components["nh3"].as<float>();
-
-    r.dt[i] = list["dt"].as<int64_t>();
-
-    if (i == OWM_NUM_AIR_POLLUTION - 1)
+    float conc[OWM_NUM_POLLUTANTS] = {};
+    for (int p = 0; p < OWM_NUM_POLLUTANTS; ++p)
     {
-      break;
+      conc[p] = list_components[POLLUTANT_KEYS[p]].as<float>();
     }
-    ++i;
+    addAirPollutionSample(r, conc);
+    r.main_aqi = list["main"]["aqi"].as<int>();
+    r.dt       = list["dt"].as<int64_t>();
   }
 
   return error;
 } // end deserializeAirQuality
 
+/* Same result as deserializeAirQuality, but each list element is folded into
+ * the running averages as it is read off the stream, so memory use does not
+ * depend on how many hours of history are requested. Pollutants that
+ * AQI_SCALE does not use are skipped unread.
+ */
+DeserializationError deserializeAirQualityStream(Stream &json,
+                                           owm_resp_air_pollution_t &r,
+                                           owm_parse_stats_t *stats)
+{
+#if DEBUG_LEVEL >= 1
+  unsigned long startMs = millis();
+#endif
+  JsonStreamReader rd(json);
+  resetAirPollution(r);
+
+  jsonStreamForEachMember(rd, [&](const char *key) {
+    if (!strcmp(key, "coord"))
+    {
+      return jsonStreamForEachMember(rd, [&](const char *key) {
+        if      (!strcmp(key, "lat")) {r.coord.lat = rd.readFloat();}
+        else if (!strcmp(key, "lon")) {r.coord.lon = rd.readFloat();}
+        else    {return rd.skipValue();}
+        return rd.error() == DeserializationError::Ok;
+      });
+    }
+    else if (!strcmp(key, "list"))
+    {
+      return jsonStreamForEachElement(rd, [&](int) {
+        float   conc[OWM_NUM_POLLUTANTS] = {};
+        int     aqi = 0;
+        int64_t dt  = 0;
+        bool ok = jsonStreamForEachMember(rd, [&](const char *key) {
+          if (!strcmp(key, "dt"))
+          {
+            dt = rd.readInt64();
+          }
+          else if (!strcmp(key, "main"))
+          {
+            return jsonStreamForEachMember(rd, [&](const char *key) {
+              if (!strcmp(key, "aqi"))
+              {
+                aqi = rd.readInt();
+                return rd.error() == DeserializationError::Ok;
+              }
+              return rd.skipValue();
+            });
+          }
+          else if (!strcmp(key, "components"))
+          {
+            return jsonStreamForEachMember(rd, [&](const char *key) {
+              for (int p = 0; p < OWM_NUM_POLLUTANTS; ++p)
+              {
+                if (r.slot[p] >= 0 && !strcmp(key, POLLUTANT_KEYS[p]))
+                {
+                  conc[p] = rd.readFloat();
+                  return rd.error() == DeserializationError::Ok;
+                }
+              }
+              return rd.skipValue();
+            });
+          }
+          else    {return rd.skipValue();}
+          return rd.error() == DeserializationError::Ok;
+        });
+        addAirPollutionSample(r, conc);
+        r.main_aqi = aqi;
+        r.dt       = dt;
+        return ok;
+      });
+    }
+    return rd.skipValue();
+  });
+
+  if (stats != nullptr)
+  {
+    stats->bytesRead       = rd.bytesRead();
+    stats->bytesSkipped    = rd.bytesSkipped();
+    stats->terminatedEarly = false;
+  }
+#if DEBUG_LEVEL >= 1
+  Serial.println("[debug] deserializeAirQualityStream: "
+                 + String(rd.bytesRead()) + "B read, "
+                 + String(rd.bytesSkipped()) + "B skipped, "
+                 + String(r.samples) + " samples, "
+                 + String(millis() - startMs) + "ms");
+#endif
+  return DeserializationError(rd.error());
+} // end deserializeAirQualityStream
+
@@ -21,11 +21,16 @@
 
 // arduino/esp32 libraries
 #include <Arduino.h>
+#include <esp_attr.h>
+#include <esp_netif.h>
+#include <esp_netif_net_stack.h>
 #include <esp_sntp.h>
 #include <HTTPClient.h>
 #include <SPI.h>
 #include <time.h>
 #include <WiFi.h>
+#include <lwip/dhcp.h>
+#include <lwip/netif.h>
 
 // additional libraries
 #include <Adafruit_BusIO_Register.h>
@@ -38,40 +43,184 @@
 #include "client_utils.h"
 #include "config.h"
 #include "display_utils.h"
+#include "http_connection.h"
+#include "inflate_stream.h"
+#include "parse_profile.h"
 #include "renderer.h"
+#include "request_scheduler.h"
+#include "time_keeper.h"
+#include "wake_profile.h"
 #ifndef USE_HTTP
   #include <WiFiClientSecure.h>
 #endif
 
-#ifdef USE_HTTP
-  static const uint16_t OWM_PORT = 80;
-#else
-  static const uint16_t OWM_PORT = 443;
-#endif
+/*
+ * Access point and DHCP lease of the last successful connection. Kept across
+ * deep sleep so the next wake can join the access point directly on its
+ * channel, without a scan, and reuse the address without DHCP.
+ */
+typedef struct wifi_cache
+{
+  uint8_t  valid;
+  uint8_t  bssid[6];
+  uint8_t  channel;
+  uint32_t ip;
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns1;
+  uint32_t dns2;
+  int64_t  renewAt;         // Unix, UTC. The address is reused until then.
+} wifi_cache_t;
+
+static RTC_DATA_ATTR wifi_cache_t wifiCache;
+static wifi_connect_stats_t wifiStats;
+static volatile unsigned long wifiAssocAt;
+static unsigned long radioOnAt; // millis() WiFi was started, 0 while off
+
+static void onWiFiAssociated(arduino_event_id_t event,
+                             arduino_event_info_t info)
+{
+  if (wifiAssocAt == 0)
+  {
+    wifiAssocAt = millis();
+  }
+} // end onWiFiAssociated
+
+/* Returns the seconds until the current DHCP lease should be renewed (T1), or
+ * 0 if unknown.
+ */
+static uint32_t getDHCPRenewSeconds()
+{
+  esp_netif_t *sta = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+  struct netif *lwip = sta ? static_cast<struct netif *>(
+                                 esp_netif_get_netif_impl(sta))
+                           : nullptr;
+  struct dhcp *dhcp = lwip ? netif_dhcp_data(lwip) : nullptr;
+  if (dhcp == nullptr)
+  {
+    return 0;
+  }
+  return dhcp->offered_t1_renew ? dhcp->offered_t1_renew
+                                : dhcp->offered_t0_lease / 2;
+} // end getDHCPRenewSeconds
+
+/* Remembers the current connection for the next wake. The IP address is only
+ * reused while the DHCP lease would not yet need renewing, and only if the
+ * system time is valid to tell.
+ */
+static void saveWiFiCache(bool cachedIP)
+{
+  wifiCache.valid = false;
+  memcpy(wifiCache.bssid, WiFi.BSSID(), sizeof(wifiCache.bssid));
+  wifiCache.channel = WiFi.channel();
+  if (!cachedIP)
+  {
+    wifiCache.ip      = WiFi.localIP();
+    wifiCache.gateway = WiFi.gatewayIP();
+    wifiCache.subnet  = WiFi.subnetMask();
+    wifiCache.dns1    = WiFi.dnsIP(0);
+    wifiCache.dns2    = WiFi.dnsIP(1);
+    time_t now = time(nullptr);
+    uint32_t renew = getDHCPRenewSeconds();
+    // before the first SNTP sync the time is 1970
+    wifiCache.renewAt = (now > 1600000000 && renew > 0) ? now + renew : 0;
+  }
+  wifiCache.valid = true;
+} // end saveWiFiCache
+
+/* Forgets the cached connection, so the next startWiFi() scans and uses DHCP.
+ * Called when the network turns out to be unusable after connecting with the
+ * cached address.
+ */
+void forgetWiFiCache()
+{
+  wifiCache = {};
+} // end forgetWiFiCache
+
+const wifi_connect_stats_t &getWiFiConnectStats()
+{
+  return wifiStats;
+} // end getWiFiConnectStats
+
+/* Waits up to timeout ms for WiFi.begin() to connect.
+ */
+static wl_status_t waitForWiFi(unsigned long timeout)
+{
+  unsigned long start = millis();
+  wl_status_t connection_status = WiFi.status();
+  while ((connection_status != WL_CONNECTED) && (millis() - start < timeout))
+  {
+    Serial.print(".");
+    delay(50);
+    connection_status = WiFi.status();
+  }
+  Serial.println();
+  return connection_status;
+} // end waitForWiFi
 
 /* Power-on and connect WiFi.
  * Takes int parameter to store WiFi RSSI, or "Received Signal Strength
  * Indicator"
  *
+ * If a previous wake connected, its access point is joined directly on its
+ * channel and its IP address is reused while the lease is fresh. A full scan
+ * and DHCP follow only if that fails.
+ *
  * Returns WiFi status.
  */
 wl_status_t startWiFi(int &wifiRSSI)
 {
+  unsigned long start = millis();
+  wifiStats = {};
+  radioOnAt = start;
+  wifi_event_id_t assocEvent = WiFi.onEvent(onWiFiAssociated,
+                                            ARDUINO_EVENT_WIFI_STA_CONNECTED);
   WiFi.mode(WIFI_STA);
   Serial.printf("%s '%s'", TXT_CONNECTING_TO, WIFI_SSID);
-  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
 
-  // timeout if WiFi does not connect in WIFI_TIMEOUT ms from now
-  unsigned long timeout = millis() + WIFI_TIMEOUT;
-  wl_status_t connection_status = WiFi.status();
+  wl_status_t connection_status = WL_DISCONNECTED;
+  unsigned long attemptStart = start;
+  if (wifiCache.valid)
+  {
+    wifiStats.fastConnect = true;
+    wifiStats.cachedIP = static_cast<int64_t>(time(nullptr))
+                         < wifiCache.renewAt;
+    if (wifiStats.cachedIP)
+    {
+      WiFi.config(IPAddress(wifiCache.ip), IPAddress(wifiCache.gateway),
+                  IPAddress(wifiCache.subnet), IPAddress(wifiCache.dns1),
+                  IPAddress(wifiCache.dns2));
+    }
+    wifiAssocAt = 0;
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD, wifiCache.channel, wifiCache.bssid);
+    connection_status = waitForWiFi(WIFI_FAST_CONNECT_TIMEOUT);
 
-  while ((connection_status != WL_CONNECTED) && (millis() < timeout))
+    if (connection_status != WL_CONNECTED)
+    {
+      Serial.print("Fast connect failed, scanning");
+      forgetWiFiCache();
+      wifiStats = {};
+      wifiStats.fastFailed = true;
+      WiFi.disconnect();
+      // back to DHCP
+      WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+    }
+  }
+  if (connection_status != WL_CONNECTED)
   {
-    Serial.print(".");
-    delay(50);
-    connection_status = WiFi.status();
+    attemptStart = millis();
+    wifiAssocAt = 0;
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+    connection_status = waitForWiFi(WIFI_TIMEOUT);
   }
-  Serial.println();
+  wifiStats.ipMs = millis() - attemptStart;
+  wifiStats.assocMs = wifiAssocAt ? wifiAssocAt - attemptStart
+                                  : wifiStats.ipMs;
+  WiFi.removeEvent(assocEvent);
+  // a failed fast connect counts towards association
+  addWakePhase(WAKE_PHASE_WIFI_ASSOC,
+               wifiStats.assocMs + (attemptStart - start));
+  addWakePhase(WAKE_PHASE_DHCP, wifiStats.ipMs - wifiStats.assocMs);
 
   if (connection_status == WL_CONNECTED)
   {
@@ -82,16 +231,20 @@ wl_status_t startWiFi(int &wifiRSSI)
     
     // Wait for DNS to be ready - DHCP provides IP but DNS may lag behind
     // This prevents DNS resolution failures on first API calls
-    Serial.print("Waiting for DNS");
-    int dnsWaitAttempts = 0;
-    const int maxDnsWait = 20; // 2 seconds max
-    while (WiFi.dnsIP() == IPAddress(0, 0, 0, 0) && dnsWaitAttempts < maxDnsWait)
+    if (WiFi.dnsIP() == IPAddress(0, 0, 0, 0))
     {
-      Serial.print(".");
-      delay(100);
-      dnsWaitAttempts++;
+      Serial.print("Waiting for DNS");
+      int dnsWaitAttempts = 0;
+      const int maxDnsWait = 20; // 2 seconds max
+      while (WiFi.dnsIP() == IPAddress(0, 0, 0, 0)
+             && dnsWaitAttempts < maxDnsWait)
+      {
+        Serial.print(".");
+        delay(100);
+        dnsWaitAttempts++;
+      }
+      Serial.println();
     }
-    Serial.println();
     
     if (WiFi.dnsIP() == IPAddress(0, 0, 0, 0))
     {
@@ -101,15 +254,26 @@ wl_status_t startWiFi(int &wifiRSSI)
                   IPAddress(8, 8, 8, 8), IPAddress(8, 8, 4, 4));
       Serial.println("DNS (fallback): " + WiFi.dnsIP().toString());
     }
-    
-    // Additional stabilization delay for network stack
-    delay(500);
+    wifiStats.dnsMs = millis() - attemptStart;
+    saveWiFiCache(wifiStats.cachedIP);
     Serial.println("Network ready");
   }
   else
   {
     Serial.printf("%s '%s'\n", TXT_COULD_NOT_CONNECT_TO, WIFI_SSID);
   }
+  wifiStats.totalMs = millis() - start;
+#if DEBUG_LEVEL >= 1
+  Serial.printf("[debug] WiFi connect  : %s%s%s assoc %lums, ip %lums, "
+                "dns %lums, total %lums\n",
+                wifiStats.fastConnect ? "fast" : "scan",
+                wifiStats.cachedIP ? ", cached IP" : "",
+                wifiStats.fastFailed ? ", fast failed" : "",
+                static_cast<unsigned long>(wifiStats.assocMs),
+                static_cast<unsigned long>(wifiStats.ipMs),
+                static_cast<unsigned long>(wifiStats.dnsMs),
+                static_cast<unsigned long>(wifiStats.totalMs));
+#endif
   return connection_status;
 } // startWiFi
 
@@ -119,6 +283,11 @@ void killWiFi()
 {
   WiFi.disconnect();
   WiFi.mode(WIFI_OFF);
+  if (radioOnAt)
+  {
+    addWakePhase(WAKE_PHASE_RADIO, millis() - radioOnAt);
+    radioOnAt = 0;
+  }
 } // killWiFi
 
 /* Prints the local time to serial monitor.
@@ -170,14 +339,10 @@ bool waitForSNTPSync(tm *timeInfo)
  *
  * Returns the HTTP Status Code.
  */
-#ifdef USE_HTTP
-  int getOWMonecall(WiFiClient &client, owm_resp_onecall_t &r)
-#else
-  int getOWMonecall(WiFiClientSecure &client, owm_resp_onecall_t &r)
-#endif
+int getOWMonecall(HttpConnection &owm, owm_resp_onecall_t &r)
 {
-  int attempts = 0;
-  bool rxSuccess = false;
+  unsigned long requestStart = millis();
+  request_schedule_t req;
   DeserializationError jsonErr = {};
   String uri = "/data/" + OWM_ONECALL_VERSION
                + "/onecall?lat=" + LAT + "&lon=" + LON + "&lang=" + OWM_LANG
@@ -196,37 +361,70 @@ bool waitForSNTPSync(tm *timeInfo)
   Serial.print(TXT_ATTEMPTING_HTTP_REQ);
   Serial.println(": " + sanitizedUri);
   int httpResponse = 0;
-  while (!rxSuccess && attempts < 3)
+  unsigned timeout;
+  beginRequest(req, "OneCall", 3, HTTP_CLIENT_TCP_TIMEOUT);
+  while ((timeout = nextAttempt(req)) > 0)
   {
     wl_status_t connection_status = WiFi.status();
     if (connection_status != WL_CONNECTED)
     {
       // -512 offset distinguishes these errors from httpClient errors
-      return -512 - static_cast<int>(connection_status);
+      httpResponse = -512 - static_cast<int>(connection_status);
+      endAttempt(req, httpResponse);
+      continue;
     }
 
-    HTTPClient http;
-    http.setConnectTimeout(HTTP_CLIENT_TCP_TIMEOUT); // default 5000ms
-    http.setTimeout(HTTP_CLIENT_TCP_TIMEOUT); // default 5000ms
-    http.begin(client, OWM_ENDPOINT, OWM_PORT, uri);
-    httpResponse = http.GET();
+    owm.setTimeout(timeout);
+    httpResponse = owm.get(uri);
+    if (httpResponse > 0)
+    {
+      disciplineClock(owm.http().header("Date"));
+    }
     if (httpResponse == HTTP_CODE_OK)
     {
-      jsonErr = deserializeOneCall(http.getStream(), r);
+      owm_parse_stats_t stats = {};
+#if DEBUG_LEVEL >= 1
+      CountingStream raw(owm.body());
+      parse_profile_t profile;
+      beginParseProfile(profile);
+#else
+      Stream &raw = owm.body();
+#endif
+      unsigned long parseStart = millis();
+      InflateStream in(raw, getResponseEncoding(owm.http()));
+      if (!in.begin())
+      {
+        jsonErr = DeserializationError::InvalidInput;
+      }
+      else
+      {
+#if OWM_STREAMING_PARSER
+        jsonErr = deserializeOneCallStream(in, r, &stats);
+#else
+        jsonErr = deserializeOneCall(in, r);
+#endif
+      }
+      addWakePhase(WAKE_PHASE_PARSE, millis() - parseStart);
+#if DEBUG_LEVEL >= 1
+      endParseProfile(profile, raw);
+      printParseProfile(OWM_STREAMING_PARSER ? "deserializeOneCallStream" : "deserializeOneCall",
+                        profile, jsonErr, stats);
+#endif
       if (jsonErr)
       {
         // -256 offset distinguishes these errors from httpClient errors
         httpResponse = -256 - static_cast<int>(jsonErr.code());
       }
-      rxSuccess = !jsonErr;
     }
-    client.stop();
-    http.end();
+    // The streaming parser stops reading once it has everything it needs,
+    // the rest of the response is skipped if that keeps the connection open.
+    owm.end();
     Serial.println("  " + String(httpResponse, DEC) + " "
                    + getHttpResponsePhrase(httpResponse));
-    ++attempts;
+    endAttempt(req, httpResponse);
   }
 
+  addWakePhase(WAKE_PHASE_HTTP_ONECALL, millis() - requestStart);
   return httpResponse;
 } // getOWMonecall
 
@@ -236,14 +434,10 @@ bool waitForSNTPSync(tm *timeInfo)
  *
  * Returns the HTTP Status Code.
  */
-#ifdef USE_HTTP
-  int getOWMairpollution(WiFiClient &client, owm_resp_air_pollution_t &r)
-#else
-  int getOWMairpollution(WiFiClientSecure &client, owm_resp_air_pollution_t &r)
-#endif
+int getOWMairpollution(HttpConnection &owm, owm_resp_air_pollution_t &r)
 {
-  int attempts = 0;
-  bool rxSuccess = false;
+  unsigned long requestStart = millis();
+  request_schedule_t req;
   DeserializationError jsonErr = {};
 
   // set start and end to appropriate values so that the last 24 hours of air
@@ -269,37 +463,64 @@ bool waitForSNTPSync(tm *timeInfo)
   Serial.print(TXT_ATTEMPTING_HTTP_REQ);
   Serial.println(": " + sanitizedUri);
   int httpResponse = 0;
-  while (!rxSuccess && attempts < 3)
+  unsigned timeout;
+  beginRequest(req, "Air Pollution", 3, HTTP_CLIENT_TCP_TIMEOUT);
+  while ((timeout = nextAttempt(req)) > 0)
   {
     wl_status_t connection_status = WiFi.status();
     if (connection_status != WL_CONNECTED)
     {
       // -512 offset distinguishes these errors from httpClient errors
-      return -512 - static_cast<int>(connection_status);
+      httpResponse = -512 - static_cast<int>(connection_status);
+      endAttempt(req, httpResponse);
+      continue;
     }
 
-    HTTPClient http;
-    http.setConnectTimeout(HTTP_CLIENT_TCP_TIMEOUT); // default 5000ms
-    http.setTimeout(HTTP_CLIENT_TCP_TIMEOUT); // default 5000ms
-    http.begin(client, OWM_ENDPOINT, OWM_PORT, uri);
-    httpResponse = http.GET();
+    owm.setTimeout(timeout);
+    httpResponse = owm.get(uri);
     if (httpResponse == HTTP_CODE_OK)
     {
-      jsonErr = deserializeAirQuality(http.getStream(), r);
+      owm_parse_stats_t stats = {};
+#if DEBUG_LEVEL >= 1
+      CountingStream raw(owm.body());
+      parse_profile_t profile;
+      beginParseProfile(profile);
+#else
+      Stream &raw = owm.body();
+#endif
+      unsigned long parseStart = millis();
+      InflateStream in(raw, getResponseEncoding(owm.http()));
+      if (!in.begin())
+      {
+        jsonErr = DeserializationError::InvalidInput;
+      }
+      else
+      {
+#if OWM_STREAMING_PARSER
+        jsonErr = deserializeAirQualityStream(in, r, &stats);
+#else
+        jsonErr = deserializeAirQuality(in, r);
+#endif
+      }
+      addWakePhase(WAKE_PHASE_PARSE, millis() - parseStart);
+#if DEBUG_LEVEL >= 1
+      endParseProfile(profile, raw);
+      printParseProfile(OWM_STREAMING_PARSER ? "deserializeAirQualityStream" : "deserializeAirQuality",
+                        profile, jsonErr, stats);
+#endif
       if (jsonErr)
       {
         // -256 offset to distinguishes these errors from httpClient errors
         httpResponse = -256 - static_cast<int>(jsonErr.code());
       }
-      rxSuccess = !jsonErr;
     }
-    client.stop();
-    http.end();
+    owm.end();
     Serial.println("  " + String(httpResponse, DEC) + " "
                    + getHttpResponsePhrase(httpResponse));
-    ++attempts;
+    endAttempt(req, httpResponse);
   }
 
+  addWakePhase(WAKE_PHASE_HTTP_AIR, millis() - requestStart);
   return httpResponse;
 } // getOWMairpollution
 
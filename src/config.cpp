@@ -9,6 +9,26 @@
 #include "config.h"
 #include "secrets.h" // Contains all sensitive configuration
 
+// Built with -D STANDIN_HOST (env:trmnl_og_standin), every request goes to the
+// stand-in servers of tools/standin/standin.py on that host instead, on their
+// default ports. SNTP still uses the NTP servers below.
+#ifdef STANDIN_HOST
+  #undef SECRET_OWM_ENDPOINT
+  #undef SECRET_OWM_PORT
+  #undef SECRET_HA_HOST
+  #undef SECRET_HA_PORT
+  #undef SECRET_MQTT_BROKER
+  #undef SECRET_MQTT_PORT
+  #undef SECRET_NEXTCLOUD_URL
+  #define SECRET_OWM_ENDPOINT  STANDIN_HOST
+  #define SECRET_OWM_PORT      8443
+  #define SECRET_HA_HOST       STANDIN_HOST
+  #define SECRET_HA_PORT       8123
+  #define SECRET_MQTT_BROKER   STANDIN_HOST
+  #define SECRET_MQTT_PORT     1883
+  #define SECRET_NEXTCLOUD_URL "https://" STANDIN_HOST ":8444/remote.php/dav/files/standin/"
+#endif
+
 // =============================================================================
 // TRMNL OG PIN DEFINITIONS
 // Based on TRMNL firmware pinout
@@ -54,17 +74,41 @@ const uint8_t BME_ADDRESS = 0x76;
 const char *WIFI_SSID = SECRET_WIFI_SSID;
 const char *WIFI_PASSWORD = SECRET_WIFI_PASSWORD;
 const unsigned long WIFI_TIMEOUT = 15000; // 15 seconds
+// Time allowed to rejoin the cached access point before scanning for the SSID
+const unsigned long WIFI_FAST_CONNECT_TIMEOUT = 3000; // 3 seconds
 
 // =============================================================================
 // HTTP CLIENT
 // =============================================================================
 const unsigned HTTP_CLIENT_TCP_TIMEOUT = 15000; // 15 seconds
+// Seconds a resolved host address is reused before DNS is queried again
+const long DNS_CACHE_TTL = 3600; // 1 hour
+// A wake must end within WAKE_BUDGET of starting, requests are given up in
+// time to leave WAKE_RENDER_RESERVE of it for drawing.
+const unsigned long WAKE_BUDGET = 30000; // 30 seconds
+const unsigned long WAKE_RENDER_RESERVE = 8000; // 8 seconds
+// Time the weather mode requests may overrun their deadline, e.g. to finish
+// parsing a response, before they are abandoned
+const unsigned long FETCH_GRACE = 3000; // 3 seconds
 
 // =============================================================================
 // OPENWEATHERMAP API
 // =============================================================================
 const String OWM_APIKEY = SECRET_OWM_APIKEY;
+// SECRET_OWM_ENDPOINT and SECRET_OWM_PORT, if defined, point the requests at
+// another server, e.g. a local stand-in for testing
+#ifdef SECRET_OWM_ENDPOINT
+const String OWM_ENDPOINT = SECRET_OWM_ENDPOINT;
+#else
 const String OWM_ENDPOINT = "api.openweathermap.org";
+#endif
+#if defined(SECRET_OWM_PORT)
+const uint16_t OWM_PORT = SECRET_OWM_PORT;
+#elif defined(USE_HTTP)
+const uint16_t OWM_PORT = 80;
+#else
+const uint16_t OWM_PORT = 443;
+#endif
 const String OWM_ONECALL_VERSION = "3.0";
 
 // =============================================================================
@@ -89,14 +133,27 @@ const char *REFRESH_TIME_FORMAT = "%d/%m %H:%M"; // 28/11 14:30
 const char *NTP_SERVER_1 = "pool.ntp.org";
 const char *NTP_SERVER_2 = "time.nist.gov";
 const unsigned long NTP_TIMEOUT = 20000; // 20 seconds
+// Between SNTP syncs the clock runs on the drift-corrected RTC, see
+// time_keeper.h
+const int TIME_SYNC_INTERVAL = 12; // Hours between SNTP syncs
+// Estimated clock error that makes an SNTP sync due earlier
+const unsigned long TIME_MAX_ERROR = 30000; // 30 seconds
 
 // =============================================================================
 // SLEEP SETTINGS
 // =============================================================================
+#ifdef STANDIN_HOST
+// short cycles around the clock, so a stand-in run collects wakes quickly
+const int SLEEP_DURATION = 2;    // Minutes between updates
+const int BED_TIME = 0;          // No extended sleep
+const int WAKE_TIME = 0;
+#else
 const int SLEEP_DURATION = 30;   // Minutes between updates
 const int BED_TIME = 23;         // Hour to start extended sleep (11 PM)
 const int WAKE_TIME = 6;         // Hour to resume normal updates (6 AM)
+#endif
 const int HOURLY_GRAPH_MAX = 24; // Hours to show in outlook graph
+const int SNAPSHOT_MAX_AGE = 60; // Minutes a button press redraws saved data
 
 // =============================================================================
 // BATTERY THRESHOLDS (millivolts)
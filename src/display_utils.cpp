@@ -16,6 +16,7 @@
  */
 
 #include <cmath>
+#include <cstring>
 #include <vector>
 #include <Arduino.h>
 #include <driver/adc.h>
@@ -196,66 +197,80 @@ void getRefreshTimeStr(String &s, bool timeSuccess, tm *timeInfo)
   return;
 } // end getRefreshTimeStr
 
-/* Takes a String and capitalizes the first letter of every word.
+/* Takes a string and capitalizes the first letter of every word.
  *
  * Ex:
  *   input   : "severe thunderstorm warning" or "SEVERE THUNDERSTORM WARNING"
  *   becomes : "Severe Thunderstorm Warning"
  */
-void toTitleCase(String &text)
+void toTitleCase(char *text)
 {
-  text.setCharAt(0, toUpperCase(text.charAt(0)));
+  if (text[0] == '\0')
+  {
+    return;
+  }
+  text[0] = toUpperCase(text[0]);
 
-  for (int i = 1; i < text.length(); ++i)
+  for (int i = 1; text[i] != '\0'; ++i)
   {
-    if (text.charAt(i - 1) == ' '
-     || text.charAt(i - 1) == '-'
-     || text.charAt(i - 1) == '(')
+    if (text[i - 1] == ' '
+     || text[i - 1] == '-'
+     || text[i - 1] == '(')
     {
-      text.setCharAt(i, toUpperCase(text.charAt(i)));
+      text[i] = toUpperCase(text[i]);
     }
     else
     {
-      text.setCharAt(i, toLowerCase(text.charAt(i)));
+      text[i] = toLowerCase(text[i]);
     }
   }
 
   return;
 } // end toTitleCase
 
-/* Takes a String and truncates at any of these characters ,.( and trims any
+/* Takes a string and truncates at any of these characters ,.( and trims any
  * trailing whitespace.
  *
  * Ex:
  *   input   : "Severe Thunderstorm Warning, (Starting At 10 Pm)"
  *   becomes : "Severe Thunderstorm Warning"
  */
-void truncateExtraAlertInfo(String &text)
+void truncateExtraAlertInfo(char *text)
 {
-  if (text.isEmpty())
+  if (text[0] == '\0')
   {
     return;
   }
 
   int i = 1;
   int lastChar = i;
-  while (i < text.length()
-    && text.charAt(i) != ','
-    && text.charAt(i) != '.'
-    && text.charAt(i) != '(')
+  while (text[i] != '\0'
+    && text[i] != ','
+    && text[i] != '.'
+    && text[i] != '(')
   {
-    if (text.charAt(i) != ' ')
+    if (text[i] != ' ')
     {
       lastChar = i + 1;
     }
     ++i;
   }
 
-  text = text.substring(0, lastChar);
+  text[lastChar] = '\0';
   return;
 } // end truncateExtraAlertInfo
 
-/* Returns the urgency of an event based by checking if the event String
+/* Lowercases a string in place.
+ */
+static void toLowerCaseStr(char *text)
+{
+  for (; *text != '\0'; ++text)
+  {
+    *text = toLowerCase(*text);
+  }
+} // end toLowerCaseStr
+
+/* Returns the urgency of an event based by checking if the event string
  * contains any indicator keywords.
  *
  * Urgency keywords are defined in config.h because they are very regional.
@@ -266,12 +281,12 @@ void truncateExtraAlertInfo(String &text)
  * is returned.
  * In the United States example, Watch = 0, Advisory = 1, Warning = 2
  */
-int eventUrgency(const String &event)
+int eventUrgency(const char *event)
 {
   int urgency_lvl = -1;
   for (int i = 0; i < ALERT_URGENCY.size(); ++i)
   {
-    if (event.indexOf(ALERT_URGENCY[i]) >= 0)
+    if (strstr(event, ALERT_URGENCY[i].c_str()) != nullptr)
     {
       urgency_lvl = i;
     }
@@ -280,7 +295,8 @@ int eventUrgency(const String &event)
 } // end eventUrgency
 
 /* This algorithm filters alerts from the API responses to be displayed by
- * marking the corresponding index in the ignore list.
+ * marking the corresponding index in the ignore list. ignore_list must hold
+ * alerts.count entries, all initially false.
  *
  * Background:
  * The display layout is setup to show up to 2 alerts, but alerts can be
@@ -312,37 +328,42 @@ int eventUrgency(const String &event)
  *
  * Truncate Extraneous Info (anything that follows a comma, period, or open
  *   parentheses)
+ *
+ * All of this is done in place in the alerts' own buffers.
  */
-void filterAlerts(std::vector<owm_alerts_t> &resp, int *ignore_list)
+void filterAlerts(owm_alert_list_t &alerts, bool *ignore_list)
 {
+  owm_alerts_t *resp = alerts.alert;
+  const int count = alerts.count;
+
   // Convert all event text and tags to lowercase.
-  for (auto &alert : resp)
+  for (int i = 0; i < count; ++i)
   {
-    alert.event.toLowerCase();
-    alert.tags.toLowerCase();
+    toLowerCaseStr(resp[i].event);
+    toLowerCaseStr(resp[i].tags);
   }
 
   // Deduplicate alerts with the same first tag. Keeping only the most urgent
   // alerts of each tag and alerts who's urgency cannot be determined.
-  for (int i = 0; i < resp.size(); ++i)
+  for (int i = 0; i < count; ++i)
   {
-    if (ignore_list[i] == 1)
+    if (ignore_list[i])
     {
       continue;
     }
-    if (resp[i].tags.isEmpty())
+    if (resp[i].tags[0] == '\0')
     {
       continue; // urgency can not be determined so it remains in the list
     }
 
-    for (int j = 0; j < resp.size(); ++j)
+    for (int j = 0; j < count; ++j)
     {
-      if (i != j && resp[i].tags == resp[j].tags)
+      if (i != j && !strcmp(resp[i].tags, resp[j].tags))
       {
         // comparing alerts of the same tag, removing the less urgent alert
         if (eventUrgency(resp[i].event) >= eventUrgency(resp[j].event))
         {
-          ignore_list[j] = 1;
+          ignore_list[j] = true;
         }
       }
     }
@@ -350,7 +371,7 @@ void filterAlerts(std::vector<owm_alerts_t> &resp, int *ignore_list)
 
   // Save only the 2 most recent alerts
   int valid_cnt = 0;
-  for (int i = 0; i < resp.size(); ++i)
+  for (int i = 0; i < count; ++i)
   {
     if (valid_cnt < 2 && !ignore_list[i])
     {
@@ -358,14 +379,14 @@ void filterAlerts(std::vector<owm_alerts_t> &resp, int *ignore_list)
     }
     else
     {
-      ignore_list[i] = 1;
+      ignore_list[i] = true;
     }
   }
 
   // Remove trailing/extraneous information
-  for (auto &alert : resp)
+  for (int i = 0; i < count; ++i)
   {
-    truncateExtraAlertInfo(alert.event);
+    truncateExtraAlertInfo(resp[i].event);
   }
 
   return;
@@ -397,6 +418,121 @@ const char *getUVIdesc(unsigned int uvi)
   }
 } // end getUVIdesc
 
+/* Returns the average concentration of pollutant over the given window, i.e.
+ * the mean of the most recent 1, 3, 4, 8 or 24 hourly samples.
+ *
+ * This differs from the avg_conc() of the AQI library this replaced, which
+ * was handed the first (oldest) 24 samples of the response and always divided
+ * by the window's hours:
+ *  - the windows end at the newest sample parsed, so a response longer than
+ *    24 hours no longer averages stale hours;
+ *  - when fewer samples than hours were returned, the mean is over the
+ *    samples there are, where the missing hours used to count as 0 and pull
+ *    the average (and the AQI) down.
+ * With exactly 24 hourly samples, as requested, the result is the same.
+ *
+ * Returns 0 if the pollutant is not tracked for AQI_SCALE or nothing was
+ * parsed.
+ */
+float getAvgConc(const owm_resp_air_pollution_t &p, owm_pollutant_t pollutant,
+                 owm_aqi_window_t window)
+{
+  if (p.slot[pollutant] < 0 || p.samples == 0)
+  {
+    return 0.f;
+  }
+  return p.conc[p.slot[pollutant]].sum[window]
+         / static_cast<float>(std::min(OWM_AQI_WINDOW_HOURS[window],
+                                                 p.samples));
+} // end getAvgConc
+
+/* Returns the Air Quality Index of the parsed air pollution history on the
+ * configured AQI_SCALE.
+ *
+ * Lead (pb) is not reported by OpenWeatherMap and is passed as 0. The UK DAQI
+ * wants a 15min so2 average; the most recent hourly concentration is used.
+ */
+int getAQI(const owm_resp_air_pollution_t &p)
+{
+  switch (AQI_SCALE)
+  {
+  case AUSTRALIA_AQI:
+    return australia_aqi(getAvgConc(p, OWM_CO,    OWM_AQI_8H),
+                         getAvgConc(p, OWM_NO2,   OWM_AQI_1H),
+                         getAvgConc(p, OWM_O3,    OWM_AQI_1H),
+                         getAvgConc(p, OWM_O3,    OWM_AQI_4H),
+                         getAvgConc(p, OWM_SO2,   OWM_AQI_1H),
+                         getAvgConc(p, OWM_PM10,  OWM_AQI_24H),
+                         getAvgConc(p, OWM_PM2_5, OWM_AQI_24H));
+  case CANADA_AQHI:
+    return canada_aqhi(getAvgConc(p, OWM_NO2,   OWM_AQI_3H),
+                       getAvgConc(p, OWM_O3,    OWM_AQI_3H),
+                       getAvgConc(p, OWM_PM2_5, OWM_AQI_3H));
+  case CHINA_AQI:
+    return china_aqi(getAvgConc(p, OWM_CO,    OWM_AQI_1H),
+                     getAvgConc(p, OWM_CO,    OWM_AQI_24H),
+                     getAvgConc(p, OWM_NO2,   OWM_AQI_1H),
+                     getAvgConc(p, OWM_NO2,   OWM_AQI_24H),
+                     getAvgConc(p, OWM_O3,    OWM_AQI_1H),
+                     getAvgConc(p, OWM_O3,    OWM_AQI_8H),
+                     getAvgConc(p, OWM_SO2,   OWM_AQI_1H),
+                     getAvgConc(p, OWM_SO2,   OWM_AQI_24H),
+                     getAvgConc(p, OWM_PM10,  OWM_AQI_24H),
+                     getAvgConc(p, OWM_PM2_5, OWM_AQI_24H));
+  case EUROPEAN_UNION_CAQI:
+    return european_union_caqi(getAvgConc(p, OWM_NO2,   OWM_AQI_1H),
+                               getAvgConc(p, OWM_O3,    OWM_AQI_1H),
+                               getAvgConc(p, OWM_PM10,  OWM_AQI_1H),
+                               getAvgConc(p, OWM_PM2_5, OWM_AQI_1H));
+  case HONG_KONG_AQHI:
+    return hong_kong_aqhi(getAvgConc(p, OWM_NO2,   OWM_AQI_3H),
+                          getAvgConc(p, OWM_O3,    OWM_AQI_3H),
+                          getAvgConc(p, OWM_SO2,   OWM_AQI_3H),
+                          getAvgConc(p, OWM_PM10,  OWM_AQI_3H),
+                          getAvgConc(p, OWM_PM2_5, OWM_AQI_3H));
+  case INDIA_AQI:
+    return india_aqi(getAvgConc(p, OWM_CO,    OWM_AQI_8H),
+                     getAvgConc(p, OWM_NH3,   OWM_AQI_24H),
+                     getAvgConc(p, OWM_NO2,   OWM_AQI_24H),
+                     getAvgConc(p, OWM_O3,    OWM_AQI_8H),
+                     0.f, // pb
+                     getAvgConc(p, OWM_SO2,   OWM_AQI_24H),
+                     getAvgConc(p, OWM_PM10,  OWM_AQI_24H),
+                     getAvgConc(p, OWM_PM2_5, OWM_AQI_24H));
+  case SINGAPORE_PSI:
+    return singapore_psi(getAvgConc(p, OWM_CO,    OWM_AQI_8H),
+                         getAvgConc(p, OWM_NO2,   OWM_AQI_1H),
+                         getAvgConc(p, OWM_O3,    OWM_AQI_1H),
+                         getAvgConc(p, OWM_O3,    OWM_AQI_8H),
+                         getAvgConc(p, OWM_SO2,   OWM_AQI_24H),
+                         getAvgConc(p, OWM_PM10,  OWM_AQI_24H),
+                         getAvgConc(p, OWM_PM2_5, OWM_AQI_24H));
+  case SOUTH_KOREA_CAI:
+    return south_korea_cai(getAvgConc(p, OWM_CO,    OWM_AQI_1H),
+                           getAvgConc(p, OWM_NO2,   OWM_AQI_1H),
+                           getAvgConc(p, OWM_O3,    OWM_AQI_1H),
+                           getAvgConc(p, OWM_SO2,   OWM_AQI_1H),
+                           getAvgConc(p, OWM_PM10,  OWM_AQI_24H),
+                           getAvgConc(p, OWM_PM2_5, OWM_AQI_24H));
+  case UNITED_KINGDOM_DAQI:
+    return united_kingdom_daqi(getAvgConc(p, OWM_NO2,   OWM_AQI_1H),
+                               getAvgConc(p, OWM_O3,    OWM_AQI_8H),
+                               getAvgConc(p, OWM_SO2,   OWM_AQI_1H),
+                               getAvgConc(p, OWM_PM10,  OWM_AQI_24H),
+                               getAvgConc(p, OWM_PM2_5, OWM_AQI_24H));
+  case UNITED_STATES_AQI:
+  default:
+    return united_states_aqi(getAvgConc(p, OWM_CO,    OWM_AQI_8H),
+                             getAvgConc(p, OWM_NO2,   OWM_AQI_1H),
+                             getAvgConc(p, OWM_O3,    OWM_AQI_1H),
+                             getAvgConc(p, OWM_O3,    OWM_AQI_8H),
+                             getAvgConc(p, OWM_SO2,   OWM_AQI_1H),
+                             getAvgConc(p, OWM_SO2,   OWM_AQI_24H),
+                             getAvgConc(p, OWM_PM10,  OWM_AQI_24H),
+                             getAvgConc(p, OWM_PM2_5, OWM_AQI_24H));
+  }
+} // end getAQI
+
 /* Returns the wifi signal strength descriptor text for the given RSSI.
  */
 const char *getWiFidesc(int rssi)
@@ -449,12 +585,11 @@ const uint8_t *getWiFiBitmap16(int rssi)
   }
 } // end getWiFiBitmap24
 
-/* Returns true if icon is a daytime icon, false otherwise.
+/* Returns true if weather has a daytime icon, false otherwise.
  */
-bool isDay(String icon) 
+bool isDay(const owm_weather_t &weather)
 {
-  // OpenWeatherMap indicates sun is up with d otherwise n for night
-  return icon.endsWith("d");
+  return weather.day;
 }
 
 /* Returns true if the moon is currently in the sky above, false otherwise.
@@ -504,9 +639,11 @@ bool isWindy(float wind_speed, float wind_gust) {
  *   https://openweathermap.org/weather-conditions
  */
 template <int BitmapSize>
-const uint8_t *getConditionsBitmap(int id, bool day, bool moon, bool cloudy,
-                                   bool windy)
+const uint8_t *getConditionsBitmap(const owm_weather_t &weather, bool moon,
+                                   bool cloudy, bool windy)
 {
+  const int id = weather.id;
+  const bool day = isDay(weather);
   switch (id)
   {
   // Group 2xx: Thunderstorm
@@ -647,6 +784,7 @@ const uint8_t *getConditionsBitmap(int id, bool day, bool moon, bool cloudy,
   }
 } // end getConditionsBitmap
 
+#if DISPLAY_HOURLY_ICONS
 /* Takes the daily weather forecast (from OpenWeatherMap API response) and
  * returns a pointer to the icon's 32x32 bitmap.
  *
@@ -655,27 +793,26 @@ const uint8_t *getConditionsBitmap(int id, bool day, bool moon, bool cloudy,
 const uint8_t *getHourlyForecastBitmap32(const owm_hourly_t &hourly,
                                          const owm_daily_t  &today)
 {
-  const int id = hourly.weather.id;
-  const bool day = isDay(hourly.weather.icon);
   const bool moon = isMoonInSky(hourly.dt, today.moonrise, today.moonset,
                                 today.moon_phase);
   const bool cloudy = isCloudy(hourly.clouds);
   const bool windy = isWindy(hourly.wind_speed, hourly.wind_gust);
-  return getConditionsBitmap<32>(id, day, moon, cloudy, windy);
+  return getConditionsBitmap<32>(hourly.weather, moon, cloudy, windy);
 }
+#endif
 
 /* Takes the daily weather forecast (from OpenWeatherMap API response) and
  * returns a pointer to the icon's 64x64 bitmap.
  */
 const uint8_t *getDailyForecastBitmap64(const owm_daily_t &daily)
 {
-  const int id = daily.weather.id;
   // always show daytime icon for daily forecast
-  const bool day = true;
+  owm_weather_t weather = daily.weather;
+  weather.day = 1;
   const bool moon = false;
   const bool cloudy = isCloudy(daily.clouds);
   const bool windy = isWindy(daily.wind_speed, daily.wind_gust);
-  return getConditionsBitmap<64>(id, day, moon, cloudy, windy);
+  return getConditionsBitmap<64>(weather, moon, cloudy, windy);
 } // end getForecastBitmap64
 
 /* Takes the current weather and today's daily weather forcast (from
@@ -687,13 +824,11 @@ const uint8_t *getDailyForecastBitmap64(const owm_daily_t &daily)
 const uint8_t *getCurrentConditionsBitmap196(const owm_current_t &current,
                                              const owm_daily_t   &today)
 {
-  const int id = current.weather.id;
-  const bool day = isDay(current.weather.icon);
   const bool moon = isMoonInSky(current.dt, today.moonrise, today.moonset,
                                 today.moon_phase);
   const bool cloudy = isCloudy(current.clouds);
   const bool windy = isWindy(current.wind_speed, current.wind_gust);
-  return getConditionsBitmap<196>(id, day, moon, cloudy, windy);
+  return getConditionsBitmap<196>(current.weather, moon, cloudy, windy);
 } // end getCurrentConditionsBitmap196
 
 /* Returns a 32x32 bitmap for a given alert.
@@ -788,16 +923,16 @@ const uint8_t *getAlertBitmap48(const owm_alerts_t &alert)
   }
 } // end getAlertBitmap48
 
-/* Returns true of a String, s, contains any of the strings in the terminology
+/* Returns true of a string, s, contains any of the strings in the terminology
  * vector.
  *
  * Note: This function is case sensitive.
  */
-bool containsTerminology(const String s, const std::vector<String> &terminology)
+bool containsTerminology(const char *s, const std::vector<String> &terminology)
 {
   for (const String &term : terminology)
   {
-    if (s.indexOf(term) >= 0)
+    if (strstr(s, term.c_str()) != nullptr)
     {
       return true;
     }
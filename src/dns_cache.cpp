@@ -0,0 +1,161 @@
+/* DNS cache for TRMNL OG Weather Station
+ * See dns_cache.h.
+ */
+
+#include <mutex>
+#include <time.h>
+#include <Arduino.h>
+#include <esp_attr.h>
+#include <WiFi.h>
+#include "config.h"
+#include "dns_cache.h"
+#include "wake_profile.h"
+
+typedef struct dns_cache_entry
+{
+  uint32_t hostHash;        // FNV-1a of the host name, 0 if unused
+  uint32_t ip;
+  int64_t  expiresAt;       // time() the entry expires
+} dns_cache_entry_t;
+
+static RTC_DATA_ATTR dns_cache_entry_t dnsCache[DNS_CACHE_SLOTS];
+static RTC_DATA_ATTR uint8_t nextEntry;
+// Hosts may be resolved by several fetch tasks at once
+static std::mutex dnsMutex;
+
+static uint32_t getHostHash(const char *host)
+{
+  uint32_t h = 2166136261u;
+  for (const char *c = host; *c; ++c)
+  {
+    h = (h ^ static_cast<uint8_t>(tolower(*c))) * 16777619u;
+  }
+  return h ? h : 1;
+} // end getHostHash
+
+/* Returns the entry for hostHash, or nullptr.
+ */
+static dns_cache_entry_t *findEntry(uint32_t hostHash)
+{
+  for (dns_cache_entry_t &entry : dnsCache)
+  {
+    if (entry.hostHash == hostHash)
+    {
+      return &entry;
+    }
+  }
+  return nullptr;
+} // end findEntry
+
+/* Looks up host, in the cache first.
+ *
+ * Returns true if the address was found.
+ */
+bool resolveHost(const char *host, IPAddress &ip)
+{
+  if (ip.fromString(host))
+  {
+    return true;
+  }
+  uint32_t hostHash = getHostHash(host);
+  int64_t now = time(nullptr);
+  {
+    std::lock_guard<std::mutex> lock(dnsMutex);
+    dns_cache_entry_t *entry = findEntry(hostHash);
+    // An entry expiring further away than its TTL was made before the clock
+    // was set back.
+    if (entry != nullptr && entry->expiresAt > now
+        && entry->expiresAt - now <= DNS_CACHE_TTL)
+    {
+      ip = entry->ip;
+#if DEBUG_LEVEL >= 1
+      Serial.printf("[debug] DNS %s: %s (cached, %llds left)\n", host,
+                    ip.toString().c_str(), entry->expiresAt - now);
+#endif
+      return true;
+    }
+  }
+
+  unsigned long start = millis();
+  bool found = WiFi.hostByName(host, ip) && static_cast<uint32_t>(ip) != 0;
+  addWakePhase(WAKE_PHASE_DNS, millis() - start);
+  if (!found)
+  {
+    Serial.printf("DNS lookup of %s failed\n", host);
+    return false;
+  }
+#if DEBUG_LEVEL >= 1
+  Serial.printf("[debug] DNS %s: %s (resolved in %lums)\n", host,
+                ip.toString().c_str(), millis() - start);
+#endif
+
+  std::lock_guard<std::mutex> lock(dnsMutex);
+  dns_cache_entry_t *entry = findEntry(hostHash);
+  if (entry == nullptr)
+  {
+    entry = &dnsCache[nextEntry];
+    nextEntry = (nextEntry + 1) % DNS_CACHE_SLOTS;
+  }
+  entry->hostHash = hostHash;
+  entry->ip = static_cast<uint32_t>(ip);
+  entry->expiresAt = now + DNS_CACHE_TTL;
+  return true;
+} // end resolveHost
+
+/* Drops the cached address of host, e.g. because connecting to it failed.
+ */
+void forgetHost(const char *host)
+{
+  std::lock_guard<std::mutex> lock(dnsMutex);
+  dns_cache_entry_t *entry = findEntry(getHostHash(host));
+  if (entry != nullptr)
+  {
+    entry->hostHash = 0;
+  }
+} // end forgetHost
+
+/* Resolves hosts that will be connected to later in the wake, so that the
+ * lookups of expired entries can overlap other waiting, e.g. for SNTP.
+ */
+void prefetchHosts(const char *const *hosts, size_t count)
+{
+  IPAddress ip;
+  for (size_t i = 0; i < count; ++i)
+  {
+    if (hosts[i] != nullptr && hosts[i][0] != '\0')
+    {
+      resolveHost(hosts[i], ip);
+    }
+  }
+} // end prefetchHosts
+
+int CachedDnsClient::connect(const char *host, uint16_t port,
+                             int32_t timeout)
+{
+  IPAddress ip;
+  if (!resolveHost(host, ip))
+  {
+    return 0;
+  }
+  int ret = WiFiClient::connect(ip, port, timeout);
+  if (!ret)
+  {
+    forgetHost(host);
+  }
+  return ret;
+}
+
+int CachedDnsClient::connect(const char *host, uint16_t port)
+{
+  IPAddress ip;
+  if (!resolveHost(host, ip))
+  {
+    return 0;
+  }
+  int ret = WiFiClient::connect(ip, port);
+  if (!ret)
+  {
+    forgetHost(host);
+  }
+  return ret;
+}
@@ -0,0 +1,123 @@
+/* Concurrent network requests for TRMNL OG Weather Station
+ * See fetch_jobs.h.
+ */
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/task.h>
+#include "config.h"
+#include "fetch_jobs.h"
+#include "watchdog.h"
+
+#define FETCH_JOBS_MAX 24 // event group bits available
+
+typedef struct fetch_task_arg
+{
+  fetch_job_t       *job;
+  EventGroupHandle_t doneGroup;
+  EventBits_t        doneBit;
+} fetch_task_arg_t;
+
+static void runJob(fetch_job_t &job)
+{
+  unsigned long start = millis();
+  job.run(job.arg);
+  job.ms = millis() - start;
+  job.done = true;
+} // end runJob
+
+static void fetchTask(void *param)
+{
+  fetch_task_arg_t *arg = static_cast<fetch_task_arg_t *>(param);
+  runJob(*arg->job);
+  xEventGroupSetBits(arg->doneGroup, arg->doneBit);
+  vTaskDelete(nullptr);
+} // end fetchTask
+
+/* Runs the jobs and waits for all of them to finish.
+ *
+ * With CONCURRENT_FETCH each job gets its own task, alternating between the
+ * two cores, and the calling task only feeds the watchdog until they are
+ * done. Otherwise, or if a task cannot be created, jobs run one after another
+ * in the calling task.
+ *
+ * Returns false if the jobs did not all finish within timeoutMs. Jobs still
+ * running then may write their results at any time, so the caller must not
+ * use them and should go to sleep instead.
+ */
+bool runFetchJobs(fetch_job_t *jobs, size_t count, unsigned long timeoutMs)
+{
+  unsigned long start = millis();
+  for (size_t i = 0; i < count; ++i)
+  {
+    jobs[i].ms = 0;
+    jobs[i].done = false;
+  }
+
+#if CONCURRENT_FETCH
+  // static: tasks still running after a timeout keep using it
+  static fetch_task_arg_t args[FETCH_JOBS_MAX];
+  static EventGroupHandle_t doneGroup = nullptr;
+  if (doneGroup == nullptr)
+  {
+    doneGroup = xEventGroupCreate();
+  }
+  EventBits_t waitBits = 0;
+  if (doneGroup != nullptr && count <= FETCH_JOBS_MAX)
+  {
+    xEventGroupClearBits(doneGroup, (1 << FETCH_JOBS_MAX) - 1);
+    for (size_t i = 0; i < count; ++i)
+    {
+      args[i] = {&jobs[i], doneGroup, static_cast<EventBits_t>(1 << i)};
+      // the WiFi driver runs on core 0, so the first job starts on core 1
+      BaseType_t core = (i % 2 == 0) ? 1 : 0;
+      if (xTaskCreatePinnedToCore(fetchTask, jobs[i].name,
+                                  jobs[i].stackSize, &args[i], 1, nullptr,
+                                  core) == pdPASS)
+      {
+        waitBits |= args[i].doneBit;
+      }
+    }
+  }
+#else
+  EventBits_t waitBits = 0;
+#endif
+
+  for (size_t i = 0; i < count; ++i)
+  {
+#if CONCURRENT_FETCH
+    if (waitBits & (1 << i))
+    {
+      continue;
+    }
+#endif
+    runJob(jobs[i]);
+    feedWatchdog();
+  }
+
+#if CONCURRENT_FETCH
+  EventBits_t doneBits = 0;
+  while ((doneBits & waitBits) != waitBits && millis() - start < timeoutMs)
+  {
+    doneBits = xEventGroupWaitBits(doneGroup, waitBits, pdFALSE, pdTRUE,
+                                   pdMS_TO_TICKS(500));
+    feedWatchdog();
+  }
+  if ((doneBits & waitBits) != waitBits)
+  {
+    Serial.println("Fetch: timed out waiting for requests");
+    return false;
+  }
+#endif
+
+#if DEBUG_LEVEL >= 1
+  Serial.printf("[debug] Fetch jobs    : %lums total", millis() - start);
+  for (size_t i = 0; i < count; ++i)
+  {
+    Serial.printf(", %s %lums", jobs[i].name,
+                  static_cast<unsigned long>(jobs[i].ms));
+  }
+  Serial.println();
+#endif
+  return true;
+} // end runFetchJobs
@@ -0,0 +1,315 @@
+/* Direct frame buffer drawing for TRMNL OG Weather Station
+ * See frame_buffer.h.
+ */
+
+#include <cstring>
+#include <Arduino.h>
+#include "frame_buffer.h"
+#include "renderer.h"
+
+#if defined(DISP_BW_V2) || defined(DISP_BW_V1)
+typedef decltype(display) FbDisplay;
+
+template <typename T> struct FbTraits;
+template <typename Panel, uint16_t pageHeight>
+struct FbTraits<GxEPD2_BW<Panel, pageHeight> >
+{
+  typedef uint8_t buffer_t[(Panel::WIDTH / 8) * pageHeight];
+};
+
+/* GxEPD2_BW keeps its buffer and page window private. An explicit template
+ * instantiation may name private members, which is used here to get pointers
+ * to the few that describe the current page.
+ */
+template <typename Tag, typename Tag::type member>
+struct FbMemberAccess
+{
+  friend typename Tag::type getMember(Tag) { return member; }
+};
+
+#define FB_MEMBER(name, member_t)                                             \
+  struct name##Tag                                                            \
+  {                                                                           \
+    typedef member_t FbDisplay::*type;                                        \
+    friend type getMember(name##Tag);                                         \
+  };                                                                          \
+  template struct FbMemberAccess<name##Tag, &FbDisplay::name>
+
+FB_MEMBER(_buffer, FbTraits<FbDisplay>::buffer_t);
+FB_MEMBER(_mirror, bool);
+FB_MEMBER(_reverse, bool);
+FB_MEMBER(_current_page, int16_t);
+FB_MEMBER(_page_height, uint16_t);
+FB_MEMBER(_pw_x, uint16_t);
+FB_MEMBER(_pw_y, uint16_t);
+FB_MEMBER(_pw_w, uint16_t);
+FB_MEMBER(_pw_h, uint16_t);
+
+bool getFrameBuffer(frame_buffer_t &fb)
+{
+  FbDisplay &d = display;
+  if (d.getRotation() != 0 || d.*getMember(_mirrorTag())
+   || d.*getMember(_reverseTag()))
+  {
+    return false;
+  }
+  int16_t pageHeight = d.*getMember(_page_heightTag());
+  int16_t pageTop = d.*getMember(_current_pageTag()) * pageHeight;
+  int16_t windowHeight = d.*getMember(_pw_hTag());
+  if (pageTop >= windowHeight)
+  {
+    return false;
+  }
+  fb.data   = d.*getMember(_bufferTag());
+  fb.x      = d.*getMember(_pw_xTag());
+  fb.y      = d.*getMember(_pw_yTag()) + pageTop;
+  fb.w      = d.*getMember(_pw_wTag());
+  fb.h      = min<int16_t>(pageHeight, windowHeight - pageTop);
+  fb.stride = fb.w / 8;
+  return true;
+} // end getFrameBuffer
+#else
+bool getFrameBuffer(frame_buffer_t &)
+{
+  return false;
+} // end getFrameBuffer
+#endif
+
+/* Applies op to the set bits of draw in buffer byte dst.
+ */
+static inline void drawByte(uint8_t *dst, uint8_t draw, raster_op_t op)
+{
+  switch (op)
+  {
+  case RASTER_AND:
+    *dst &= ~draw;
+    break;
+  case RASTER_OR:
+    *dst |= draw;
+    break;
+  case RASTER_XOR:
+    *dst ^= draw;
+    break;
+  }
+} // end drawByte
+
+/* Same as drawByte() for the 4 buffer bytes at dst, 4-aligned. draw holds the
+ * first of them in its most significant byte.
+ */
+static inline void drawWord(uint8_t *dst, uint32_t draw, raster_op_t op)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  draw = __builtin_bswap32(draw);
+#endif
+  uint32_t word;
+  memcpy(&word, __builtin_assume_aligned(dst, 4), 4);
+  switch (op)
+  {
+  case RASTER_AND:
+    word &= ~draw;
+    break;
+  case RASTER_OR:
+    word |= draw;
+    break;
+  case RASTER_XOR:
+    word ^= draw;
+    break;
+  }
+  memcpy(__builtin_assume_aligned(dst, 4), &word, 4);
+} // end drawWord
+
+/* Repeats the first period bits of pattern (most significant first) over 64
+ * bits, so that the 32 bits from any phase below period are at hand.
+ */
+static uint64_t repeatPattern(uint8_t pattern, uint8_t period)
+{
+  uint64_t bits = 0;
+  for (int i = 0; i < 64; ++i)
+  {
+    bits = (bits << 1) | ((pattern >> (7 - i % period)) & 1);
+  }
+  return bits;
+} // end repeatPattern
+
+/* Applies op to buffer columns first to last of row, drawing the repeated
+ * pattern bits from phase at the start of the byte holding column first.
+ */
+static void drawSpan(uint8_t *row, int first, int last, uint64_t bits,
+                     uint8_t period, int phase, raster_op_t op)
+{
+  int i = first / 8;
+  int end = last / 8;
+  uint8_t firstMask = 0xFF >> (first & 7);
+  uint8_t lastMask = 0xFF << (7 - (last & 7));
+  if (i == end)
+  {
+    drawByte(row + i, (bits >> (56 - phase)) & firstMask & lastMask, op);
+    return;
+  }
+
+  drawByte(row + i, (bits >> (56 - phase)) & firstMask, op);
+  phase = (phase + 8) % period;
+  // bytes up to the first word, whole words, then the bytes left before the
+  // last one
+  for (++i; i < end && (reinterpret_cast<uintptr_t>(row + i) & 3) != 0; ++i)
+  {
+    drawByte(row + i, bits >> (56 - phase), op);
+    phase = (phase + 8) % period;
+  }
+  for (; end - i >= 4; i += 4)
+  {
+    drawWord(row + i, bits >> (32 - phase), op);
+    phase = (phase + 32) % period;
+  }
+  for (; i < end; ++i)
+  {
+    drawByte(row + i, bits >> (56 - phase), op);
+    phase = (phase + 8) % period;
+  }
+  drawByte(row + end, (bits >> (56 - phase)) & lastMask, op);
+} // end drawSpan
+
+void blitInvertedBitmap(const frame_buffer_t &fb, int16_t x, int16_t y,
+                        const uint8_t *bitmap, int16_t w, int16_t h,
+                        bool white)
+{
+  // clip to the page, in bitmap columns and rows
+  int col0 = x - fb.x;      // buffer column of bitmap column 0
+  int row0 = y - fb.y;
+  int first = col0 < 0 ? -col0 : 0;
+  int last = w < fb.w - col0 ? w : fb.w - col0;
+  int top = row0 < 0 ? -row0 : 0;
+  int bottom = h < fb.h - row0 ? h : fb.h - row0;
+  if (first >= last || top >= bottom)
+  {
+    return;
+  }
+
+  // buffer bytes of each row drawn, masks of the columns drawn in the first
+  // and last of them
+  int dstFirst = (col0 + first) / 8;
+  int dstLast = (col0 + last - 1) / 8;
+  uint8_t firstMask = 0xFF >> ((col0 + first) & 7);
+  uint8_t lastMask = 0xFF << (7 - ((col0 + last - 1) & 7));
+  if (dstFirst == dstLast)
+  {
+    firstMask &= lastMask;
+    lastMask = firstMask;
+  }
+  // bitmap column at the first pixel of byte dstFirst, -7 to w
+  int srcFirst = dstFirst * 8 - col0;
+  int shift = srcFirst & 7;
+  int byteWidth = (w + 7) / 8;
+  raster_op_t op = white ? RASTER_OR : RASTER_AND;
+
+  for (int j = top; j < bottom; ++j)
+  {
+    const uint8_t *src = bitmap + j * byteWidth;
+    uint8_t *dst = fb.data + (row0 + j) * fb.stride + dstFirst;
+    uint8_t *end = fb.data + (row0 + j) * fb.stride + dstLast;
+    uint8_t mask = firstMask;
+    if (shift == 0)
+    {
+      // bitmap bytes line up with buffer bytes
+      src += srcFirst / 8;
+      for (; dst <= end; ++dst, ++src)
+      {
+        if (dst == end)
+        {
+          mask &= lastMask;
+        }
+        drawByte(dst, ~pgm_read_byte(src) & mask, op);
+        mask = 0xFF;
+      }
+    }
+    else
+    {
+      // each buffer byte takes the end of one bitmap byte and the start of
+      // the next, bits outside the bitmap row are transparent (set)
+      int i = (srcFirst - shift) / 8;
+      uint16_t window = i >= 0 ? pgm_read_byte(src + i) : 0xFF;
+      for (; dst <= end; ++dst)
+      {
+        ++i;
+        window = (window << 8) | (i < byteWidth ? pgm_read_byte(src + i) : 0xFF);
+        if (dst == end)
+        {
+          mask &= lastMask;
+        }
+        drawByte(dst, ~(window >> (8 - shift)) & mask, op);
+        mask = 0xFF;
+      }
+    }
+  }
+} // end blitInvertedBitmap
+
+void fillPattern(const frame_buffer_t &fb, int16_t x, int16_t y, int16_t w,
+                 int16_t h, const uint8_t pattern[8], raster_op_t op)
+{
+  int first = x - fb.x > 0 ? x - fb.x : 0;
+  int last = x + w < fb.x + fb.w ? x + w - fb.x - 1 : fb.w - 1;
+  int top = y - fb.y > 0 ? y - fb.y : 0;
+  int bottom = y + h < fb.y + fb.h ? y + h - fb.y : fb.h;
+  if (first > last)
+  {
+    return;
+  }
+
+  // fb.x is 8-aligned, so every byte takes the whole pattern row
+  for (int j = top; j < bottom; ++j)
+  {
+    uint8_t bits = pattern[(fb.y + j) & 7];
+    if (bits != 0 || op == RASTER_XOR)
+    {
+      drawSpan(fb.data + j * fb.stride, first, last,
+               bits * 0x0101010101010101ULL, 8, 0, op);
+    }
+  }
+} // end fillPattern
+
+void drawDashedHLine(const frame_buffer_t &fb, int16_t x, int16_t y,
+                     int16_t w, uint8_t pattern, uint8_t period,
+                     raster_op_t op)
+{
+  int first = x - fb.x > 0 ? x - fb.x : 0;
+  int last = x + w < fb.x + fb.w ? x + w - fb.x - 1 : fb.w - 1;
+  int row = y - fb.y;
+  if (first > last || row < 0 || row >= fb.h)
+  {
+    return;
+  }
+
+  // phase of the pattern at the start of the first byte drawn
+  int phase = (fb.x + (first & ~7) - x) % period;
+  if (phase < 0)
+  {
+    phase += period;
+  }
+  drawSpan(fb.data + row * fb.stride, first, last,
+           repeatPattern(pattern, period), period, phase, op);
+} // end drawDashedHLine
+
+void drawDashedVLine(const frame_buffer_t &fb, int16_t x, int16_t y,
+                     int16_t h, uint8_t pattern, uint8_t period,
+                     raster_op_t op)
+{
+  int col = x - fb.x;
+  int top = y - fb.y > 0 ? y - fb.y : 0;
+  int bottom = y + h < fb.y + fb.h ? y + h - fb.y : fb.h;
+  if (col < 0 || col >= fb.w)
+  {
+    return;
+  }
+
+  uint8_t *dst = fb.data + top * fb.stride + col / 8;
+  uint8_t bit = 0x80 >> (col & 7);
+  int phase = (fb.y + top - y) % period;
+  for (int j = top; j < bottom; ++j, dst += fb.stride)
+  {
+    if (pattern & (0x80 >> phase))
+    {
+      drawByte(dst, bit, op);
+    }
+    phase = phase + 1 < period ? phase + 1 : 0;
+  }
+} // end drawDashedVLine
@@ -0,0 +1,265 @@
+/* Persistent HTTP connections for TRMNL OG Weather Station
+ * See http_connection.h.
+ */
+
+#include <cstdlib>
+#include "config.h"
+#include "http_connection.h"
+#include "inflate_stream.h"
+#include "wake_profile.h"
+
+void HttpBodyStream::begin(Stream &in, int contentLength, bool chunked)
+{
+  _in = &in;
+  _chunked = chunked;
+  _untilClose = !chunked && contentLength < 0;
+  _remaining = (chunked || contentLength < 0) ? 0 : contentLength;
+  _chunkEnd = false;
+  _ended = false;
+  _failed = false;
+  setTimeout(in.getTimeout());
+} // end begin
+
+/* Reads a CRLF terminated line, without the CRLF. Longer lines are cut.
+ */
+bool HttpBodyStream::readLine(char *line, size_t size)
+{
+  size_t len = 0;
+  char c;
+  while (_in->readBytes(&c, 1) == 1)
+  {
+    if (c == '\n')
+    {
+      if (len > 0 && line[len - 1] == '\r')
+      {
+        --len;
+      }
+      line[len] = '\0';
+      return true;
+    }
+    if (len < size - 1)
+    {
+      line[len++] = c;
+    }
+  }
+  return false;
+} // end readLine
+
+/* Makes sure there is unread body data, reading the next chunk header if
+ * needed.
+ *
+ * Returns false at the end of the body.
+ */
+bool HttpBodyStream::ensure()
+{
+  if (_in == nullptr || _ended || _failed)
+  {
+    return false;
+  }
+  if (_untilClose || _remaining > 0)
+  {
+    return true;
+  }
+  if (!_chunked)
+  {
+    _ended = true;
+    return false;
+  }
+
+  char line[32];
+  if (_chunkEnd && (!readLine(line, sizeof(line)) || line[0] != '\0'))
+  {
+    _failed = true;
+    return false;
+  }
+  _chunkEnd = true;
+  // chunk-size [; chunk-ext]
+  char *end;
+  if (!readLine(line, sizeof(line)))
+  {
+    _failed = true;
+    return false;
+  }
+  _remaining = strtoul(line, &end, 16);
+  if (end == line)
+  {
+    _failed = true;
+    return false;
+  }
+  if (_remaining == 0)
+  {
+    // trailer fields up to the empty line
+    do
+    {
+      if (!readLine(line, sizeof(line)))
+      {
+        _failed = true;
+        return false;
+      }
+    } while (line[0] != '\0');
+    _ended = true;
+    return false;
+  }
+  return true;
+} // end ensure
+
+bool HttpBodyStream::drain(size_t maxBytes)
+{
+  if (_in == nullptr || _untilClose)
+  {
+    return false;
+  }
+  char buf[128];
+  size_t skipped = 0;
+  while (ensure())
+  {
+    if (skipped + _remaining > maxBytes)
+    {
+      return false;
+    }
+    size_t n = readBytes(buf, min(sizeof(buf), _remaining));
+    if (n == 0)
+    {
+      return false;
+    }
+    skipped += n;
+  }
+  return _ended && !_failed;
+} // end drain
+
+int HttpBodyStream::available()
+{
+  if (_in == nullptr || _ended || _failed)
+  {
+    return 0;
+  }
+  int n = _in->available();
+  if (_untilClose)
+  {
+    return n;
+  }
+  return n < static_cast<int>(_remaining) ? n : _remaining;
+}
+
+int HttpBodyStream::read()
+{
+  char c;
+  return readBytes(&c, 1) == 1 ? static_cast<uint8_t>(c) : -1;
+}
+
+int HttpBodyStream::peek()
+{
+  return ensure() ? _in->peek() : -1;
+}
+
+size_t HttpBodyStream::readBytes(char *buffer, size_t length)
+{
+  size_t n = 0;
+  while (n < length && ensure())
+  {
+    size_t want = length - n;
+    if (!_untilClose && want > _remaining)
+    {
+      want = _remaining;
+    }
+    size_t got = _in->readBytes(&buffer[n], want);
+    if (got == 0)
+    {
+      if (!_untilClose)
+      {
+        _failed = true; // connection lost or timed out mid-body
+      }
+      _ended = true;
+      break;
+    }
+    n += got;
+    if (!_untilClose)
+    {
+      _remaining -= got;
+    }
+  }
+  return n;
+}
+
+HttpConnection::HttpConnection(WiFiClient &client, const String &host,
+                               uint16_t port)
+  : _client(client), _host(host), _port(port), _requests(0), _connects(0)
+{
+  _http.setReuse(true);
+  _http.setConnectTimeout(HTTP_CLIENT_TCP_TIMEOUT); // default 5000ms
+  _http.setTimeout(HTTP_CLIENT_TCP_TIMEOUT); // default 5000ms
+}
+
+HttpConnection::~HttpConnection()
+{
+  close();
+#if DEBUG_LEVEL >= 1
+  Serial.printf("[debug] HTTP keep-alive: %s %u requests, %u connections\n",
+                _host.c_str(), _requests, _connects);
+#endif
+}
+
+int HttpConnection::send(const String &uri)
+{
+  if (!_client.connected())
+  {
+    ++_connects;
+  }
+  _http.begin(_client, _host, _port, uri);
+#ifdef STANDIN_HOST
+  _http.addHeader(WAKE_HEADER, String(getWakeNumber()));
+#endif
+#if HTTP_ACCEPT_COMPRESSION
+  acceptCompressedResponse(_http);
+#endif
+  static const char *headerKeys[] = {"Content-Encoding", "Transfer-Encoding",
+                                     "Date"};
+  _http.collectHeaders(headerKeys, 3);
+  return _http.GET();
+} // end send
+
+int HttpConnection::get(const String &uri)
+{
+  bool reused = _client.connected();
+  ++_requests;
+  _body = HttpBodyStream();
+  int code = send(uri);
+  // A kept-alive connection the server has closed fails as soon as it is
+  // written to or read from. A timeout is not retried, it would double.
+  if (reused && code < 0 && code != HTTPC_ERROR_READ_TIMEOUT)
+  {
+    _client.stop();
+    code = send(uri);
+  }
+  if (code > 0)
+  {
+    String te = _http.header("Transfer-Encoding");
+    te.toLowerCase();
+    _body.begin(_http.getStream(), _http.getSize(),
+                te.indexOf("chunked") >= 0);
+  }
+  return code;
+} // end get
+
+void HttpConnection::setTimeout(unsigned timeout)
+{
+  _http.setConnectTimeout(timeout);
+  _http.setTimeout(timeout < UINT16_MAX ? timeout : UINT16_MAX);
+} // end setTimeout
+
+void HttpConnection::end()
+{
+  if (!_body.drain(HTTP_KEEPALIVE_DRAIN_MAX))
+  {
+    // Stopping the client before http.end() closes the connection without
+    // draining (and decrypting) the rest of the response.
+    _client.stop();
+  }
+  _http.end();
+} // end end
+
+void HttpConnection::close()
+{
+  _client.stop();
+  _http.end();
+} // end close
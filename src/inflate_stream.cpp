@@ -0,0 +1,292 @@
+/* Streaming gzip/deflate decoder for TRMNL OG Weather Station
+ * See inflate_stream.h.
+ */
+
+#include <cstring>
+#include <esp_heap_caps.h>
+#include <sdkconfig.h>
+#if CONFIG_IDF_TARGET_ESP32S3
+#include <esp32s3/rom/miniz.h>
+#elif CONFIG_IDF_TARGET_ESP32C3
+#include <esp32c3/rom/miniz.h>
+#else
+#include <esp32/rom/miniz.h>
+#endif
+#include "inflate_stream.h"
+
+// gzip header flags, RFC 1952
+#define GZIP_FHCRC    0x02
+#define GZIP_FEXTRA   0x04
+#define GZIP_FNAME    0x08
+#define GZIP_FCOMMENT 0x10
+
+/* Allocates from PSRAM when the board has it, so decoding does not compete
+ * with TLS and JSON parsing for internal RAM.
+ */
+static void *allocLarge(size_t size)
+{
+  void *p = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  if (p == nullptr)
+  {
+    p = heap_caps_malloc(size, MALLOC_CAP_DEFAULT);
+  }
+  return p;
+} // end allocLarge
+
+void acceptCompressedResponse(HTTPClient &http)
+{
+  static const char *headerKeys[] = {"Content-Encoding"};
+  http.addHeader("Accept-Encoding", "gzip, deflate");
+  http.collectHeaders(headerKeys, 1);
+} // end acceptCompressedResponse
+
+inflate_encoding_t getResponseEncoding(HTTPClient &http)
+{
+  String encoding = http.header("Content-Encoding");
+  encoding.trim();
+  if (encoding.equalsIgnoreCase("gzip") || encoding.equalsIgnoreCase("x-gzip"))
+  {
+    return INFLATE_GZIP;
+  }
+  if (encoding.equalsIgnoreCase("deflate"))
+  {
+    return INFLATE_DEFLATE;
+  }
+  return INFLATE_IDENTITY;
+} // end getResponseEncoding
+
+InflateStream::InflateStream(Stream &in, inflate_encoding_t encoding)
+  : _in(in), _encoding(encoding), _decomp(nullptr), _window(nullptr),
+    _windowPos(0), _outPos(0), _outEnd(0), _inPos(0), _inLen(0),
+    _inEnded(false), _done(false), _failed(false)
+{
+  // share the timeout so readBytes gives up together with the connection
+  setTimeout(in.getTimeout());
+}
+
+InflateStream::~InflateStream()
+{
+  heap_caps_free(_decomp);
+  heap_caps_free(_window);
+}
+
+bool InflateStream::begin()
+{
+  if (_encoding == INFLATE_IDENTITY)
+  {
+    return true;
+  }
+  _decomp = allocLarge(sizeof(tinfl_decompressor));
+  _window = static_cast<uint8_t *>(allocLarge(TINFL_LZ_DICT_SIZE));
+  if (_decomp == nullptr || _window == nullptr)
+  {
+    Serial.println("Inflate: out of memory");
+    _failed = true;
+    return false;
+  }
+  tinfl_init(static_cast<tinfl_decompressor *>(_decomp));
+
+  if (_encoding == INFLATE_GZIP && !skipGzipHeader())
+  {
+    Serial.println("Inflate: invalid gzip header");
+    _failed = true;
+    return false;
+  }
+  return true;
+} // end begin
+
+/* Refills the input buffer once it is used up.
+ *
+ * Returns false once the connection has no more data.
+ */
+bool InflateStream::refillInput()
+{
+  if (_inPos < _inLen)
+  {
+    return true;
+  }
+  if (_inEnded)
+  {
+    return false;
+  }
+  // don't wait for a full buffer when fewer bytes have arrived
+  int avail = _in.available();
+  size_t want = avail > 0 ? min(static_cast<size_t>(avail), sizeof(_inBuf))
+                          : 1;
+  _inLen = _in.readBytes(reinterpret_cast<char *>(_inBuf), want);
+  _inPos = 0;
+  _inEnded = _inLen == 0;
+  return !_inEnded;
+} // end refillInput
+
+bool InflateStream::readInput(uint8_t &c)
+{
+  if (!refillInput())
+  {
+    return false;
+  }
+  c = _inBuf[_inPos++];
+  return true;
+} // end readInput
+
+/* Skips the gzip member header, leaving the input at the deflate data. The
+ * trailing CRC-32 and length are not checked; a corrupted body fails to
+ * inflate or to parse as JSON.
+ */
+bool InflateStream::skipGzipHeader()
+{
+  uint8_t h[10];
+  for (size_t i = 0; i < sizeof(h); ++i)
+  {
+    if (!readInput(h[i]))
+    {
+      return false;
+    }
+  }
+  if (h[0] != 0x1F || h[1] != 0x8B || h[2] != 8) // magic, method deflate
+  {
+    return false;
+  }
+  uint8_t flags = h[3];
+  uint8_t c;
+  if (flags & GZIP_FEXTRA)
+  {
+    uint8_t lo, hi;
+    if (!readInput(lo) || !readInput(hi))
+    {
+      return false;
+    }
+    for (size_t n = lo | (hi << 8); n > 0; --n)
+    {
+      if (!readInput(c))
+      {
+        return false;
+      }
+    }
+  }
+  if (flags & GZIP_FNAME)
+  {
+    do
+    {
+      if (!readInput(c))
+      {
+        return false;
+      }
+    } while (c != 0);
+  }
+  if (flags & GZIP_FCOMMENT)
+  {
+    do
+    {
+      if (!readInput(c))
+      {
+        return false;
+      }
+    } while (c != 0);
+  }
+  if (flags & GZIP_FHCRC)
+  {
+    if (!readInput(c) || !readInput(c))
+    {
+      return false;
+    }
+  }
+  return true;
+} // end skipGzipHeader
+
+/* Decodes until at least one byte is ready to be read.
+ *
+ * Returns false at the end of the body or on error (see failed()).
+ */
+bool InflateStream::fill()
+{
+  tinfl_decompressor *decomp = static_cast<tinfl_decompressor *>(_decomp);
+  while (_outPos == _outEnd)
+  {
+    if (_done || _failed || decomp == nullptr)
+    {
+      return false;
+    }
+    refillInput();
+
+    size_t inBytes = _inLen - _inPos;
+    size_t outBytes = TINFL_LZ_DICT_SIZE - _windowPos;
+    mz_uint32 flags = (_encoding == INFLATE_DEFLATE
+                       ? TINFL_FLAG_PARSE_ZLIB_HEADER : 0)
+                      | (_inEnded ? 0 : TINFL_FLAG_HAS_MORE_INPUT);
+    // Without TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF the window is used as
+    // a circular buffer, so back references reach across the wrap.
+    tinfl_status status = tinfl_decompress(decomp, &_inBuf[_inPos], &inBytes,
+                                           _window, &_window[_windowPos],
+                                           &outBytes, flags);
+    _inPos += inBytes;
+    _outPos = _windowPos;
+    _outEnd = _windowPos + outBytes;
+    _windowPos = (_windowPos + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+
+    if (status == TINFL_STATUS_DONE)
+    {
+      _done = true;
+    }
+    else if (status < 0
+          || (status == TINFL_STATUS_NEEDS_MORE_INPUT && _inEnded))
+    {
+      Serial.println("Inflate: invalid or truncated data ("
+                     + String(static_cast<int>(status)) + ")");
+      _failed = true;
+    }
+  }
+  return true;
+} // end fill
+
+int InflateStream::available()
+{
+  if (_encoding == INFLATE_IDENTITY)
+  {
+    return _in.available();
+  }
+  return static_cast<int>(_outEnd - _outPos);
+}
+
+int InflateStream::read()
+{
+  if (_encoding == INFLATE_IDENTITY)
+  {
+    return _in.read();
+  }
+  if (!fill())
+  {
+    return -1;
+  }
+  return _window[_outPos++];
+}
+
+int InflateStream::peek()
+{
+  if (_encoding == INFLATE_IDENTITY)
+  {
+    return _in.peek();
+  }
+  if (!fill())
+  {
+    return -1;
+  }
+  return _window[_outPos];
+}
+
+size_t InflateStream::readBytes(char *buffer, size_t length)
+{
+  if (_encoding == INFLATE_IDENTITY)
+  {
+    return _in.readBytes(buffer, length);
+  }
+  size_t n = 0;
+  while (n < length && fill())
+  {
+    size_t chunk = min(length - n, _outEnd - _outPos);
+    memcpy(&buffer[n], &_window[_outPos], chunk);
+    _outPos += chunk;
+    n += chunk;
+  }
+  return n;
+}
@@ -0,0 +1,417 @@
+/* Streaming JSON pull reader for TRMNL OG Weather Station
+ * See json_stream.h for the memory bound and usage.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include "json_stream.h"
+
+JsonStreamReader::JsonStreamReader(Stream &in)
+  : _in(in), _pos(0), _len(0), _depth(0), _expectKey(false),
+    _afterKey(false), _hasUnread(false), _unread(0), _hasPeeked(false),
+    _peeked(JSON_STREAM_ERROR), _arrayMask(0), _bytesRead(0),
+    _bytesSkipped(0), _tokenStart(0), _stringLength(0),
+    _error(DeserializationError::Ok)
+{
+  _token[0] = '\0';
+}
+
+/* Reads one byte, refilling the local buffer from the Stream when empty. Only
+ * the bytes already available are requested so a read never blocks past the
+ * end of the document; when nothing is available a single byte is requested,
+ * which blocks for at most the Stream's timeout.
+ *
+ * Returns false at the end of the stream (or on timeout).
+ */
+bool JsonStreamReader::readByte(char &c)
+{
+  if (_hasUnread)
+  {
+    _hasUnread = false;
+    c = _unread;
+    return true;
+  }
+  if (_pos >= _len)
+  {
+    int avail = _in.available();
+    size_t want = avail > 0 ? std::min(static_cast<size_t>(avail),
+                                       sizeof(_buf))
+                            : 1;
+    _len = _in.readBytes(_buf, want);
+    _pos = 0;
+    if (_len == 0)
+    {
+      return false;
+    }
+    _bytesRead += _len;
+  }
+  c = _buf[_pos++];
+  return true;
+} // end readByte
+
+void JsonStreamReader::unreadByte(char c)
+{
+  _hasUnread = true;
+  _unread = c;
+} // end unreadByte
+
+json_stream_event_t JsonStreamReader::fail(DeserializationError::Code code)
+{
+  if (_error == DeserializationError::Ok)
+  {
+    _error = code;
+  }
+  return JSON_STREAM_ERROR;
+} // end fail
+
+/* Returns the number of bytes that have been tokenized, i.e. bytesRead() less
+ * what is still buffered.
+ */
+size_t JsonStreamReader::bytesConsumed() const
+{
+  return _bytesRead - (_len - _pos) - (_hasUnread ? 1 : 0);
+} // end bytesConsumed
+
+bool JsonStreamReader::inObject() const
+{
+  return _depth > 0 && !(_arrayMask & (1UL << (_depth - 1)));
+} // end inObject
+
+json_stream_event_t JsonStreamReader::push(bool isArray)
+{
+  if (_depth >= JSON_STREAM_MAX_DEPTH)
+  {
+    return fail(DeserializationError::TooDeep);
+  }
+  if (isArray)
+  {
+    _arrayMask |= 1UL << _depth;
+  }
+  else
+  {
+    _arrayMask &= ~(1UL << _depth);
+  }
+  ++_depth;
+  _expectKey = !isArray;
+  return isArray ? JSON_STREAM_ARRAY_BEGIN : JSON_STREAM_OBJECT_BEGIN;
+} // end push
+
+json_stream_event_t JsonStreamReader::pop(bool isArray)
+{
+  if (_depth == 0
+   || static_cast<bool>(_arrayMask & (1UL << (_depth - 1))) != isArray
+   || (!isArray && !_expectKey))
+  {
+    return fail(DeserializationError::InvalidInput);
+  }
+  --_depth;
+  _expectKey = inObject();
+  return isArray ? JSON_STREAM_ARRAY_END : JSON_STREAM_OBJECT_END;
+} // end pop
+
+/* Reads a string (the opening quote has already been consumed) into the token
+ * buffer, decoding escape sequences. \uXXXX escapes are encoded as UTF-8.
+ * Bytes beyond the buffer are dropped but counted in _stringLength.
+ */
+json_stream_event_t JsonStreamReader::readStringToken()
+{
+  size_t n = 0;
+  _stringLength = 0;
+  auto append = [&](char ch) {
+    if (n < sizeof(_token) - 1)
+    {
+      _token[n++] = ch;
+    }
+    ++_stringLength;
+  };
+
+  char c;
+  while (true)
+  {
+    if (!readByte(c))
+    {
+      return fail(DeserializationError::IncompleteInput);
+    }
+    if (c == '"')
+    {
+      break;
+    }
+    if (c != '\\')
+    {
+      append(c);
+      continue;
+    }
+
+    if (!readByte(c))
+    {
+      return fail(DeserializationError::IncompleteInput);
+    }
+    switch (c)
+    {
+    case 'b': append('\b'); break;
+    case 'f': append('\f'); break;
+    case 'n': append('\n'); break;
+    case 'r': append('\r'); break;
+    case 't': append('\t'); break;
+    case 'u':
+    {
+      uint16_t cp = 0;
+      for (int i = 0; i < 4; ++i)
+      {
+        if (!readByte(c))
+        {
+          return fail(DeserializationError::IncompleteInput);
+        }
+        cp <<= 4;
+        if      (c >= '0' && c <= '9') {cp |= c - '0';}
+        else if (c >= 'a' && c <= 'f') {cp |= c - 'a' + 10;}
+        else if (c >= 'A' && c <= 'F') {cp |= c - 'A' + 10;}
+        else    {return fail(DeserializationError::InvalidInput);}
+      }
+      if (cp < 0x80)
+      {
+        append(static_cast<char>(cp));
+      }
+      else if (cp < 0x800)
+      {
+        append(static_cast<char>(0xC0 | (cp >> 6)));
+        append(static_cast<char>(0x80 | (cp & 0x3F)));
+      }
+      else
+      {
+        append(static_cast<char>(0xE0 | (cp >> 12)));
+        append(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        append(static_cast<char>(0x80 | (cp & 0x3F)));
+      }
+      break;
+    }
+    default: append(c); break; // \" \\ \/
+    }
+  }
+  _token[n] = '\0';
+
+  if (_expectKey)
+  {
+    _expectKey = false;
+    _afterKey = true;
+    return JSON_STREAM_KEY;
+  }
+  _expectKey = inObject();
+  return JSON_STREAM_STRING;
+} // end readStringToken
+
+json_stream_event_t JsonStreamReader::readNumberToken(char first)
+{
+  size_t n = 0;
+  char c = first;
+  do
+  {
+    if (n < sizeof(_token) - 1)
+    {
+      _token[n++] = c;
+    }
+    if (!readByte(c))
+    {
+      c = '\0'; // a bare number can be the last thing in the stream
+      break;
+    }
+  } while ((c >= '0' && c <= '9')
+        || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E');
+  if (c != '\0')
+  {
+    unreadByte(c);
+  }
+  _token[n] = '\0';
+
+  _expectKey = inObject();
+  return JSON_STREAM_NUMBER;
+} // end readNumberToken
+
+json_stream_event_t JsonStreamReader::readLiteralToken(char first)
+{
+  size_t n = 0;
+  char c = first;
+  do
+  {
+    if (n < sizeof(_token) - 1)
+    {
+      _token[n++] = c;
+    }
+    if (!readByte(c))
+    {
+      c = '\0';
+      break;
+    }
+  } while (c >= 'a' && c <= 'z');
+  if (c != '\0')
+  {
+    unreadByte(c);
+  }
+  _token[n] = '\0';
+
+  _expectKey = inObject();
+  if (strcmp(_token, "true") == 0)  {return JSON_STREAM_TRUE;}
+  if (strcmp(_token, "false") == 0) {return JSON_STREAM_FALSE;}
+  if (strcmp(_token, "null") == 0)  {return JSON_STREAM_NULL;}
+  return fail(DeserializationError::InvalidInput);
+} // end readLiteralToken
+
+json_stream_event_t JsonStreamReader::next()
+{
+  if (_hasPeeked)
+  {
+    _hasPeeked = false;
+    return _peeked;
+  }
+  if (_error != DeserializationError::Ok)
+  {
+    return JSON_STREAM_ERROR;
+  }
+
+  char c;
+  while (true)
+  {
+    if (!readByte(c))
+    {
+      return fail(_bytesRead == 0 ? DeserializationError::EmptyInput
+                                  : DeserializationError::IncompleteInput);
+    }
+    if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+    {
+      continue;
+    }
+    if (_afterKey)
+    {
+      if (c != ':')
+      {
+        return fail(DeserializationError::InvalidInput);
+      }
+      _afterKey = false;
+      continue;
+    }
+    if (c == ',')
+    {
+      continue;
+    }
+    break;
+  }
+
+  _tokenStart = bytesConsumed() - 1;
+
+  if (_expectKey && c != '"' && c != '}')
+  {
+    return fail(DeserializationError::InvalidInput);
+  }
+
+  switch (c)
+  {
+  case '{': return push(false);
+  case '[': return push(true);
+  case '}': return pop(false);
+  case ']': return pop(true);
+  case '"': return readStringToken();
+  default:
+    if (c == '-' || (c >= '0' && c <= '9'))
+    {
+      return readNumberToken(c);
+    }
+    if (c >= 'a' && c <= 'z')
+    {
+      return readLiteralToken(c);
+    }
+    return fail(DeserializationError::InvalidInput);
+  }
+} // end next
+
+json_stream_event_t JsonStreamReader::peek()
+{
+  if (!_hasPeeked)
+  {
+    _peeked = next();
+    _hasPeeked = true;
+  }
+  return _peeked;
+} // end peek
+
+bool JsonStreamReader::skip(json_stream_event_t e)
+{
+  // e is the last token returned by next(), so it started at _tokenStart
+  const size_t start = _tokenStart;
+  switch (e)
+  {
+  case JSON_STREAM_ERROR:
+    return false;
+  case JSON_STREAM_OBJECT_END:
+  case JSON_STREAM_ARRAY_END:
+  case JSON_STREAM_KEY:
+    fail(DeserializationError::InvalidInput);
+    return false;
+  case JSON_STREAM_OBJECT_BEGIN:
+  case JSON_STREAM_ARRAY_BEGIN:
+  {
+    const uint8_t target = _depth - 1;
+    while (_depth > target)
+    {
+      if (next() == JSON_STREAM_ERROR)
+      {
+        return false;
+      }
+    }
+    _bytesSkipped += bytesConsumed() - start;
+    return true;
+  }
+  default:
+    _bytesSkipped += bytesConsumed() - start;
+    return true;
+  }
+} // end skip
+
+float JsonStreamReader::readFloat()
+{
+  json_stream_event_t e = next();
+  if (e == JSON_STREAM_NUMBER)
+  {
+    return strtof(_token, nullptr);
+  }
+  skip(e);
+  return 0;
+} // end readFloat
+
+int JsonStreamReader::readInt()
+{
+  json_stream_event_t e = next();
+  if (e == JSON_STREAM_NUMBER)
+  {
+    return static_cast<int>(strtol(_token, nullptr, 10));
+  }
+  skip(e);
+  return 0;
+} // end readInt
+
+int64_t JsonStreamReader::readInt64()
+{
+  json_stream_event_t e = next();
+  if (e == JSON_STREAM_NUMBER)
+  {
+    return strtoll(_token, nullptr, 10);
+  }
+  skip(e);
+  return 0;
+} // end readInt64
+
+size_t JsonStreamReader::readString(char *dst, size_t size)
+{
+  json_stream_event_t e = next();
+  if (e == JSON_STREAM_STRING)
+  {
+    strlcpy(dst, _token, size);
+    return _stringLength;
+  }
+  skip(e);
+  if (size > 0)
+  {
+    dst[0] = '\0';
+  }
+  return 0;
+} // end readString
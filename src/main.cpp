@@ -30,8 +30,16 @@
 #include "api_response.h"
 #include "client_utils.h"
 #include "display_utils.h"
+#include "dns_cache.h"
+#include "fetch_jobs.h"
+#include "http_connection.h"
 #include "icons/icons_196x196.h"
+#include "inflate_stream.h"
 #include "renderer.h"
+#include "request_scheduler.h"
+#include "time_keeper.h"
+#include "tls_session.h"
+#include "wake_profile.h"
 #include "watchdog.h"
 
 // Firmware version - update this when releasing new versions
@@ -59,9 +67,9 @@ static bool airPollutionSuccess = false;
 Preferences prefs;
 
 // MQTT client - IMPORTANT: Increase buffer size for HA auto-discovery JSON
-WiFiClient mqttWifiClient;
+CachedDnsClient mqttWifiClient;
 PubSubClient mqttClient(mqttWifiClient);
-// Note: setBufferSize(512) called in publishBatteryMQTT
+// Note: setBufferSize(768) called in publishBatteryMQTT
 
 // WiFi credentials from config.h (WIFI_SSID, WIFI_PASSWORD)
 
@@ -70,6 +78,10 @@ PubSubClient mqttClient(mqttWifiClient);
 // RTC memory survives deep sleep - store display mode
 RTC_DATA_ATTR DisplayMode currentDisplayMode = MODE_WEATHER;
 RTC_DATA_ATTR unsigned long lastButtonPressTime = 0;
+// Weather renders since power-on, by how much of the panel was refreshed
+RTC_DATA_ATTR uint32_t refreshFullCount = 0;
+RTC_DATA_ATTR uint32_t refreshPartialCount = 0;
+RTC_DATA_ATTR uint32_t refreshSkippedCount = 0;
 
 // Double-tap detection constants
 #define DOUBLE_TAP_WINDOW_MS 800 // Max time between taps for double-tap
@@ -77,54 +89,129 @@ RTC_DATA_ATTR unsigned long lastButtonPressTime = 0;
 // Forward declarations
 void executeButtonD1Routine();
 
-/* Fetch indoor temperature from Home Assistant using HTTPClient */
-float getHomeAssistantSensorState(const char *entity_id) {
-  HTTPClient http;
-
-  String url = String("http://") + HA_HOST + ":" + String(HA_PORT) +
-               "/api/states/" + entity_id;
-
-  Serial.print("Fetching HA sensor: ");
-  Serial.println(entity_id);
+/* Parses one Home Assistant state, NAN unless it is a number */
+static float parseHomeAssistantState(const char *state) {
+  char *end;
+  float value = strtof(state, &end);
+  while (isspace(static_cast<unsigned char>(*end))) {
+    ++end;
+  }
+  return (end == state || *end != '\0') ? NAN : value;
+}
 
-  http.begin(url);
-  http.addHeader("Authorization", String("Bearer ") + HA_TOKEN);
-  http.addHeader("Content-Type", "application/json");
-  http.setTimeout(10000);
+/* Fetch the states of count Home Assistant entities in one request.
+ *
+ * The /api/template endpoint renders the states separated by ';', in the
+ * order of entityIds, and they are parsed into values as they arrive, so the
+ * request costs the same single round trip for any number of entities. Home
+ * Assistant strips the rendered template, so nothing follows the last state
+ * but the end of the body.
+ * values[i] is NAN if the entity is unavailable, unknown or not numeric.
+ *
+ * Returns the HTTP status code.
+ */
+int getHomeAssistantStates(const char *const *entityIds, float *values,
+                           size_t count) {
+  unsigned long requestStart = millis();
+  for (size_t i = 0; i < count; ++i) {
+    values[i] = NAN;
+  }
 
-  int httpCode = http.GET();
+  String tpl = "{% for e in [";
+  for (size_t i = 0; i < count; ++i) {
+    tpl += i ? ",'" : "'";
+    tpl += entityIds[i];
+    tpl += "'";
+  }
+  tpl += "] %}{{ states(e) }}{{ ';' if not loop.last }}{% endfor %}";
+  JsonDocument request;
+  request["template"] = tpl;
+  String requestBody;
+  serializeJson(request, requestBody);
 
-  if (httpCode != HTTP_CODE_OK) {
+  CachedDnsClient client;
+  HTTPClient http;
+  String url =
+      String("http://") + HA_HOST + ":" + String(HA_PORT) + "/api/template";
+
+  Serial.printf("Fetching %u HA entities\n", static_cast<unsigned>(count));
+
+  request_schedule_t req;
+  beginRequest(req, "HA", 2, 10000);
+  int httpCode = 0;
+  unsigned timeout;
+  while ((timeout = nextAttempt(req)) > 0) {
+    http.begin(client, url);
+    http.addHeader("Authorization", String("Bearer ") + HA_TOKEN);
+    http.addHeader("Content-Type", "application/json");
+#ifdef STANDIN_HOST
+    http.addHeader(WAKE_HEADER, String(getWakeNumber()));
+#endif
+    http.setConnectTimeout(timeout);
+    http.setTimeout(timeout);
+#if HTTP_ACCEPT_COMPRESSION
+    acceptCompressedResponse(http);
+#endif
+    // The body is read from the raw connection, which does not undo chunked
+    // transfer encoding. HTTP/1.0 responses are never chunked.
+    http.useHTTP10(true);
+
+    httpCode = http.POST(requestBody);
+    endAttempt(req, httpCode);
+    if (httpCode == HTTP_CODE_OK) {
+      break;
+    }
     Serial.printf("HA request failed, code: %d\n", httpCode);
     http.end();
-    return NAN;
+  }
+  if (httpCode != HTTP_CODE_OK) {
+    addWakePhase(WAKE_PHASE_HTTP_HA, millis() - requestStart);
+    return httpCode;
   }
 
-  String payload = http.getString();
+  // Parsed straight off the (possibly compressed) connection, up to the end
+  // of the body, which the server marks by closing it (HTTP/1.0).
+  InflateStream body(http.getStream(), getResponseEncoding(http));
+  size_t n = 0;
+  if (body.begin()) {
+    char state[32];
+    size_t len = 0;
+    bool pending = false;
+    char c;
+    while (n < count && body.readBytes(&c, 1) == 1) {
+      if (c == ';') {
+        state[len] = '\0';
+        values[n++] = parseHomeAssistantState(state);
+        len = 0;
+        pending = false;
+      } else {
+        pending = true;
+        if (len < sizeof(state) - 1) {
+          state[len++] = c;
+        }
+      }
+    }
+    // the last state has no separator after it
+    if (pending && n < count) {
+      state[len] = '\0';
+      values[n++] = parseHomeAssistantState(state);
+    }
+  }
   http.end();
+  addWakePhase(WAKE_PHASE_HTTP_HA, millis() - requestStart);
 
-  // Parse JSON
-  JsonDocument doc;
-  DeserializationError error = deserializeJson(doc, payload);
-  if (error) {
-    Serial.print("HA JSON parse error: ");
-    Serial.println(error.c_str());
-    Serial.print("Payload: ");
-    Serial.println(
-        payload.substring(0, 100)); // Print first 100 chars for debug
-    return NAN;
+  for (size_t i = 0; i < count; ++i) {
+    if (std::isnan(values[i])) {
+      Serial.printf("HA %s unavailable or unknown\n", entityIds[i]);
+    } else {
+      Serial.printf("HA %s = %.1f\n", entityIds[i], values[i]);
+    }
   }
-
-  const char *state = doc["state"];
-  if (state && strcmp(state, "unavailable") != 0 &&
-      strcmp(state, "unknown") != 0) {
-    float value = atof(state);
-    Serial.printf("HA %s = %.1f\n", entity_id, value);
-    return value;
+  if (n < count) {
+    Serial.printf("HA response ended after %u of %u states\n",
+                  static_cast<unsigned>(n), static_cast<unsigned>(count));
   }
-
-  Serial.println("HA sensor unavailable or unknown");
-  return NAN;
+  return httpCode;
 }
 
 // PNG decoder instance and image buffer (global for callback access)
@@ -214,12 +301,16 @@ String base64Encode(const String &input) {
 
 /* Fetch PNG from Nextcloud WebDAV and display it */
 bool fetchAndDisplayNextcloudImage(const char *filename) {
-  WiFiClientSecure client;
-  client.setInsecure(); // Skip cert verification for Nextcloud
-  client.setTimeout(30000);
+  TlsSessionClient tlsClient;
+  tlsClient.setInsecure(); // Skip cert verification for Nextcloud
+  tlsClient.setTimeout(30000);
+  CachedDnsClient plainClient;
 
   HTTPClient http;
   String url = String(NEXTCLOUD_URL) + filename;
+  WiFiClient &client = url.startsWith("http://")
+                           ? static_cast<WiFiClient &>(plainClient)
+                           : tlsClient;
 
   Serial.print("Fetching image: ");
   Serial.println(url);
@@ -236,11 +327,16 @@ bool fetchAndDisplayNextcloudImage(const char *filename) {
   http.addHeader("Authorization", "Basic " + authEncoded);
   http.addHeader("User-Agent",
                  "TRMNL-Weather/1.0"); // Some servers require User-Agent
+#ifdef STANDIN_HOST
+  http.addHeader(WAKE_HEADER, String(getWakeNumber()));
+#endif
   http.setTimeout(30000);              // 30 second timeout for image download
   http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS); // Follow redirects
 
   Serial.println("Sending HTTP GET...");
+  unsigned long requestStart = millis();
   int httpCode = http.GET();
+  addWakePhase(WAKE_PHASE_HTTP_IMAGE, millis() - requestStart);
 
   if (httpCode != HTTP_CODE_OK) {
     Serial.printf("Nextcloud request failed, code: %d\n", httpCode);
@@ -298,6 +394,7 @@ bool fetchAndDisplayNextcloudImage(const char *filename) {
   }
 
   // Read image data
+  unsigned long downloadStart = millis();
   WiFiClient *stream = http.getStreamPtr();
   int bytesRead = 0;
   int lastPercent = 0;
@@ -318,6 +415,7 @@ bool fetchAndDisplayNextcloudImage(const char *filename) {
     delay(1);
   }
   http.end();
+  addWakePhase(WAKE_PHASE_HTTP_IMAGE, millis() - downloadStart);
 
   Serial.printf("Downloaded %d bytes\n", bytesRead);
   pngImageSize = bytesRead;
@@ -345,6 +443,7 @@ bool fetchAndDisplayNextcloudImage(const char *filename) {
   display.fillScreen(GxEPD_WHITE);
 
   // Open PNG from memory
+  unsigned long renderStart = millis();
   int rc = png.openRAM(pngImageBuffer, pngImageSize, pngDrawCallback);
   if (rc == PNG_SUCCESS) {
     Serial.printf("PNG: %d x %d, %d bpp\n", png.getWidth(), png.getHeight(),
@@ -367,10 +466,15 @@ bool fetchAndDisplayNextcloudImage(const char *filename) {
     display.print("PNG decode error");
   }
 
+  addWakePhase(WAKE_PHASE_RENDER, millis() - renderStart);
+  sampleWakeHeap();
+
   // Finish display update
+  unsigned long refreshStart = millis();
   while (display.nextPage())
     ;
   powerOffDisplay();
+  addWakePhase(WAKE_PHASE_REFRESH, millis() - refreshStart);
 
   free(pngImageBuffer);
   pngImageBuffer = nullptr;
@@ -399,14 +503,113 @@ bool checkDoubleTap() {
   return false;
 }
 
+/* Resolve the hosts the current display mode connects to, see prefetchHosts()
+ */
+static void prefetchModeHosts() {
+  if (currentDisplayMode == MODE_CARTOON) {
+    // https://host[:port]/path
+    String url = NEXTCLOUD_URL;
+    int start = url.indexOf("://");
+    start = start < 0 ? 0 : start + 3;
+    int end = start;
+    while (end < static_cast<int>(url.length()) && url[end] != '/' &&
+           url[end] != ':') {
+      end++;
+    }
+    String host = url.substring(start, end);
+    const char *hosts[] = {host.c_str()};
+    prefetchHosts(hosts, 1);
+    return;
+  }
+
+  const char *hosts[] = {
+      OWM_ENDPOINT.c_str(),
+#ifdef USE_HOME_ASSISTANT_INDOOR
+      HA_HOST,
+#endif
+#if BATTERY_MONITORING
+      MQTT_BROKER,
+#endif
+  };
+  prefetchHosts(hosts, sizeof(hosts) / sizeof(hosts[0]));
+}
+
+// Wake profile sensors are announced once per power-on, the retained configs
+// outlive deep sleep
+RTC_DATA_ATTR bool wakeProfileAnnounced = false;
+
+/* Announce one wake profile value to Home Assistant auto-discovery */
+static bool announceWakeSensor(const char *key, const char *name,
+                               const char *unit) {
+  JsonDocument doc;
+  doc["name"] = String("TRMNL Wake ") + name;
+  doc["state_topic"] = "trmnl_weather/wake";
+  doc["unit_of_measurement"] = unit;
+  doc["state_class"] = "measurement";
+  doc["value_template"] = String("{{ value_json.") + key + " }}";
+  doc["unique_id"] = String("trmnl_weather_wake_") + key;
+  doc["icon"] = strcmp(unit, "B") == 0 ? "mdi:memory" : "mdi:timer-outline";
+  doc["device"]["identifiers"][0] = "trmnl_weather_station";
+
+  String payload;
+  serializeJson(doc, payload);
+  String topic = String("homeassistant/sensor/trmnl_weather_wake_") + key +
+                 "/config";
+  bool ok = mqttClient.publish(topic.c_str(), payload.c_str(), true);
+  mqttClient.loop();
+  return ok;
+}
+
+/* Publish the profile of the previous wake (see wake_profile.h) to
+ * trmnl_weather/wake */
+static void publishWakeProfile() {
+  wake_profile_t profile;
+  if (!getLastWakeProfile(profile)) {
+    return;
+  }
+
+  if (!wakeProfileAnnounced) {
+    bool ok = true;
+    for (int i = 0; i < WAKE_PHASE_COUNT; i++) {
+      const char *phase = getWakePhaseName(static_cast<wake_phase_t>(i));
+      ok &= announceWakeSensor((String(phase) + "_ms").c_str(), phase, "ms");
+    }
+    ok &= announceWakeSensor("awake_ms", "awake", "ms");
+    ok &= announceWakeSensor("heap_min", "heap min", "B");
+    ok &= announceWakeSensor("max_alloc_min", "max alloc min", "B");
+    Serial.print("Wake profile config publish: ");
+    Serial.println(ok ? "OK" : "FAILED");
+    wakeProfileAnnounced = ok;
+  }
+
+  JsonDocument doc;
+  for (int i = 0; i < WAKE_PHASE_COUNT; i++) {
+    String key =
+        String(getWakePhaseName(static_cast<wake_phase_t>(i))) + "_ms";
+    doc[key] = profile.phaseMs[i];
+  }
+  doc["wake"] = profile.wake;
+  doc["awake_ms"] = profile.awakeMs;
+  doc["heap_min"] = profile.minFreeHeap;
+  doc["max_alloc_min"] = profile.minMaxAlloc;
+
+  String payload;
+  serializeJson(doc, payload);
+  Serial.print("MQTT wake profile: ");
+  Serial.println(payload);
+  if (mqttClient.publish("trmnl_weather/wake", payload.c_str(), true)) {
+    markLastWakeProfilePublished();
+  }
+}
+
 /* Publish battery telemetry to Home Assistant via MQTT */
 void publishBatteryMQTT(uint32_t batteryVoltage) {
   if (!mqttClient.connected()) {
     Serial.print("Connecting to MQTT...");
     mqttClient.setServer(MQTT_BROKER, MQTT_PORT);
     // CRITICAL: Increase buffer size for HA auto-discovery payloads (default
-    // 256 is too small!)
-    mqttClient.setBufferSize(512);
+    // 256 is too small!) The state and wake profile payloads come close to 512
+    mqttClient.setBufferSize(768);
 
     if (mqttClient.connect(MQTT_CLIENT_ID, MQTT_USERNAME, MQTT_PASSWORD)) {
       Serial.println("connected");
@@ -507,6 +710,27 @@ void publishBatteryMQTT(uint32_t batteryVoltage) {
   stateDoc["battery"] = batteryPercent;
   stateDoc["voltage"] = batteryVoltage;
   stateDoc["version"] = getFirmwareVersion();
+  stateDoc["wake"] = getWakeNumber();
+  stateDoc["refresh_full"] = refreshFullCount;
+  stateDoc["refresh_partial"] = refreshPartialCount;
+  stateDoc["refresh_skipped"] = refreshSkippedCount;
+  const wifi_connect_stats_t &wifiStats = getWiFiConnectStats();
+  stateDoc["wifi_fast"] = wifiStats.fastConnect;
+  stateDoc["wifi_cached_ip"] = wifiStats.cachedIP;
+  stateDoc["wifi_assoc_ms"] = wifiStats.assocMs;
+  stateDoc["wifi_ip_ms"] = wifiStats.ipMs;
+  stateDoc["wifi_total_ms"] = wifiStats.totalMs;
+  tls_handshake_stats_t tlsStats = getTlsHandshakeStats();
+  stateDoc["tls_full"] = tlsStats.full;
+  stateDoc["tls_resumed"] = tlsStats.resumed;
+  stateDoc["tls_failed"] = tlsStats.failed;
+  stateDoc["tls_ms"] = tlsStats.wakeMs;
+  time_confidence_t timeConfidence = getTimeConfidence();
+  stateDoc["time_ref"] = getTimeReferenceName(timeConfidence.reference);
+  stateDoc["time_synced"] = timeConfidence.synced;
+  stateDoc["time_error_ms"] = timeConfidence.errorMs;
+  stateDoc["time_drift_ppm"] = timeConfidence.driftPpm;
+  stateDoc["time_sync_age_min"] = timeConfidence.syncAgeS / 60;
 
   String statePayload;
   serializeJson(stateDoc, statePayload);
@@ -518,6 +742,7 @@ void publishBatteryMQTT(uint32_t batteryVoltage) {
   } else {
     Serial.println("MQTT publish failed");
   }
+  publishWakeProfile();
 
   // Process MQTT packets and give time for messages to be sent
   for (int i = 0; i < 10; i++) {
@@ -593,13 +818,186 @@ void beginDeepSleep(unsigned long startTime, tm *timeInfo) {
   uint32_t batteryVoltage = readBatteryVoltage();
   Serial.print(TXT_BATTERY_VOLTAGE);
   Serial.println(": " + String(batteryVoltage) + "mv");
+  endWakeProfile();
   Serial.flush();
   esp_deep_sleep_start();
 }
 
+/* Draws one page of the weather display. */
+void drawWeather(const weather_snapshot_meta_t &meta, tm &timeInfo,
+                 const String &dateStr, const String &statusStr,
+                 const String &refreshTimeStr, uint32_t batteryVoltage,
+                 unsigned long startTime) {
+  watchdogCheckAndSleep(startTime, 30);
+  Serial.println("Drawing current conditions...");
+  drawCurrentConditions(owm_onecall.current, owm_onecall.daily[0], meta.aqi,
+                        meta.inTemp, meta.inHumidity);
+  feedWatchdog();
+  Serial.println("Drawing outlook graph...");
+  drawOutlookGraph(owm_onecall.hourly, owm_onecall.daily, timeInfo);
+  feedWatchdog();
+  Serial.println("Drawing forecast...");
+  drawForecast(owm_onecall.daily, timeInfo);
+  feedWatchdog();
+  Serial.println("Drawing location/date...");
+  drawLocationDate(CITY_STRING, dateStr);
+#if DISPLAY_ALERTS
+  Serial.println("Drawing alerts...");
+  drawAlerts(owm_onecall.alerts, CITY_STRING, dateStr);
+  feedWatchdog();
+#endif
+  Serial.println("Drawing status bar...");
+  drawStatusBar(statusStr, refreshTimeStr, meta.wifiRSSI, batteryVoltage);
+  feedWatchdog();
+  delay(1); // Give system time to breathe
+  yield();
+  feedWatchdog();
+}
+
+/* Render the weather display from owm_onecall and meta. timeInfo is the
+ * current time, the refresh time shown is when the data was fetched. Unless
+ * forced, the refresh is skipped or shrunk to what changed (see
+ * DISPLAY_SKIP_UNCHANGED). */
+void renderWeather(const weather_snapshot_meta_t &meta, tm &timeInfo,
+                   uint32_t batteryVoltage, unsigned long startTime,
+                   bool force) {
+  time_t fetchedAt = static_cast<time_t>(meta.fetchedAt);
+  tm fetchedInfo = {};
+  localtime_r(&fetchedAt, &fetchedInfo);
+  String refreshTimeStr;
+  getRefreshTimeStr(refreshTimeStr, true, &fetchedInfo);
+  if (meta.timeErrorS > 0) {
+    refreshTimeStr += " \261" + String(meta.timeErrorS) + "s";
+  }
+  String dateStr;
+  getDateStr(dateStr, &timeInfo);
+  String statusStr = meta.status;
+
+#if DISPLAY_SKIP_UNCHANGED == 3
+  // drawn into the frame buffer first, the panel is only woken if it changed
+  watchdogCheckAndSleep(startTime, 30);
+  unsigned long drawStart = millis();
+  beginFrame();
+  drawWeather(meta, timeInfo, dateStr, statusStr, refreshTimeStr,
+              batteryVoltage, startTime);
+  unsigned long refreshStart = millis();
+  frame_refresh_t refresh = refreshFrame(force);
+  addWakePhase(WAKE_PHASE_RENDER, refreshStart - drawStart);
+  addWakePhase(WAKE_PHASE_REFRESH, millis() - refreshStart);
+  sampleWakeHeap();
+
+  if (refresh == FRAME_UNCHANGED) {
+    Serial.println("Display unchanged, skipping refresh");
+    ++refreshSkippedCount;
+  } else if (refresh == FRAME_PARTIAL) {
+    ++refreshPartialCount;
+  } else {
+    ++refreshFullCount;
+  }
+#else
+  // hashed before drawAlerts() rewrites the alert text
+  uint32_t contentHash =
+      getWeatherContentHash(owm_onecall, meta.aqi, meta.inTemp,
+                            meta.inHumidity, CITY_STRING, dateStr, timeInfo);
+  uint32_t statusBarHash =
+      getStatusBarHash(statusStr, meta.wifiRSSI, batteryVoltage);
+#if DISPLAY_SKIP_UNCHANGED == 1
+  if (!force && contentHash == panelContentHash
+      && statusBarHash == panelStatusBarHash) {
+    ++refreshSkippedCount;
+    Serial.println("Display unchanged, skipping refresh");
+    return;
+  }
+#endif
+
+  // RENDER WEATHER DISPLAY
+  watchdogCheckAndSleep(startTime, 30);
+  Serial.println("Initializing display...");
+  unsigned long refreshStart = millis();
+  unsigned long drawMs = 0;
+  initDisplay();
+  Serial.println("Display initialized.");
+  feedWatchdog();
+  do {
+    unsigned long pageStart = millis();
+    Serial.println("Loop start...");
+    drawWeather(meta, timeInfo, dateStr, statusStr, refreshTimeStr,
+                batteryVoltage, startTime);
+    drawMs += millis() - pageStart;
+    Serial.println("Page complete, waiting for next page...");
+  } while (display.nextPage());
+  Serial.println("Display rendering finished.");
+  powerOffDisplay();
+  addWakePhase(WAKE_PHASE_RENDER, drawMs);
+  addWakePhase(WAKE_PHASE_REFRESH, millis() - refreshStart - drawMs);
+  sampleWakeHeap();
+
+  ++refreshFullCount;
+  panelContentHash = contentHash;
+  panelStatusBarHash = statusBarHash;
+#endif
+#if DEBUG_LEVEL >= 1
+  Serial.printf("[debug] Refreshes       : %lu full, %lu partial, %lu skipped\n",
+                static_cast<unsigned long>(refreshFullCount),
+                static_cast<unsigned long>(refreshPartialCount),
+                static_cast<unsigned long>(refreshSkippedCount));
+#endif
+}
+
 /* Program entry point */
+/* Results of the weather mode requests. Each field is written only by its
+ * fetch job and read after runFetchJobs() returned.
+ */
+struct WeatherFetch {
+  int oneCallStatus = 0;
+  int airPollutionStatus = 0;
+  float inTemp = NAN;
+  float inHumidity = NAN;
+};
+
+#ifdef USE_HTTP
+typedef CachedDnsClient OWMClient;
+#else
+typedef TlsSessionClient OWMClient;
+#endif
+
+static void configureOWMClient(OWMClient &client) {
+#if defined(USE_HTTPS_NO_CERT_VERIF)
+  client.setInsecure();
+#elif defined(USE_HTTPS_WITH_CERT_VERIF)
+  client.setCACert(cert_Sectigo_RSA_Organization_Validation_Secure_Server_CA);
+#endif
+}
+
+/* Both OWM requests go to the same host, so they share one kept-alive
+ * connection (and one TLS handshake) rather than running concurrently.
+ * Air Pollution is skipped when One Call failed, that ends the wake anyway.
+ */
+static void fetchOWMJob(void *arg) {
+  WeatherFetch *fetch = static_cast<WeatherFetch *>(arg);
+  OWMClient client;
+  configureOWMClient(client);
+  HttpConnection owm(client, OWM_ENDPOINT, OWM_PORT);
+  fetch->oneCallStatus = getOWMonecall(owm, owm_onecall);
+  if (fetch->oneCallStatus == HTTP_CODE_OK) {
+    fetch->airPollutionStatus = getOWMairpollution(owm, owm_air_pollution);
+  }
+}
+
+#ifdef USE_HOME_ASSISTANT_INDOOR
+static void fetchIndoorJob(void *arg) {
+  WeatherFetch *fetch = static_cast<WeatherFetch *>(arg);
+  const char *entityIds[] = {HA_TEMP_ENTITY, HA_HUMIDITY_ENTITY};
+  float values[2];
+  getHomeAssistantStates(entityIds, values, 2);
+  fetch->inTemp = values[0];
+  fetch->inHumidity = values[1];
+}
+#endif
+
 void setup() {
   unsigned long startTime = millis();
+  beginWakeProfile();
   Serial.begin(115200);
   delay(100);
 
@@ -613,6 +1011,8 @@ void setup() {
   // Initialize watchdog timer (60 second timeout for large display refresh)
   initWatchdog(60);
   feedWatchdog();
+  beginWakeBudget(startTime);
+  beginTimeKeeping();
 
 
   // Check if we were reset by watchdog
@@ -754,6 +1154,21 @@ void setup() {
   String tmpStr = {};
   tm timeInfo = {};
 
+  // A single tap redraws the last fetched weather without powering the radio,
+  // as long as it is recent enough. The clock keeps running in deep sleep.
+  if (buttonPressed && !doubleTap && currentDisplayMode == MODE_WEATHER) {
+    weather_snapshot_meta_t meta;
+    if (loadWeatherSnapshot(owm_onecall, meta, SNAPSHOT_MAX_AGE)) {
+      Serial.println("Rendering saved weather snapshot");
+      setenv("TZ", TIMEZONE, 1);
+      tzset();
+      time_t now = time(nullptr);
+      localtime_r(&now, &timeInfo);
+      renderWeather(meta, timeInfo, batteryVoltage, startTime, true);
+      beginDeepSleep(startTime, &timeInfo);
+    }
+  }
+
   // START WIFI using saved credentials
   int wifiRSSI = 0;
   watchdogCheckAndSleep(startTime, 30);
@@ -775,11 +1190,25 @@ void setup() {
 
   // TIME SYNCHRONIZATION
   watchdogCheckAndSleep(startTime, 30);
-  configTzTime(TIMEZONE, NTP_SERVER_1, NTP_SERVER_2);
-  bool timeConfigured = waitForSNTPSync(&timeInfo);
+  bool timeConfigured;
+  if (isTimeSyncDue()) {
+    beginTimeSync();
+    configTzTime(TIMEZONE, NTP_SERVER_1, NTP_SERVER_2);
+    // Look up the hosts of this wake while SNTP waits for its reply
+    prefetchModeHosts();
+    timeConfigured = waitForSNTPSync(&timeInfo);
+    endTimeSync();
+  } else {
+    // the drift-corrected RTC is accurate enough, see time_keeper.h
+    setenv("TZ", TIMEZONE, 1);
+    tzset();
+    prefetchModeHosts();
+    timeConfigured = printLocalTime(&timeInfo);
+  }
   feedWatchdog();
   if (!timeConfigured) {
     Serial.println(TXT_TIME_SYNCHRONIZATION_FAILED);
+    forgetWiFiCache(); // in case the reused IP address no longer works
     killWiFi();
     initDisplay();
     do {
@@ -818,16 +1247,6 @@ void setup() {
   // WEATHER MODE - Fetch weather data
   // =========================================================================
   // MAKE API REQUESTS
-#ifdef USE_HTTP
-  WiFiClient client;
-#elif defined(USE_HTTPS_NO_CERT_VERIF)
-  WiFiClientSecure client;
-  client.setInsecure();
-#elif defined(USE_HTTPS_WITH_CERT_VERIF)
-  WiFiClientSecure client;
-  client.setCACert(cert_Sectigo_RSA_Organization_Validation_Secure_Server_CA);
-#endif
-
   feedWatchdog();
   watchdogCheckAndSleep(startTime, 30);
 
@@ -856,9 +1275,26 @@ void setup() {
     }
     Serial.println("[weather] WiFi reconnected");
   }
-  int rxStatus = getOWMonecall(client, owm_onecall);
+  WeatherFetch fetch;
+  fetch_job_t jobs[] = {
+      {"owm", fetchOWMJob, &fetch, 12288},
+#ifdef USE_HOME_ASSISTANT_INDOOR
+      {"ha", fetchIndoorJob, &fetch, 6144},
+#endif
+  };
+  if (!runFetchJobs(jobs, sizeof(jobs) / sizeof(jobs[0]),
+                    getRequestTimeLeft() + FETCH_GRACE)) {
+    // requests still running own the WiFi and the results, just sleep
+    beginDeepSleep(startTime, &timeInfo);
+  }
   feedWatchdog();
+  sampleWakeHeap();
+
+  int rxStatus = fetch.oneCallStatus;
   if (rxStatus != HTTP_CODE_OK) {
+    if (rxStatus < 0 && rxStatus > -256) {
+      forgetWiFiCache(); // connection failed, not the response
+    }
     killWiFi();
     statusStr = "One Call " + OWM_ONECALL_VERSION + " API";
     tmpStr = String(rxStatus, DEC) + ": " + getHttpResponsePhrase(rxStatus);
@@ -870,9 +1306,7 @@ void setup() {
     beginDeepSleep(startTime, &timeInfo);
   }
 
-  watchdogCheckAndSleep(startTime, 30);
-  rxStatus = getOWMairpollution(client, owm_air_pollution);
-  feedWatchdog();
+  rxStatus = fetch.airPollutionStatus;
   if (rxStatus != HTTP_CODE_OK) {
     Serial.println("Air Pollution API failed (non-critical)");
     statusStr = "Air Pollution API";
@@ -884,17 +1318,11 @@ void setup() {
     airPollutionSuccess = true;
   }
 
-  // GET INDOOR TEMPERATURE AND HUMIDITY from Home Assistant
-  float inTemp = NAN;
-  float inHumidity = NAN;
+  // INDOOR TEMPERATURE AND HUMIDITY from Home Assistant
+  float inTemp = fetch.inTemp;
+  float inHumidity = fetch.inHumidity;
 
 #ifdef USE_HOME_ASSISTANT_INDOOR
-  watchdogCheckAndSleep(startTime, 30);
-  Serial.println("Reading indoor sensors from Home Assistant...");
-  inTemp = getHomeAssistantSensorState(HA_TEMP_ENTITY);
-  inHumidity = getHomeAssistantSensorState(HA_HUMIDITY_ENTITY);
-  feedWatchdog();
-
   if (!std::isnan(inTemp) && !std::isnan(inHumidity)) {
     Serial.println("Home Assistant indoor readings OK");
   } else {
@@ -904,57 +1332,31 @@ void setup() {
 #endif
 
 // PUBLISH BATTERY TELEMETRY VIA MQTT
+// after the requests, so the TLS and time figures include this wake's
 #if BATTERY_MONITORING
-  watchdogCheckAndSleep(startTime, 30);
   Serial.println("[telemetry] Using MQTT for telemetry");
+  unsigned long mqttStart = millis();
   publishBatteryMQTT(batteryVoltage);
+  addWakePhase(WAKE_PHASE_MQTT, millis() - mqttStart);
   feedWatchdog();
 #endif
 
   killWiFi(); // WiFi no longer needed
 
-  String refreshTimeStr;
-  getRefreshTimeStr(refreshTimeStr, timeConfigured, &timeInfo);
-  String dateStr;
-  getDateStr(dateStr, &timeInfo);
-
-  // RENDER WEATHER DISPLAY
-  watchdogCheckAndSleep(startTime, 30);
-  Serial.println("Initializing display...");
-  initDisplay();
-  Serial.println("Display initialized.");
-  feedWatchdog();
-  do {
-    Serial.println("Loop start...");
-    watchdogCheckAndSleep(startTime, 30);
-    Serial.println("Drawing current conditions...");
-    drawCurrentConditions(owm_onecall.current, owm_onecall.daily[0],
-                          owm_air_pollution, airPollutionSuccess, inTemp,
-                          inHumidity);
-    feedWatchdog();
-    Serial.println("Drawing outlook graph...");
-    drawOutlookGraph(owm_onecall.hourly, owm_onecall.daily, timeInfo);
-    feedWatchdog();
-    Serial.println("Drawing forecast...");
-    drawForecast(owm_onecall.daily, timeInfo);
-    feedWatchdog();
-    Serial.println("Drawing location/date...");
-    drawLocationDate(CITY_STRING, dateStr);
-#if DISPLAY_ALERTS
-    Serial.println("Drawing alerts...");
-    drawAlerts(owm_onecall.alerts, CITY_STRING, dateStr);
-    feedWatchdog();
-#endif
-    Serial.println("Drawing status bar...");
-    drawStatusBar(statusStr, refreshTimeStr, wifiRSSI, batteryVoltage);
-    feedWatchdog();
-    delay(1); // Give system time to breathe
-    yield();
-    feedWatchdog();
-    Serial.println("Page complete, waiting for next page...");
-  } while (display.nextPage());
-  Serial.println("Display rendering finished.");
-  powerOffDisplay();
+  weather_snapshot_meta_t meta = {};
+  meta.fetchedAt = time(nullptr);
+  meta.aqi = airPollutionSuccess ? getAQI(owm_air_pollution) : -1;
+  meta.wifiRSSI = wifiRSSI;
+  time_confidence_t timeConfidence = getTimeConfidence();
+  meta.timeErrorS = timeConfidence.errorMs < 999000
+                        ? timeConfidence.errorMs / 1000 : 999;
+  meta.inTemp = inTemp;
+  meta.inHumidity = inHumidity;
+  strlcpy(meta.status, statusStr.c_str(), sizeof(meta.status));
+  // saved before rendering, drawAlerts() rewrites the alert text in place
+  saveWeatherSnapshot(owm_onecall, meta);
+
+  renderWeather(meta, timeInfo, batteryVoltage, startTime, buttonPressed);
 
   // DEEP SLEEP
   watchdogCheckAndSleep(startTime, 30);
@@ -0,0 +1,238 @@
+/* Retained panel frame for TRMNL OG Weather Station
+ * See panel_frame.h.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <Arduino.h>
+#include <esp_attr.h>
+#include <esp_rom_crc.h>
+#include <LittleFS.h>
+#include "config.h"
+#include "panel_frame.h"
+
+#define PANEL_FRAME_MAGIC 0x4D415246 // "FRAM"
+
+typedef struct panel_frame_header
+{
+  uint32_t magic;           // PANEL_FRAME_MAGIC while a frame is retained
+  uint32_t size;            // Frame bytes
+  uint32_t length;          // Bytes in PANEL_FRAME_FILE
+  uint32_t crc;             // CRC-32 of the frame
+  uint16_t partials;        // Partial refreshes since the last full one
+} panel_frame_header_t;
+
+static RTC_DATA_ATTR panel_frame_header_t rtcHeader;
+
+/* PackBits: a header byte n is followed by n + 1 literal bytes if n < 128, or
+ * by one byte repeated 257 - n times if n > 128.
+ *
+ * Returns the bytes written, 0 on failure.
+ */
+static size_t writePackBits(File &f, const uint8_t *data, size_t size)
+{
+  size_t length = 0;
+  size_t i = 0;
+  while (i < size)
+  {
+    size_t run = 1;
+    while (i + run < size && run < 128 && data[i + run] == data[i])
+    {
+      ++run;
+    }
+    if (run >= 3)
+    {
+      uint8_t record[2] = {static_cast<uint8_t>(257 - run), data[i]};
+      if (f.write(record, 2) != 2)
+      {
+        return 0;
+      }
+      length += 2;
+      i += run;
+      continue;
+    }
+
+    // literal bytes up to the next run of 3
+    size_t count = 0;
+    while (i + count < size && count < 128)
+    {
+      if (i + count + 2 < size && data[i + count] == data[i + count + 1]
+       && data[i + count] == data[i + count + 2])
+      {
+        break;
+      }
+      ++count;
+    }
+    uint8_t header = count - 1;
+    if (f.write(&header, 1) != 1 || f.write(&data[i], count) != count)
+    {
+      return 0;
+    }
+    length += 1 + count;
+    i += count;
+  }
+  return length;
+} // end writePackBits
+
+static bool readPackBits(File &f, uint8_t *frame, size_t size)
+{
+  size_t pos = 0;
+  int n;
+  while (pos < size && (n = f.read()) >= 0)
+  {
+    if (n < 128)
+    {
+      size_t count = n + 1;
+      if (pos + count > size || f.read(&frame[pos], count) != count)
+      {
+        return false;
+      }
+      pos += count;
+    }
+    else if (n > 128)
+    {
+      size_t count = 257 - n;
+      int value = f.read();
+      if (value < 0 || pos + count > size)
+      {
+        return false;
+      }
+      memset(&frame[pos], value, count);
+      pos += count;
+    }
+  }
+  return pos == size;
+} // end readPackBits
+
+uint8_t *loadPanelFrame(size_t size)
+{
+  if (rtcHeader.magic != PANEL_FRAME_MAGIC || rtcHeader.size != size)
+  {
+    return nullptr;
+  }
+  uint8_t *frame = static_cast<uint8_t *>(malloc(size));
+  if (frame == nullptr)
+  {
+    return nullptr;
+  }
+  if (!LittleFS.begin(false))
+  {
+    free(frame);
+    return nullptr;
+  }
+  File f = LittleFS.open(PANEL_FRAME_FILE, FILE_READ);
+  bool ok = f && f.size() == rtcHeader.length && readPackBits(f, frame, size)
+         && esp_rom_crc32_le(0, frame, size) == rtcHeader.crc;
+  f.close();
+  LittleFS.end();
+  if (!ok)
+  {
+    Serial.println("Panel frame: read failed");
+    free(frame);
+    return nullptr;
+  }
+  return frame;
+} // end loadPanelFrame
+
+bool savePanelFrame(const uint8_t *frame, size_t size, bool partial)
+{
+  uint16_t partials = partial ? rtcHeader.partials + 1 : 0;
+  // the previous frame is invalid until the new one is complete
+  rtcHeader = {};
+  rtcHeader.partials = partials;
+
+  if (!LittleFS.begin(true))
+  {
+    Serial.println("Panel frame: LittleFS mount failed");
+    return false;
+  }
+  File f = LittleFS.open(PANEL_FRAME_FILE, FILE_WRITE);
+  size_t length = f ? writePackBits(f, frame, size) : 0;
+  f.close();
+  LittleFS.end();
+  if (length == 0)
+  {
+    Serial.println("Panel frame: write failed");
+    return false;
+  }
+
+  rtcHeader.size   = size;
+  rtcHeader.length = length;
+  rtcHeader.crc    = esp_rom_crc32_le(0, frame, size);
+  rtcHeader.magic  = PANEL_FRAME_MAGIC;
+#if DEBUG_LEVEL >= 1
+  Serial.println("[debug] Panel frame     : " + String(length) + " B, "
+                 + String(partials) + " partial refreshes since full");
+#endif
+  return true;
+} // end savePanelFrame
+
+void forgetPanelFrame()
+{
+  rtcHeader = {};
+} // end forgetPanelFrame
+
+bool isFullRefreshDue()
+{
+  return rtcHeader.partials >= DISPLAY_PARTIAL_REFRESHES;
+} // end isFullRefreshDue
+
+uint8_t diffPanelFrame(const uint8_t *previous, const uint8_t *current,
+                       uint16_t stride, uint16_t rows, panel_rect_t *rects,
+                       uint8_t maxRects)
+{
+  uint8_t count = 0;
+  for (uint16_t top = 0; top < rows; top += PANEL_FRAME_BAND)
+  {
+    uint16_t bottom = top + PANEL_FRAME_BAND < rows ? top + PANEL_FRAME_BAND
+                                                    : rows;
+    // changed bytes of the band's rows
+    int first = stride;
+    int last = -1;
+    for (uint16_t row = top; row < bottom; ++row)
+    {
+      const uint8_t *p = &previous[row * stride];
+      const uint8_t *c = &current[row * stride];
+      if (memcmp(p, c, stride) == 0)
+      {
+        continue;
+      }
+      int i = 0;
+      while (p[i] == c[i])
+      {
+        ++i;
+      }
+      int j = stride - 1;
+      while (p[j] == c[j])
+      {
+        --j;
+      }
+      first = i < first ? i : first;
+      last = j > last ? j : last;
+    }
+    if (last < 0)
+    {
+      continue;
+    }
+
+    panel_rect_t band = {static_cast<int16_t>(first * 8),
+                         static_cast<int16_t>(top),
+                         static_cast<int16_t>((last - first + 1) * 8),
+                         static_cast<int16_t>(bottom - top)};
+    if (count == 0 || (count < maxRects
+                       && rects[count - 1].y + rects[count - 1].h < top))
+    {
+      rects[count++] = band;
+      continue;
+    }
+    // join the band to the last rectangle
+    panel_rect_t *r = &rects[count - 1];
+    int16_t left = r->x < band.x ? r->x : band.x;
+    int16_t right = r->x + r->w > band.x + band.w ? r->x + r->w
+                                                  : band.x + band.w;
+    r->x = left;
+    r->w = right - left;
+    r->h = bottom - r->y;
+  }
+  return count;
+} // end diffPanelFrame
@@ -0,0 +1,57 @@
+/* API response parse profiling for TRMNL OG Weather Station
+ * See parse_profile.h for the output format.
+ */
+
+#include <esp_heap_caps.h>
+#include "parse_profile.h"
+
+void beginParseProfile(parse_profile_t &p)
+{
+  multi_heap_info_t info;
+  heap_caps_get_info(&info, MALLOC_CAP_DEFAULT);
+  p = {};
+  p.freeStart   = info.total_free_bytes;
+  p.blocksStart = info.allocated_blocks;
+  p.minStart    = info.minimum_free_bytes;
+  p.startUs     = micros();
+} // end beginParseProfile
+
+void endParseProfile(parse_profile_t &p, const CountingStream &in)
+{
+  p.us = micros() - p.startUs;
+  p.bytes = in.count();
+
+  multi_heap_info_t info;
+  heap_caps_get_info(&info, MALLOC_CAP_DEFAULT);
+  p.heapDelta  = static_cast<int32_t>(info.total_free_bytes)
+                 - static_cast<int32_t>(p.freeStart);
+  p.blockDelta = static_cast<int32_t>(info.allocated_blocks)
+                 - static_cast<int32_t>(p.blocksStart);
+  // The low-water mark is global, so the parse's peak can only be derived
+  // when the parse itself lowered it.
+  p.heapPeak   = info.minimum_free_bytes < p.minStart
+                 ? static_cast<int32_t>(p.freeStart - info.minimum_free_bytes)
+                 : -1;
+  p.heapMin    = info.minimum_free_bytes;
+  p.maxBlock   = info.largest_free_block;
+} // end endParseProfile
+
+void printParseProfile(const char *fn, const parse_profile_t &p,
+                       DeserializationError err,
+                       const owm_parse_stats_t &stats)
+{
+  Serial.printf("[profile] {\"fn\":\"%s\",\"err\":%d,\"us\":%lu,"
+                "\"bytes\":%u,\"skipped\":%u,\"early\":%d,"
+                "\"heap_delta\":%ld,\"block_delta\":%ld,\"heap_peak\":%ld,"
+                "\"heap_min\":%u,\"max_block\":%u}\n",
+                fn, static_cast<int>(err.code()),
+                static_cast<unsigned long>(p.us),
+                static_cast<unsigned>(p.bytes),
+                static_cast<unsigned>(stats.bytesSkipped),
+                stats.terminatedEarly ? 1 : 0,
+                static_cast<long>(p.heapDelta),
+                static_cast<long>(p.blockDelta),
+                static_cast<long>(p.heapPeak),
+                static_cast<unsigned>(p.heapMin),
+                static_cast<unsigned>(p.maxBlock));
+} // end printParseProfile
@@ -10,6 +10,9 @@
 #include "config.h"
 #include "conversions.h"
 #include "display_utils.h"
+#include "frame_buffer.h"
+#include "panel_frame.h"
+#include "text_layout.h"
 #include <SPI.h>
 
 // fonts
@@ -44,6 +47,11 @@ GxEPD2_BW<GxEPD2_750, GxEPD2_750::HEIGHT>
 #define ACCENT_COLOR GxEPD_BLACK
 #endif
 
+// Hashes of the weather display on the panel (see getWeatherContentHash()),
+// cleared whenever the panel is cleared to draw something else.
+RTC_DATA_ATTR uint32_t panelContentHash = 0;
+RTC_DATA_ATTR uint32_t panelStatusBarHash = 0;
+
 // =============================================================================
 // TRMNL OG MARGIN SYSTEM
 // The physical frame covers edge pixels. We apply offsets to create margins.
@@ -57,18 +65,12 @@ GxEPD2_BW<GxEPD2_750, GxEPD2_750::HEIGHT>
 
 /* Returns the string width in pixels */
 uint16_t getStringWidth(const String &text) {
-  int16_t x1, y1;
-  uint16_t w, h;
-  display.getTextBounds(text, 0, 0, &x1, &y1, &w, &h);
-  return w;
+  return measureText(text).w;
 }
 
 /* Returns the string height in pixels */
 uint16_t getStringHeight(const String &text) {
-  int16_t x1, y1;
-  uint16_t w, h;
-  display.getTextBounds(text, 0, 0, &x1, &y1, &w, &h);
-  return h;
+  return measureText(text).h;
 }
 
 /* Draws a string with alignment - applies MARGIN offsets */
@@ -78,15 +80,13 @@ void drawString(int16_t x, int16_t y, const String &text, alignment_t alignment,
   x += MARGIN_X;
   y += MARGIN_Y;
 
-  int16_t x1, y1;
-  uint16_t w, h;
   display.setTextColor(color);
-  display.getTextBounds(text, x, y, &x1, &y1, &w, &h);
+  // left aligned text is drawn without measuring it
   if (alignment == RIGHT) {
-    x = x - w;
+    x = x - getStringWidth(text);
   }
   if (alignment == CENTER) {
-    x = x - w / 2;
+    x = x - getStringWidth(text) / 2;
   }
   display.setCursor(x, y);
   display.print(text);
@@ -96,71 +96,87 @@ void drawString(int16_t x, int16_t y, const String &text, alignment_t alignment,
 /* Helper to draw bitmap with margin offsets */
 void drawBmp(int16_t x, int16_t y, const uint8_t *bitmap, int16_t w, int16_t h,
              uint16_t color) {
+  frame_buffer_t fb;
+  if (getFrameBuffer(fb)) {
+    blitInvertedBitmap(fb, x + MARGIN_X, y + MARGIN_Y, bitmap, w, h,
+                       color != GxEPD_BLACK);
+    return;
+  }
   display.drawInvertedBitmap(x + MARGIN_X, y + MARGIN_Y, bitmap, w, h, color);
 }
 
+/* Helpers to fill with a pattern through the frame buffer, see fillPattern()
+ * and drawDashedHLine(). Coordinates include the margins.
+ */
+static const uint8_t solidPattern[8] = {0xFF, 0xFF, 0xFF, 0xFF,
+                                        0xFF, 0xFF, 0xFF, 0xFF};
+
+static void fillPatternRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                            const uint8_t pattern[8], uint16_t color) {
+  frame_buffer_t fb;
+  if (getFrameBuffer(fb)) {
+    fillPattern(fb, x, y, w, h, pattern,
+                color != GxEPD_BLACK ? RASTER_OR : RASTER_AND);
+    return;
+  }
+  for (int16_t j = y; j < y + h; ++j) {
+    for (int16_t i = x; i < x + w; ++i) {
+      if (pattern[j & 7] & (0x80 >> (i & 7))) {
+        display.drawPixel(i, j, color);
+      }
+    }
+  }
+}
+
+static void drawDashedLine(int16_t x, int16_t y, int16_t w, uint8_t pattern,
+                           uint8_t period, uint16_t color) {
+  frame_buffer_t fb;
+  if (getFrameBuffer(fb)) {
+    drawDashedHLine(fb, x, y, w, pattern, period,
+                    color != GxEPD_BLACK ? RASTER_OR : RASTER_AND);
+    return;
+  }
+  for (int16_t i = 0; i < w; ++i) {
+    if (pattern & (0x80 >> (i % period))) {
+      display.drawPixel(x + i, y, color);
+    }
+  }
+}
+
 /* Draws a string that will flow into the next line when max_width is reached.
  */
 void drawMultiLnString(int16_t x, int16_t y, const String &text,
                        alignment_t alignment, uint16_t max_width,
                        uint16_t max_lines, int16_t line_spacing,
                        uint16_t color) {
-  uint16_t current_line = 0;
-  String textRemaining = text;
-  while (current_line < max_lines && !textRemaining.isEmpty()) {
-    int16_t x1, y1;
-    uint16_t w, h;
-
-    display.getTextBounds(textRemaining, 0, 0, &x1, &y1, &w, &h);
-
-    int endIndex = textRemaining.length();
-    String subStr = textRemaining;
-    int splitAt = 0;
-    int keepLastChar = 0;
-    while (w > max_width && splitAt != -1) {
-      if (keepLastChar) {
-        subStr.remove(subStr.length() - 1);
-      }
-
-      if (current_line < max_lines - 1) {
-        splitAt = std::max(subStr.lastIndexOf(" "), subStr.lastIndexOf("-"));
-      } else {
-        splitAt = subStr.lastIndexOf(" ");
-      }
-
-      if (splitAt != -1) {
-        endIndex = splitAt;
-        subStr = subStr.substring(0, endIndex + 1);
-
-        char lastChar = subStr.charAt(endIndex);
-        if (lastChar == ' ') {
-          keepLastChar = 0;
-          subStr.remove(endIndex);
-          --endIndex;
-        } else if (lastChar == '-') {
-          keepLastChar = 1;
-        }
-
-        if (current_line < max_lines - 1) {
-          display.getTextBounds(subStr, 0, 0, &x1, &y1, &w, &h);
-        } else {
-          display.getTextBounds(subStr + "...", 0, 0, &x1, &y1, &w, &h);
-          if (w <= max_width) {
-            subStr = subStr + "...";
-          }
-        }
-      }
+  const char *textRemaining = text.c_str();
+  display.setTextColor(color);
+  for (uint16_t current_line = 0;
+       current_line < max_lines && *textRemaining != '\0'; ++current_line) {
+    text_line_t line = breakTextLine(textRemaining, max_width,
+                                     current_line == max_lines - 1);
+    int16_t lineX = x + MARGIN_X;
+    if (alignment == RIGHT) {
+      lineX = lineX - line.w;
     }
-
-    drawString(x, y + (current_line * line_spacing), subStr, alignment, color);
-    textRemaining = textRemaining.substring(endIndex + 2 - keepLastChar);
-    ++current_line;
+    if (alignment == CENTER) {
+      lineX = lineX - line.w / 2;
+    }
+    display.setCursor(lineX, y + MARGIN_Y + (current_line * line_spacing));
+    display.write(reinterpret_cast<const uint8_t *>(textRemaining), line.len);
+    if (line.ellipsis) {
+      display.print("...");
+    }
+    textRemaining += line.next;
   }
   return;
 }
 
-/* Initialize e-paper display - TRMNL OG specific */
-void initDisplay() {
+/* Powers on and initializes the panel, leaving the frame buffer as it is.
+ * initial = false skips the clearing full refresh so the current image can be
+ * partially updated.
+ */
+static void initPanel(bool initial) {
   // Power on display (if applicable)
   if (PIN_EPD_PWR != 255 && PIN_EPD_PWR != (uint8_t)-1) {
     pinMode(PIN_EPD_PWR, OUTPUT);
@@ -187,17 +203,26 @@ void initDisplay() {
 #ifdef DRIVER_WAVESHARE
   Serial.println("Initializing display with WAVESHARE driver...");
   // Parameter: (serial_diag_bitrate, initial, reset_duration, pulldown_rst_mode, spi, spi_settings)
-  display.init(0, true, 2, false);
+  display.init(0, initial, 2, false);
 #endif
 #ifdef DRIVER_DESPI_C02
   Serial.println("Initializing display with DESPI_C02 driver...");
   // Ohne SPI-Parameter - lässt GxEPD2 SPI selbst initialisieren
   // reset_duration=10ms, kein pulldown auf RST
-  display.init(0, true, 10, false);
+  display.init(0, initial, 10, false);
 #endif
 
   Serial.println("Display init completed");
-  
+  return;
+}
+
+/* Initialize e-paper display - TRMNL OG specific */
+void initDisplay() {
+  panelContentHash = 0;
+  panelStatusBarHash = 0;
+  forgetPanelFrame();
+  initPanel(true);
+
   // Test: Kann das Display kommunizieren?
   Serial.println("Testing display communication...");
   display.fillScreen(GxEPD_WHITE);
@@ -212,6 +237,75 @@ void initDisplay() {
   return;
 }
 
+#if defined(DISP_BW_V2) || defined(DISP_BW_V1)
+/* Clears the frame buffer for a frame drawn in one go and shown with
+ * refreshFrame(). The panel isn't touched.
+ */
+void beginFrame() {
+  display.setRotation(0);
+  display.setTextSize(1);
+  display.setTextColor(GxEPD_BLACK);
+  display.setTextWrap(false);
+  display.setFullWindow();
+  display.fillScreen(GxEPD_WHITE);
+  return;
+}
+
+/* Shows the frame drawn since beginFrame(). Unless full is set, it is compared
+ * with the frame retained from the last refresh: the panel isn't touched if
+ * they are identical, and only the changed areas are partially refreshed
+ * until DISPLAY_PARTIAL_REFRESHES partial refreshes call for a full one.
+ */
+frame_refresh_t refreshFrame(bool full) {
+  frame_buffer_t fb;
+  if (!getFrameBuffer(fb)) {
+    initPanel(true);
+    display.display(false);
+    powerOffDisplay();
+    forgetPanelFrame();
+    return FRAME_FULL;
+  }
+  size_t size = fb.stride * fb.h;
+  uint8_t *previous = full ? nullptr : loadPanelFrame(size);
+  panel_rect_t rects[PANEL_FRAME_MAX_RECTS];
+  uint8_t count = 0;
+  if (previous != nullptr) {
+    count = diffPanelFrame(previous, fb.data, fb.stride, fb.h, rects,
+                           PANEL_FRAME_MAX_RECTS);
+    if (count == 0) {
+      free(previous);
+      return FRAME_UNCHANGED;
+    }
+  }
+
+  bool partial = previous != nullptr && !isFullRefreshDue();
+  initPanel(!partial);
+  if (partial) {
+    // the controller lost the image on the panel while hibernating, the
+    // partial refresh needs it to compare with
+    display.epd2.writeImageAgain(previous, 0, 0, fb.w, fb.h);
+    for (uint8_t i = 0; i < count; ++i) {
+#if DEBUG_LEVEL >= 1
+      Serial.printf("[debug] Partial window  : %d,%d %dx%d\n", rects[i].x,
+                    rects[i].y, rects[i].w, rects[i].h);
+#endif
+      display.displayWindow(rects[i].x, rects[i].y, rects[i].w, rects[i].h);
+    }
+  } else {
+    display.display(false);
+  }
+  free(previous);
+  powerOffDisplay();
+  savePanelFrame(fb.data, size, partial);
+  return partial ? FRAME_PARTIAL : FRAME_FULL;
+}
+#elif DISPLAY_SKIP_UNCHANGED == 3
+#error "DISPLAY_SKIP_UNCHANGED 3 needs a black and white panel"
+#endif
+#if DISPLAY_SKIP_UNCHANGED == 2
+#error "DISPLAY_SKIP_UNCHANGED 2 was removed, use 3 for partial refreshes"
+#endif
+
 /* Power-off e-paper display */
 void powerOffDisplay() {
   display.hibernate();
@@ -221,12 +315,10 @@ void powerOffDisplay() {
   return;
 }
 
-/* Draw current conditions */
+/* Draw current conditions, aqi is negative if it is unavailable */
 void drawCurrentConditions(const owm_current_t &current,
                            const owm_daily_t &today,
-                           const owm_resp_air_pollution_t &owm_air_pollution,
-                           bool airPollutionSuccess, float inTemp,
-                           float inHumidity) {
+                           int aqi, float inTemp, float inHumidity) {
   String dataStr, unitStr;
 
   // current weather icon
@@ -403,10 +495,7 @@ void drawCurrentConditions(const owm_current_t &current,
 #ifndef DISP_BW_V1
   // air quality index
   display.setFont(&FONT_12pt8b);
-  if (airPollutionSuccess) {
-    const owm_components_t &c = owm_air_pollution.components;
-    int aqi = calc_aqi(AQI_SCALE, c.co, c.nh3, c.no, c.no2, c.o3, NULL, c.so2,
-                       c.pm10, c.pm2_5);
+  if (aqi >= 0) {
     int aqi_max = aqi_scale_max(AQI_SCALE);
     if (aqi > aqi_max)
       dataStr = "> " + String(aqi_max);
@@ -606,22 +695,19 @@ void drawForecast(const owm_daily_t *daily, tm timeInfo) {
 }
 
 /* Draw alerts */
-void drawAlerts(std::vector<owm_alerts_t> &alerts, const String &city,
+void drawAlerts(owm_alert_list_t &alerts, const String &city,
                 const String &date) {
 #if DEBUG_LEVEL >= 1
-  Serial.println("[debug] alerts.size()    : " + String(alerts.size()));
+  Serial.printf("[debug] alerts.count    : %u (dropped %u, truncated %u event"
+                " %u tags)\n",
+                alerts.count, alerts.dropped, alerts.truncatedEvents,
+                alerts.truncatedTags);
 #endif
-  if (alerts.size() == 0)
+  if (alerts.count == 0)
     return;
 
-  int *ignore_list = (int *)calloc(alerts.size(), sizeof(*ignore_list));
-  int *alert_indices = (int *)calloc(alerts.size(), sizeof(*alert_indices));
-  if (!ignore_list || !alert_indices) {
-    Serial.println("Error: Failed to allocate memory for alerts.");
-    free(ignore_list);
-    free(alert_indices);
-    return;
-  }
+  bool ignore_list[OWM_NUM_ALERTS] = {};
+  int alert_indices[OWM_NUM_ALERTS];
 
   filterAlerts(alerts, ignore_list);
 
@@ -632,7 +718,7 @@ void drawAlerts(std::vector<owm_alerts_t> &alerts, const String &city,
   int max_w = EFF_WIDTH - 2 - std::max(city_w, date_w) - (196 + 4) - 8;
 
   int num_valid_alerts = 0;
-  for (int i = 0; i < alerts.size(); ++i) {
+  for (int i = 0; i < alerts.count; ++i) {
     if (!ignore_list[i]) {
       alert_indices[num_valid_alerts] = i;
       ++num_valid_alerts;
@@ -641,7 +727,7 @@ void drawAlerts(std::vector<owm_alerts_t> &alerts, const String &city,
 
   if (num_valid_alerts == 1) {
     max_w -= 48;
-    owm_alerts_t &cur_alert = alerts[alert_indices[0]];
+    owm_alerts_t &cur_alert = alerts.alert[alert_indices[0]];
     drawBmp(196, 8, getAlertBitmap48(cur_alert), 48, 48, ACCENT_COLOR);
     toTitleCase(cur_alert.event);
     display.setFont(&FONT_14pt8b);
@@ -660,7 +746,7 @@ void drawAlerts(std::vector<owm_alerts_t> &alerts, const String &city,
     max_w -= 32;
     display.setFont(&FONT_12pt8b);
     for (int i = 0; i < 2; ++i) {
-      owm_alerts_t &cur_alert = alerts[alert_indices[i]];
+      owm_alerts_t &cur_alert = alerts.alert[alert_indices[i]];
       drawBmp(196, (i * 32), getAlertBitmap32(cur_alert), 32, 32, ACCENT_COLOR);
       toTitleCase(cur_alert.event);
       drawMultiLnString(196 + 32 + 3, 5 + 17 + (i * 32), cur_alert.event, LEFT,
@@ -668,8 +754,6 @@ void drawAlerts(std::vector<owm_alerts_t> &alerts, const String &city,
     }
   }
 
-  free(ignore_list);
-  free(alert_indices);
   return;
 }
 
@@ -714,6 +798,8 @@ void drawOutlookGraph(const owm_hourly_t *hourly, const owm_daily_t *daily,
   int xPos1 = EFF_WIDTH;
   const int yPos0 = 216;
   const int yPos1 = EFF_HEIGHT - 46;
+  // only OWM_NUM_HOURLY hours are parsed, see api_response.h
+  const int hourlyGraphMax = std::min(HOURLY_GRAPH_MAX, OWM_NUM_HOURLY);
 
   // Calculate bounds
   int yMajorTicks = 5;
@@ -736,7 +822,7 @@ void drawOutlookGraph(const owm_hourly_t *hourly, const owm_daily_t *daily,
   float newTemp = 0;
 
   Serial.println("Calculating graph bounds...");
-  for (int i = 1; i < HOURLY_GRAPH_MAX; ++i) {
+  for (int i = 1; i < hourlyGraphMax; ++i) {
 #ifdef UNITS_TEMP_CELSIUS
     newTemp = kelvin_to_celsius(hourly[i].temp);
 #endif
@@ -798,10 +884,8 @@ void drawOutlookGraph(const owm_hourly_t *hourly, const owm_daily_t *daily,
     xPos1 -= 23;
 
   // Draw axes with offset
-  display.drawLine(xPos0 + MARGIN_X, yPos1 + MARGIN_Y, xPos1 + MARGIN_X,
-                   yPos1 + MARGIN_Y, GxEPD_BLACK);
-  display.drawLine(xPos0 + MARGIN_X, yPos1 - 1 + MARGIN_Y, xPos1 + MARGIN_X,
-                   yPos1 - 1 + MARGIN_Y, GxEPD_BLACK);
+  fillPatternRect(xPos0 + MARGIN_X, yPos1 - 1 + MARGIN_Y, xPos1 - xPos0 + 1, 2,
+                  solidPattern, GxEPD_BLACK);
 
   float yInterval = (yPos1 - yPos0) / static_cast<float>(yMajorTicks);
   for (int i = 0; i <= yMajorTicks; ++i) {
@@ -829,30 +913,30 @@ void drawOutlookGraph(const owm_hourly_t *hourly, const owm_daily_t *daily,
     }
 
     if (i < yMajorTicks) {
-      for (int x = xPos0 + MARGIN_X; x <= xPos1 + 1 + MARGIN_X; x += 3) {
-        display.drawPixel(x, yTick + (yTick % 2) + MARGIN_Y, GxEPD_BLACK);
-      }
+      // a dot every 3px
+      drawDashedLine(xPos0 + MARGIN_X, yTick + (yTick % 2) + MARGIN_Y,
+                     xPos1 + 2 - xPos0, 0x80, 3, GxEPD_BLACK);
     }
   }
 
   int xMaxTicks = 8;
   int hourInterval =
-      static_cast<int>(ceil(HOURLY_GRAPH_MAX / static_cast<float>(xMaxTicks)));
-  float xInterval = (xPos1 - xPos0 - 1) / static_cast<float>(HOURLY_GRAPH_MAX);
+      static_cast<int>(ceil(hourlyGraphMax / static_cast<float>(xMaxTicks)));
+  float xInterval = (xPos1 - xPos0 - 1) / static_cast<float>(hourlyGraphMax);
   display.setFont(&FONT_8pt8b);
 
   float yPxPerUnit =
       (yPos1 - yPos0) / static_cast<float>(tempBoundMax - tempBoundMin);
-  std::vector<int> x_t(HOURLY_GRAPH_MAX);
-  std::vector<int> y_t(HOURLY_GRAPH_MAX);
+  std::vector<int> x_t(hourlyGraphMax);
+  std::vector<int> y_t(hourlyGraphMax);
 
-  for (int i = 0; i < HOURLY_GRAPH_MAX; ++i) {
+  for (int i = 0; i < hourlyGraphMax; ++i) {
     y_t[i] = kelvin_to_plot_y(hourly[i].temp, tempBoundMin, yPxPerUnit, yPos1);
     x_t[i] = static_cast<int>(
         std::round(xPos0 + (i * xInterval) + (0.5 * xInterval)));
   }
 
-  for (int i = 0; i < HOURLY_GRAPH_MAX; ++i) {
+  for (int i = 0; i < hourlyGraphMax; ++i) {
     int xTick = static_cast<int>(xPos0 + (i * xInterval));
 
     if (i > 0) {
@@ -883,18 +967,18 @@ void drawOutlookGraph(const owm_hourly_t *hourly, const owm_daily_t *daily,
 
     // Only draw precipitation bars if there's precipitation to show
     if (precipBoundMax > 0 && precipVal > 0) {
-      for (int y = y1_p - 1; y > y0_p; y -= 2) {
-        for (int x = x0_p + (x0_p % 2); x < x1_p; x += 2) {
-          display.drawPixel(x, y, GxEPD_BLACK);
-        }
+      // every other pixel of every other row, up from the row above the axis
+      uint8_t dither[8];
+      for (int row = 0; row < 8; ++row) {
+        dither[row] = ((y1_p - 1 - row) & 1) ? 0x00 : 0xAA;
       }
+      fillPatternRect(x0_p, y0_p + 1, x1_p - x0_p, y1_p - 1 - y0_p, dither,
+                      GxEPD_BLACK);
     }
 
     if ((i % hourInterval) == 0) {
-      display.drawLine(xTick + MARGIN_X, yPos1 + 1 + MARGIN_Y, xTick + MARGIN_X,
-                       yPos1 + 4 + MARGIN_Y, GxEPD_BLACK);
-      display.drawLine(xTick + 1 + MARGIN_X, yPos1 + 1 + MARGIN_Y,
-                       xTick + 1 + MARGIN_X, yPos1 + 4 + MARGIN_Y, GxEPD_BLACK);
+      fillPatternRect(xTick + MARGIN_X, yPos1 + 1 + MARGIN_Y, 2, 4,
+                      solidPattern, GxEPD_BLACK);
       char timeBuffer[12] = {};
       time_t ts = hourly[i].dt;
       tm *ti = localtime(&ts);
@@ -970,6 +1054,126 @@ void drawStatusBar(const String &statusStr, const String &refreshTimeStr,
   return;
 }
 
+// =============================================================================
+// RENDER CHANGE DETECTION
+// FNV-1a hashes of what the weather display draws, quantized to the precision
+// it is drawn at, so a wake can tell whether the panel needs refreshing.
+// =============================================================================
+static void hashBytes(uint32_t &h, const void *data, size_t size) {
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < size; ++i) {
+    h = (h ^ p[i]) * 16777619UL;
+  }
+}
+
+static void hashInt(uint32_t &h, int32_t v) { hashBytes(h, &v, sizeof(v)); }
+
+static void hashPtr(uint32_t &h, const void *p) { hashBytes(h, &p, sizeof(p)); }
+
+static void hashStr(uint32_t &h, const char *s) {
+  hashBytes(h, s, strlen(s) + 1);
+}
+
+/* Hashes a value after rounding it to a multiple of quantum. */
+static void hashFloat(uint32_t &h, float v, float quantum) {
+  hashInt(h, std::isnan(v) ? INT32_MIN
+                           : static_cast<int32_t>(std::round(v / quantum)));
+}
+
+/* Hashes a temperature in the display unit. */
+static void hashTemp(uint32_t &h, float kelvin, float quantum) {
+#ifdef UNITS_TEMP_KELVIN
+  hashFloat(h, kelvin, quantum);
+#endif
+#ifdef UNITS_TEMP_CELSIUS
+  hashFloat(h, kelvin_to_celsius(kelvin), quantum);
+#endif
+#ifdef UNITS_TEMP_FAHRENHEIT
+  hashFloat(h, kelvin_to_fahrenheit(kelvin), quantum);
+#endif
+}
+
+/* Returns a hash of everything drawn outside the status bar. Values are
+ * quantized to what is drawn, e.g. whole degrees for the current temperature
+ * and tenths of a degree (about one pixel) for the outlook graph.
+ */
+uint32_t getWeatherContentHash(const owm_resp_onecall_t &onecall, int aqi,
+                               float inTemp, float inHumidity,
+                               const String &city, const String &date,
+                               const tm &timeInfo) {
+  uint32_t h = 2166136261UL;
+  const owm_current_t &current = onecall.current;
+
+  // current conditions
+  hashPtr(h, getCurrentConditionsBitmap196(current, onecall.daily[0]));
+  hashTemp(h, current.temp, 1.f);
+  hashTemp(h, current.feels_like, 1.f);
+  hashInt(h, static_cast<int32_t>(current.sunrise / 60));
+  hashInt(h, static_cast<int32_t>(current.sunset / 60));
+  hashFloat(h, current.wind_speed, 0.1f);
+  hashPtr(h, getWindBitmap24(current.wind_deg));
+  hashFloat(h, current.uvi, 1.f);
+  hashInt(h, aqi);
+  hashFloat(h, inTemp, 0.1f);
+  hashFloat(h, inHumidity, 1.f);
+  hashInt(h, current.humidity);
+  hashInt(h, current.pressure);
+  hashFloat(h, current.visibility, 100.f);
+
+  // outlook graph
+  for (int i = 0; i < std::min(HOURLY_GRAPH_MAX, OWM_NUM_HOURLY); ++i) {
+    const owm_hourly_t &hourly = onecall.hourly[i];
+    hashInt(h, static_cast<int32_t>(hourly.dt / 3600));
+    hashTemp(h, hourly.temp, 0.1f);
+#ifdef UNITS_HOURLY_PRECIP_POP
+    hashFloat(h, hourly.pop, 0.01f);
+#else
+    hashFloat(h, hourly.rain_1h + hourly.snow_1h, 0.01f);
+#endif
+#if DISPLAY_HOURLY_ICONS
+    hashPtr(h, getHourlyForecastBitmap32(hourly, onecall.daily[0]));
+#endif
+  }
+
+  // forecast
+  hashInt(h, timeInfo.tm_wday);
+  for (int i = 0; i < OWM_NUM_DAILY; ++i) {
+    const owm_daily_t &daily = onecall.daily[i];
+    hashPtr(h, getDailyForecastBitmap64(daily));
+    hashTemp(h, daily.temp.max, 1.f);
+    hashTemp(h, daily.temp.min, 1.f);
+    hashFloat(h, daily.rain + daily.snow, 0.1f);
+  }
+
+  // location, date and alerts
+  hashStr(h, city.c_str());
+  hashStr(h, date.c_str());
+#if DISPLAY_ALERTS
+  hashInt(h, onecall.alerts.count);
+  for (int i = 0; i < onecall.alerts.count; ++i) {
+    hashStr(h, onecall.alerts.alert[i].event);
+    hashStr(h, onecall.alerts.alert[i].tags);
+  }
+#endif
+  return h;
+}
+
+/* Returns a hash of the status bar without the refresh time. The battery level
+ * is hashed in 5% steps so ADC noise alone does not count as a change.
+ */
+uint32_t getStatusBarHash(const String &statusStr, int rssi,
+                          uint32_t batVoltage) {
+  uint32_t h = 2166136261UL;
+  hashStr(h, statusStr.c_str());
+  hashPtr(h, getWiFiBitmap16(rssi));
+  hashPtr(h, getWiFidesc(rssi));
+#if BATTERY_MONITORING
+  hashInt(h, calcBatPercent(batVoltage, MIN_BATTERY_VOLTAGE,
+                            MAX_BATTERY_VOLTAGE) / 5);
+#endif
+  return h;
+}
+
 /* Draw error screen */
 void drawError(const uint8_t *bitmap_196x196, const String &errMsgLn1,
                const String &errMsgLn2) {
@@ -0,0 +1,163 @@
+/* Deadline-aware request retries for TRMNL OG Weather Station
+ * See request_scheduler.h.
+ */
+
+#include <Arduino.h>
+#include <esp_system.h>
+#include "config.h"
+#include "request_scheduler.h"
+
+static unsigned long wakeStart;
+
+/* Starts the wake budget, call once at the start of the wake.
+ */
+void beginWakeBudget(unsigned long startMs)
+{
+  wakeStart = startMs;
+} // end beginWakeBudget
+
+/* Returns the millis() by which all requests of this wake must have ended.
+ */
+unsigned long getRequestDeadline()
+{
+  return wakeStart + WAKE_BUDGET - WAKE_RENDER_RESERVE;
+} // end getRequestDeadline
+
+/* Returns the ms left until the request deadline, 0 once it has passed.
+ */
+unsigned long getRequestTimeLeft()
+{
+  long left = static_cast<long>(getRequestDeadline() - millis());
+  return left > 0 ? left : 0;
+} // end getRequestTimeLeft
+
+void beginRequest(request_schedule_t &req, const char *name,
+                  uint8_t maxAttempts, unsigned maxTimeout)
+{
+  req = {};
+  req.name = name;
+  req.deadline = getRequestDeadline();
+  req.nextAt = millis();
+  req.maxTimeout = maxTimeout;
+  req.maxAttempts = maxAttempts;
+  req.outcome = REQUEST_PENDING;
+} // end beginRequest
+
+/* Returns the delay before retry number attempt (1 = first retry):
+ * REQUEST_BACKOFF_BASE doubled per retry, capped at REQUEST_BACKOFF_MAX, and
+ * scaled by a random factor between 0.5 and 1.5 so requests that failed
+ * together don't retry together.
+ */
+unsigned long getBackoffDelay(uint8_t attempt, uint32_t random)
+{
+  unsigned long delayMs = REQUEST_BACKOFF_BASE;
+  for (uint8_t i = 1; i < attempt && delayMs < REQUEST_BACKOFF_MAX; ++i)
+  {
+    delayMs *= 2;
+  }
+  if (delayMs > REQUEST_BACKOFF_MAX)
+  {
+    delayMs = REQUEST_BACKOFF_MAX;
+  }
+  return delayMs / 2 + random % (delayMs + 1);
+} // end getBackoffDelay
+
+/* Returns the connect/read timeout for an attempt starting at now: the time
+ * left until the deadline, at most maxTimeout. 0 if that is less than
+ * REQUEST_MIN_TIMEOUT.
+ */
+unsigned getAttemptTimeout(const request_schedule_t &req, unsigned long now)
+{
+  long left = static_cast<long>(req.deadline - now);
+  if (left < REQUEST_MIN_TIMEOUT)
+  {
+    return 0;
+  }
+  return static_cast<unsigned long>(left) < req.maxTimeout
+         ? static_cast<unsigned>(left) : req.maxTimeout;
+} // end getAttemptTimeout
+
+/* Returns the outcome a final status leads to, REQUEST_PENDING if the request
+ * may be retried.
+ */
+request_outcome_t classifyStatus(int status)
+{
+  if (status == 200)
+  {
+    return REQUEST_OK;
+  }
+  if (status <= -512)
+  {
+    return REQUEST_NO_WIFI; // see getOWMonecall()
+  }
+  // Other client errors (bad API key, unknown location, ...) won't go away
+  if (status >= 400 && status < 500 && status != 408 && status != 429)
+  {
+    return REQUEST_REJECTED;
+  }
+  // connection errors, parse errors (-256 - code), 408, 429, 5xx
+  return REQUEST_PENDING;
+} // end classifyStatus
+
+/* Waits until the next attempt is due.
+ *
+ * Returns its connect/read timeout in ms, or 0 if no further attempt should
+ * be made; req.outcome then says why.
+ */
+unsigned nextAttempt(request_schedule_t &req)
+{
+  if (req.outcome == REQUEST_PENDING && req.attempts >= req.maxAttempts)
+  {
+    req.outcome = REQUEST_OUT_OF_ATTEMPTS;
+  }
+  unsigned timeout = 0;
+  if (req.outcome == REQUEST_PENDING)
+  {
+    timeout = getAttemptTimeout(req, req.nextAt);
+    if (timeout == 0)
+    {
+      req.outcome = REQUEST_OUT_OF_TIME;
+    }
+  }
+  if (req.outcome != REQUEST_PENDING)
+  {
+    if (req.outcome != REQUEST_OK)
+    {
+      Serial.printf("%s gave up: %s after %u attempt(s), last status %d\n",
+                    req.name, getRequestOutcomeName(req.outcome),
+                    req.attempts, req.status);
+    }
+    return 0;
+  }
+
+  long wait = static_cast<long>(req.nextAt - millis());
+  if (wait > 0)
+  {
+    delay(wait);
+  }
+  ++req.attempts;
+  return timeout;
+} // end nextAttempt
+
+/* Records the result of an attempt and schedules the next one.
+ */
+void endAttempt(request_schedule_t &req, int status)
+{
+  req.status = status;
+  req.outcome = classifyStatus(status);
+  req.nextAt = millis() + getBackoffDelay(req.attempts, esp_random());
+} // end endAttempt
+
+const char *getRequestOutcomeName(request_outcome_t outcome)
+{
+  switch (outcome)
+  {
+    case REQUEST_PENDING:         return "pending";
+    case REQUEST_OK:              return "ok";
+    case REQUEST_REJECTED:        return "rejected";
+    case REQUEST_NO_WIFI:         return "no wifi";
+    case REQUEST_OUT_OF_ATTEMPTS: return "out of attempts";
+    case REQUEST_OUT_OF_TIME:     return "out of time";
+  }
+  return "";
+} // end getRequestOutcomeName
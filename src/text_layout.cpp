@@ -0,0 +1,193 @@
+/* Text measurement for TRMNL OG Weather Station
+ * See text_layout.h.
+ */
+
+#include "text_layout.h"
+#include "renderer.h"
+
+/* The font and text settings are protected in Adafruit_GFX; a derived class
+ * can name them to get pointers to the members.
+ */
+class GfxTextState : public Adafruit_GFX
+{
+public:
+  static const GFXfont *font(const Adafruit_GFX &gfx)
+  {
+    return gfx.*(&GfxTextState::gfxFont);
+  }
+  // Settings the glyph table walk below doesn't handle
+  static bool plain(const Adafruit_GFX &gfx)
+  {
+    return !(gfx.*(&GfxTextState::wrap))
+        && gfx.*(&GfxTextState::textsize_x) == 1
+        && gfx.*(&GfxTextState::textsize_y) == 1;
+  }
+  static void addChar(Adafruit_GFX &gfx, char c, int16_t *x, int16_t *y,
+                      int16_t *minx, int16_t *miny, int16_t *maxx,
+                      int16_t *maxy)
+  {
+    (gfx.*(&GfxTextState::charBounds))(c, x, y, minx, miny, maxx, maxy);
+  }
+};
+
+/* Same walk as Adafruit_GFX::charBounds() without wrapping or text size.
+ */
+static text_bounds_t measureGlyphs(const GFXfont *font, const char *s)
+{
+  int16_t x = 0, y = 0;
+  int16_t minx = 0x7FFF, miny = 0x7FFF, maxx = -1, maxy = -1;
+  uint8_t first = pgm_read_byte(&font->first);
+  uint8_t last = pgm_read_byte(&font->last);
+  uint8_t yAdvance = pgm_read_byte(&font->yAdvance);
+  const GFXglyph *glyphs = font->glyph;
+  for (uint8_t c; (c = *s) != '\0'; ++s)
+  {
+    if (c == '\n')
+    {
+      x = 0;
+      y += yAdvance;
+      continue;
+    }
+    if (c < first || c > last)
+    {
+      continue;
+    }
+    const GFXglyph &g = glyphs[c - first];
+    int16_t x1 = x + g.xOffset;
+    int16_t y1 = y + g.yOffset;
+    int16_t x2 = x1 + g.width - 1;
+    int16_t y2 = y1 + g.height - 1;
+    if (x1 < minx) minx = x1;
+    if (y1 < miny) miny = y1;
+    if (x2 > maxx) maxx = x2;
+    if (y2 > maxy) maxy = y2;
+    x += g.xAdvance;
+  }
+
+  text_bounds_t b = {0, 0, 0, 0};
+  if (maxx >= minx)
+  {
+    b.x1 = minx;
+    b.w = maxx - minx + 1;
+  }
+  if (maxy >= miny)
+  {
+    b.y1 = miny;
+    b.h = maxy - miny + 1;
+  }
+  return b;
+} // end measureGlyphs
+
+text_bounds_t measureText(const String &text)
+{
+  const GFXfont *font = GfxTextState::font(display);
+  if (font == nullptr || !GfxTextState::plain(display))
+  {
+    text_bounds_t b;
+    display.getTextBounds(text, 0, 0, &b.x1, &b.y1, &b.w, &b.h);
+    return b;
+  }
+  return measureGlyphs(font, text.c_str());
+} // end measureText
+
+/* Running bounds of the text measured so far, as in getTextBounds().
+ */
+typedef struct text_pen
+{
+  int16_t x, y;
+  int16_t minx, miny, maxx, maxy;
+
+  void add(char c)
+  {
+    GfxTextState::addChar(display, c, &x, &y, &minx, &miny, &maxx, &maxy);
+  }
+  uint16_t width() const
+  {
+    return maxx >= minx ? maxx - minx + 1 : 0;
+  }
+} text_pen_t;
+
+text_line_t breakTextLine(const char *text, uint16_t max_width, bool lastLine)
+{
+  text_pen_t pen = {0, 0, 0x7FFF, 0x7FFF, -1, -1};
+  text_line_t fit = {0, 0, 0, false};   // last break that fits
+  text_line_t first = {0, 0, 0, false}; // first break
+  bool haveFit = false;
+  bool haveFirst = false;
+  // Width only grows along the text, so no break past the first character
+  // that overflows can fit.
+  bool fits = true;
+  uint16_t i = 0;
+  for (; text[i] != '\0'; ++i)
+  {
+    char c = text[i];
+    if (c == ' ')
+    {
+      text_line_t line = {i, static_cast<uint16_t>(i + 1), pen.width(), false};
+      if (!haveFirst)
+      {
+        first = line;
+        haveFirst = true;
+      }
+      if (fits && lastLine)
+      {
+        text_pen_t dots = pen;
+        dots.add('.');
+        dots.add('.');
+        dots.add('.');
+        if (dots.width() <= max_width)
+        {
+          line.w = dots.width();
+          line.ellipsis = true;
+          fit = line;
+          haveFit = true;
+        }
+      }
+      else if (fits)
+      {
+        fit = line;
+        haveFit = true;
+      }
+    }
+
+    uint16_t before = pen.width();
+    pen.add(c);
+    fits = fits && pen.width() <= max_width;
+
+    if (c == '-' && !lastLine)
+    {
+      if (!haveFirst)
+      {
+        // a line that doesn't fit anyway loses its hyphen
+        first = {i, static_cast<uint16_t>(i + 1), before, false};
+        haveFirst = true;
+      }
+      if (fits)
+      {
+        fit = {static_cast<uint16_t>(i + 1), static_cast<uint16_t>(i + 1),
+               pen.width(), false};
+        haveFit = true;
+      }
+    }
+    if (!fits && haveFirst)
+    {
+      break;
+    }
+  }
+
+  if (fits)
+  {
+    text_line_t all = {i, i, pen.width(), false};
+    return all;
+  }
+  if (haveFit)
+  {
+    return fit;
+  }
+  if (haveFirst)
+  {
+    return first;
+  }
+  text_line_t all = {i, i, pen.width(), false};
+  return all;
+} // end breakTextLine
@@ -0,0 +1,252 @@
+/* Clock maintenance for TRMNL OG Weather Station
+ * See time_keeper.h.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <sys/time.h>
+#include <Arduino.h>
+#include <esp_attr.h>
+#include <esp_sntp.h>
+#include <esp_timer.h>
+#include "config.h"
+#include "time_keeper.h"
+
+typedef struct time_keeper_state
+{
+  time_reference_t reference;
+  int64_t  referenceAt;     // us, clock time of the last reference
+  uint32_t referenceErrorMs;
+  int64_t  syncAt;          // us, clock time of the last SNTP sync
+  int64_t  adjustedAt;      // us, clock time drift was last corrected at
+  int64_t  dateSteps;       // us the clock was stepped by since syncAt
+  int32_t  driftPpm;
+  int32_t  uncertaintyPpm;  // How far off the previous drift estimate was
+  uint16_t driftSamples;    // SNTP syncs the drift was learned from
+} time_keeper_state_t;
+
+static RTC_DATA_ATTR time_keeper_state_t tk;
+static bool synced;
+// Local clock and esp_timer when the SNTP sync started
+static int64_t syncStartClock;
+static int64_t syncStartTimer;
+static volatile bool sntpNotified;
+// The Date header is read by a fetch task
+static std::mutex tkMutex;
+
+static int64_t getClock()
+{
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return static_cast<int64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+} // end getClock
+
+static void setClock(int64_t us)
+{
+  struct timeval tv;
+  tv.tv_sec = us / 1000000;
+  tv.tv_usec = us % 1000000;
+  settimeofday(&tv, nullptr);
+} // end setClock
+
+static uint32_t getErrorMs(int64_t now)
+{
+  if (tk.reference == TIME_REF_NONE)
+  {
+    return UINT32_MAX;
+  }
+  int64_t age = llabs(now - tk.referenceAt);
+  int32_t ppm = tk.driftSamples ? tk.uncertaintyPpm : TIME_DRIFT_UNKNOWN_PPM;
+  int64_t errorMs = tk.referenceErrorMs + age / 1000 * ppm / 1000000;
+  return errorMs < UINT32_MAX ? errorMs : UINT32_MAX;
+} // end getErrorMs
+
+/* Corrects the clock for the drift of the RTC since the last correction,
+ * call once at the start of each wake.
+ */
+void beginTimeKeeping()
+{
+  synced = false;
+  if (tk.reference == TIME_REF_NONE)
+  {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(tkMutex);
+  int64_t now = getClock();
+  int64_t correction = -(now - tk.adjustedAt) / 1000 * tk.driftPpm / 1000;
+  setClock(now + correction);
+  tk.adjustedAt = now + correction;
+#if DEBUG_LEVEL >= 1
+  Serial.printf("[debug] Clock drift   : %ldppm, corrected by %lldms\n",
+                static_cast<long>(tk.driftPpm), correction / 1000);
+#endif
+} // end beginTimeKeeping
+
+/* Returns true if the clock should be synced with SNTP during this wake.
+ */
+bool isTimeSyncDue()
+{
+  std::lock_guard<std::mutex> lock(tkMutex);
+  if (tk.reference == TIME_REF_NONE)
+  {
+    return true;
+  }
+  int64_t now = getClock();
+  // a clock before the last sync was set back
+  return now < tk.syncAt
+         || now - tk.syncAt >= TIME_SYNC_INTERVAL * 3600LL * 1000000
+         || getErrorMs(now) > TIME_MAX_ERROR;
+} // end isTimeSyncDue
+
+static void onSntpSync(struct timeval *)
+{
+  sntpNotified = true;
+} // end onSntpSync
+
+/* Call right before starting SNTP.
+ */
+void beginTimeSync()
+{
+  sntpNotified = false;
+  sntp_set_time_sync_notification_cb(onSntpSync);
+  syncStartClock = getClock();
+  syncStartTimer = esp_timer_get_time();
+} // end beginTimeSync
+
+/* Call after waiting for SNTP. Learns the drift from the clock error SNTP
+ * corrected.
+ *
+ * Returns true if SNTP set the clock.
+ */
+bool endTimeSync()
+{
+  if (!sntpNotified)
+  {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(tkMutex);
+  int64_t now = getClock();
+  // true time when the sync started, esp_timer does not drift noticeably
+  int64_t syncStart = now - (esp_timer_get_time() - syncStartTimer);
+  // error left after the drift corrections, without the Date header steps
+  int64_t error = syncStartClock - syncStart - tk.dateSteps;
+  int64_t interval = syncStart - tk.syncAt;
+  if (tk.reference != TIME_REF_NONE
+      && interval >= TIME_DRIFT_MIN_INTERVAL * 1000000LL)
+  {
+    int64_t errorPpm = error * 1000000 / interval;
+    // later samples are averaged with the estimate they correct
+    int64_t driftPpm = tk.driftPpm
+                       + (tk.driftSamples ? errorPpm / 2 : errorPpm);
+    if (llabs(driftPpm) <= TIME_DRIFT_MAX_PPM)
+    {
+      tk.driftPpm = driftPpm;
+      tk.uncertaintyPpm = llabs(errorPpm) > TIME_DRIFT_MIN_PPM
+                          ? llabs(errorPpm) : TIME_DRIFT_MIN_PPM;
+      if (tk.driftSamples < UINT16_MAX)
+      {
+        ++tk.driftSamples;
+      }
+    }
+  }
+#if DEBUG_LEVEL >= 1
+  Serial.printf("[debug] SNTP sync     : clock was %lldms off, drift %ldppm "
+                "from %u syncs\n", (syncStartClock - syncStart) / 1000,
+                static_cast<long>(tk.driftPpm), tk.driftSamples);
+#endif
+  tk.reference = TIME_REF_SNTP;
+  tk.referenceAt = now;
+  tk.referenceErrorMs = TIME_SNTP_ERROR_MS;
+  tk.syncAt = now;
+  tk.adjustedAt = now;
+  tk.dateSteps = 0;
+  synced = true;
+  return true;
+} // end endTimeSync
+
+/* Returns the Unix time of an HTTP date ("Sun, 06 Nov 1994 08:49:37 GMT"), or
+ * -1 if it can't be parsed.
+ */
+static int64_t parseHttpDate(const char *s)
+{
+  static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+  char mon[4] = {};
+  int d, y, hh, mm, ss;
+  if (sscanf(s, "%*3s, %d %3s %d %d:%d:%d", &d, mon, &y, &hh, &mm, &ss) != 6)
+  {
+    return -1;
+  }
+  const char *m = strstr(months, mon);
+  if (strlen(mon) != 3 || m == nullptr || (m - months) % 3 != 0)
+  {
+    return -1;
+  }
+  int month = (m - months) / 3 + 1;
+  // days since 1970-01-01 of the proleptic Gregorian calendar
+  y -= month <= 2;
+  int64_t era = (y >= 0 ? y : y - 399) / 400;
+  int64_t yoe = y - era * 400;
+  int64_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  int64_t days = era * 146097 + doe - 719468;
+  return days * 86400 + hh * 3600 + mm * 60 + ss;
+} // end parseHttpDate
+
+/* Sets the clock from an HTTP Date header if it is off by more than the
+ * header's precision allows for. Does nothing if SNTP synced during this wake
+ * or the clock was never set.
+ */
+void disciplineClock(const String &httpDate)
+{
+  int64_t date = parseHttpDate(httpDate.c_str());
+  std::lock_guard<std::mutex> lock(tkMutex);
+  if (date < 0 || synced || tk.reference == TIME_REF_NONE)
+  {
+    return;
+  }
+  int64_t now = getClock();
+  // the header has whole seconds and was sent a little earlier
+  int64_t offset = date * 1000000 + 500000 - now;
+  if (llabs(offset) >= TIME_DATE_STEP_MIN_MS * 1000LL)
+  {
+    setClock(now + offset);
+    now += offset;
+    tk.dateSteps += offset;
+    tk.adjustedAt += offset;
+    Serial.printf("Clock set from HTTP Date, was %lldms off\n", -offset / 1000);
+  }
+  else if (getErrorMs(now) <= TIME_DATE_ERROR_MS)
+  {
+    return; // already more precise than the header
+  }
+  tk.reference = TIME_REF_HTTP_DATE;
+  tk.referenceAt = now;
+  tk.referenceErrorMs = TIME_DATE_ERROR_MS;
+} // end disciplineClock
+
+time_confidence_t getTimeConfidence()
+{
+  std::lock_guard<std::mutex> lock(tkMutex);
+  int64_t now = getClock();
+  time_confidence_t c = {};
+  c.reference = tk.reference;
+  c.synced = synced;
+  c.errorMs = getErrorMs(now);
+  c.driftPpm = tk.driftPpm;
+  c.syncAgeS = tk.reference != TIME_REF_NONE && now > tk.syncAt
+               ? (now - tk.syncAt) / 1000000 : 0;
+  return c;
+} // end getTimeConfidence
+
+const char *getTimeReferenceName(time_reference_t reference)
+{
+  switch (reference)
+  {
+    case TIME_REF_NONE:      return "none";
+    case TIME_REF_SNTP:      return "sntp";
+    case TIME_REF_HTTP_DATE: return "http_date";
+  }
+  return "";
+} // end getTimeReferenceName
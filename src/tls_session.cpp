@@ -0,0 +1,341 @@
+/* TLS session resumption for TRMNL OG Weather Station
+ * See tls_session.h.
+ *
+ * TlsSessionClient::startTls() follows start_ssl_client() of the ESP32
+ * Arduino core, with the stored session offered before the handshake and
+ * saved after it. The connection it sets up is then used and closed by
+ * WiFiClientSecure as usual.
+ */
+
+#include <cstring>
+#include <mutex>
+#include <Arduino.h>
+#include <esp_attr.h>
+#include <lwip/sockets.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/platform.h>
+#include <mbedtls/ssl.h>
+#include "config.h"
+#include "dns_cache.h"
+#include "tls_session.h"
+#include "wake_profile.h"
+
+typedef struct tls_session_slot
+{
+  uint32_t hostHash;        // FNV-1a of "host:port", 0 if unused
+  uint16_t length;          // Serialized session bytes
+  uint8_t  data[TLS_SESSION_MAX_SIZE];
+} tls_session_slot_t;
+
+static RTC_DATA_ATTR tls_session_slot_t sessionSlots[TLS_SESSION_SLOTS];
+static RTC_DATA_ATTR uint8_t nextSlot;
+static RTC_DATA_ATTR tls_handshake_stats_t tlsStats;
+static uint32_t tlsWakeMs;
+// Connections may be set up by several fetch tasks at once
+static std::mutex tlsMutex;
+
+static uint32_t getHostHash(const char *host, uint16_t port)
+{
+  uint32_t h = 2166136261u;
+  for (const char *c = host; *c; ++c)
+  {
+    h = (h ^ static_cast<uint8_t>(*c)) * 16777619u;
+  }
+  h = (h ^ (port & 0xFF)) * 16777619u;
+  h = (h ^ (port >> 8)) * 16777619u;
+  return h ? h : 1;
+} // end getHostHash
+
+/* Returns the slot holding the session for hostHash, or nullptr.
+ */
+static tls_session_slot_t *findSessionSlot(uint32_t hostHash)
+{
+  for (tls_session_slot_t &slot : sessionSlots)
+  {
+    if (slot.hostHash == hostHash)
+    {
+      return &slot;
+    }
+  }
+  return nullptr;
+} // end findSessionSlot
+
+/* Offers the stored session for hostHash, if any, on the next handshake.
+ *
+ * Returns true if a session was offered.
+ */
+static bool offerSession(mbedtls_ssl_context &ssl, uint32_t hostHash)
+{
+  std::lock_guard<std::mutex> lock(tlsMutex);
+  tls_session_slot_t *slot = findSessionSlot(hostHash);
+  if (slot == nullptr)
+  {
+    return false;
+  }
+  mbedtls_ssl_session session;
+  mbedtls_ssl_session_init(&session);
+  bool offered = mbedtls_ssl_session_load(&session, slot->data,
+                                          slot->length) == 0
+                 && mbedtls_ssl_set_session(&ssl, &session) == 0;
+  mbedtls_ssl_session_free(&session);
+  if (!offered)
+  {
+    // written by a firmware with a different mbedTLS configuration
+    slot->hostHash = 0;
+  }
+  return offered;
+} // end offerSession
+
+/* Stores the session of the completed handshake for hostHash.
+ */
+static void saveSession(mbedtls_ssl_context &ssl, uint32_t hostHash)
+{
+  std::lock_guard<std::mutex> lock(tlsMutex);
+  tls_session_slot_t *slot = findSessionSlot(hostHash);
+  if (slot == nullptr)
+  {
+    slot = &sessionSlots[nextSlot];
+    nextSlot = (nextSlot + 1) % TLS_SESSION_SLOTS;
+  }
+  slot->hostHash = 0;
+
+  mbedtls_ssl_session session;
+  mbedtls_ssl_session_init(&session);
+  if (mbedtls_ssl_get_session(&ssl, &session) == 0)
+  {
+#if defined(MBEDTLS_X509_CRT_PARSE_C) && defined(MBEDTLS_SSL_KEEP_PEER_CERTIFICATE)
+    // The certificate is not needed to resume, the verify result is kept.
+    if (session.peer_cert != nullptr)
+    {
+      mbedtls_x509_crt_free(session.peer_cert);
+      mbedtls_free(session.peer_cert);
+      session.peer_cert = nullptr;
+    }
+#endif
+    size_t length = 0;
+    if (mbedtls_ssl_session_save(&session, slot->data, sizeof(slot->data),
+                                 &length) == 0)
+    {
+      slot->length = length;
+      slot->hostHash = hostHash;
+    }
+  }
+  mbedtls_ssl_session_free(&session);
+} // end saveSession
+
+tls_handshake_stats_t getTlsHandshakeStats()
+{
+  std::lock_guard<std::mutex> lock(tlsMutex);
+  tls_handshake_stats_t stats = tlsStats;
+  stats.wakeMs = tlsWakeMs;
+  return stats;
+} // end getTlsHandshakeStats
+
+int TlsSessionClient::connect(const char *host, uint16_t port,
+                              int32_t timeout)
+{
+  _timeout = timeout;
+  return connect(host, port);
+}
+
+int TlsSessionClient::connect(const char *host, uint16_t port)
+{
+  bool supported = (_use_insecure || _CA_cert != nullptr)
+                   && !_use_ca_bundle && _cert == nullptr
+                   && _pskIdent == nullptr;
+  if (!supported)
+  {
+    return WiFiClientSecure::connect(host, port);
+  }
+
+  IPAddress ip;
+  if (!resolveHost(host, ip))
+  {
+    return 0;
+  }
+  unsigned long start = millis();
+  int ret = startTls(ip, port, host);
+  {
+    std::lock_guard<std::mutex> lock(tlsMutex);
+    tlsStats.lastMs = millis() - start;
+    tlsWakeMs += tlsStats.lastMs;
+    addWakePhase(WAKE_PHASE_TLS, tlsStats.lastMs);
+    if (ret < 0)
+    {
+      ++tlsStats.failed;
+    }
+  }
+  _lastError = ret;
+  if (ret < 0)
+  {
+    forgetHost(host);
+    stop();
+    return 0;
+  }
+  _connected = true;
+  return 1;
+}
+
+/* Connects the socket and performs the TLS handshake, offering the stored
+ * session for host.
+ *
+ * Returns the socket, or a negative error code. On error the caller must call
+ * stop() to release the connection.
+ */
+int TlsSessionClient::startTls(IPAddress ip, uint16_t port, const char *host)
+{
+  static const char *pers = "esp32-tls";
+  sslclient_context *ssl = sslclient;
+  int timeout = _timeout > 0 ? _timeout : 30000;
+
+  ssl->socket = lwip_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (ssl->socket < 0)
+  {
+    return ssl->socket;
+  }
+  fcntl(ssl->socket, F_SETFL, fcntl(ssl->socket, F_GETFL, 0) | O_NONBLOCK);
+
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = static_cast<uint32_t>(ip);
+  addr.sin_port = htons(port);
+  if (lwip_connect(ssl->socket, reinterpret_cast<struct sockaddr *>(&addr),
+                   sizeof(addr)) < 0
+      && errno != EINPROGRESS)
+  {
+    return -1;
+  }
+  fd_set fdset;
+  FD_ZERO(&fdset);
+  FD_SET(ssl->socket, &fdset);
+  struct timeval tv;
+  tv.tv_sec = timeout / 1000;
+  tv.tv_usec = (timeout % 1000) * 1000;
+  int sockErr = 0;
+  socklen_t len = sizeof(sockErr);
+  if (select(ssl->socket + 1, nullptr, &fdset, nullptr, &tv) <= 0
+      || getsockopt(ssl->socket, SOL_SOCKET, SO_ERROR, &sockErr, &len) < 0
+      || sockErr != 0)
+  {
+    return -1;
+  }
+  int enable = 1;
+  lwip_setsockopt(ssl->socket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  lwip_setsockopt(ssl->socket, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+  lwip_setsockopt(ssl->socket, IPPROTO_TCP, TCP_NODELAY, &enable,
+                  sizeof(enable));
+  lwip_setsockopt(ssl->socket, SOL_SOCKET, SO_KEEPALIVE, &enable,
+                  sizeof(enable));
+
+  mbedtls_entropy_init(&ssl->entropy_ctx);
+  int ret = mbedtls_ctr_drbg_seed(&ssl->drbg_ctx, mbedtls_entropy_func,
+                                  &ssl->entropy_ctx,
+                                  reinterpret_cast<const unsigned char *>(pers),
+                                  strlen(pers));
+  if (ret != 0)
+  {
+    return ret;
+  }
+  ret = mbedtls_ssl_config_defaults(&ssl->ssl_conf, MBEDTLS_SSL_IS_CLIENT,
+                                    MBEDTLS_SSL_TRANSPORT_STREAM,
+                                    MBEDTLS_SSL_PRESET_DEFAULT);
+  if (ret != 0)
+  {
+    return ret;
+  }
+  if (_use_insecure)
+  {
+    mbedtls_ssl_conf_authmode(&ssl->ssl_conf, MBEDTLS_SSL_VERIFY_NONE);
+  }
+  else
+  {
+    mbedtls_ssl_conf_authmode(&ssl->ssl_conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_x509_crt_init(&ssl->ca_cert);
+    ret = mbedtls_x509_crt_parse(&ssl->ca_cert,
+                                 reinterpret_cast<const unsigned char *>(_CA_cert),
+                                 strlen(_CA_cert) + 1);
+    mbedtls_ssl_conf_ca_chain(&ssl->ssl_conf, &ssl->ca_cert, nullptr);
+    if (ret < 0)
+    {
+      return ret;
+    }
+  }
+  if (_alpn_protos != nullptr)
+  {
+    mbedtls_ssl_conf_alpn_protocols(&ssl->ssl_conf, _alpn_protos);
+  }
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+  mbedtls_ssl_conf_session_tickets(&ssl->ssl_conf,
+                                   MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+  mbedtls_ssl_conf_rng(&ssl->ssl_conf, mbedtls_ctr_drbg_random,
+                       &ssl->drbg_ctx);
+  if ((ret = mbedtls_ssl_setup(&ssl->ssl_ctx, &ssl->ssl_conf)) != 0
+   || (ret = mbedtls_ssl_set_hostname(&ssl->ssl_ctx, host)) != 0)
+  {
+    return ret;
+  }
+  mbedtls_ssl_set_bio(&ssl->ssl_ctx, &ssl->socket, mbedtls_net_send,
+                      mbedtls_net_recv, nullptr);
+
+  uint32_t hostHash = getHostHash(host, port);
+  bool offered = offerSession(ssl->ssl_ctx, hostHash);
+
+  // Stepped rather than run by mbedtls_ssl_handshake() to see which way it
+  // went: a resumed handshake goes from ServerHello straight to
+  // ChangeCipherSpec, a full one continues with the server's Certificate.
+  bool full = false;
+  unsigned long start = millis();
+  while (ssl->ssl_ctx.state != MBEDTLS_SSL_HANDSHAKE_OVER)
+  {
+    ret = mbedtls_ssl_handshake_step(&ssl->ssl_ctx);
+    if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE)
+    {
+      if (millis() - start > ssl->handshake_timeout)
+      {
+        ret = -1;
+        break;
+      }
+      vTaskDelay(2);
+      continue;
+    }
+    if (ret != 0)
+    {
+      break;
+    }
+    full |= ssl->ssl_ctx.state == MBEDTLS_SSL_SERVER_CERTIFICATE;
+  }
+  if (ret != 0)
+  {
+    if (offered)
+    {
+      // don't offer it again in case it caused the failure
+      std::lock_guard<std::mutex> lock(tlsMutex);
+      tls_session_slot_t *slot = findSessionSlot(hostHash);
+      if (slot != nullptr)
+      {
+        slot->hostHash = 0;
+      }
+    }
+    return ret;
+  }
+  if (!_use_insecure && mbedtls_ssl_get_verify_result(&ssl->ssl_ctx) != 0)
+  {
+    Serial.println("TLS: certificate verification failed");
+    return -1;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(tlsMutex);
+    ++(full ? tlsStats.full : tlsStats.resumed);
+  }
+  saveSession(ssl->ssl_ctx, hostHash);
+#if DEBUG_LEVEL >= 1
+  Serial.printf("[debug] TLS handshake : %s %s, %lums\n", host,
+                full ? "full" : "resumed",
+                static_cast<unsigned long>(millis() - start));
+#endif
+  return ssl->socket;
+} // end startTls
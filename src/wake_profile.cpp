@@ -0,0 +1,120 @@
+/* Wake profiling for TRMNL OG Weather Station
+ * See wake_profile.h.
+ */
+
+#include <mutex>
+#include <Arduino.h>
+#include <esp_attr.h>
+#include "wake_profile.h"
+
+static wake_profile_t current;
+static RTC_DATA_ATTR wake_profile_t last;
+static RTC_DATA_ATTR bool lastValid;
+static RTC_DATA_ATTR uint32_t wakeNumber;
+// Phases are added by the fetch tasks too
+static std::mutex profileMutex;
+
+/* Starts the record of this wake, call at the start of setup().
+ */
+void beginWakeProfile()
+{
+  std::lock_guard<std::mutex> lock(profileMutex);
+  current = {};
+  current.wake = ++wakeNumber;
+  current.phaseMs[WAKE_PHASE_BOOT] = millis();
+  current.minMaxAlloc = UINT32_MAX;
+} // end beginWakeProfile
+
+/* Number of this wake, 1 for the first after power on.
+ */
+uint32_t getWakeNumber()
+{
+  return wakeNumber;
+} // end getWakeNumber
+
+void addWakePhase(wake_phase_t phase, uint32_t ms)
+{
+  std::lock_guard<std::mutex> lock(profileMutex);
+  current.phaseMs[phase] += ms;
+} // end addWakePhase
+
+/* Records the largest allocatable block if it is the smallest so far. The free
+ * heap low-water mark is tracked by the heap itself.
+ */
+void sampleWakeHeap()
+{
+  uint32_t maxAlloc = ESP.getMaxAllocHeap();
+  std::lock_guard<std::mutex> lock(profileMutex);
+  if (maxAlloc < current.minMaxAlloc)
+  {
+    current.minMaxAlloc = maxAlloc;
+  }
+} // end sampleWakeHeap
+
+/* Completes the record of this wake and keeps it for the next one, call right
+ * before deep sleep.
+ */
+void endWakeProfile()
+{
+  sampleWakeHeap();
+  std::lock_guard<std::mutex> lock(profileMutex);
+  current.awakeMs = millis();
+  current.minFreeHeap = ESP.getMinFreeHeap();
+  last = current;
+  lastValid = true;
+#if DEBUG_LEVEL >= 1
+  Serial.print("[debug] Wake profile  :");
+  for (int i = 0; i < WAKE_PHASE_COUNT; ++i)
+  {
+    if (current.phaseMs[i])
+    {
+      Serial.printf(" %s %lums", getWakePhaseName(static_cast<wake_phase_t>(i)),
+                    static_cast<unsigned long>(current.phaseMs[i]));
+    }
+  }
+  Serial.printf(", awake %lums, heap min %lu, max alloc min %lu\n",
+                static_cast<unsigned long>(current.awakeMs),
+                static_cast<unsigned long>(current.minFreeHeap),
+                static_cast<unsigned long>(current.minMaxAlloc));
+#endif
+} // end endWakeProfile
+
+/* Gets the record of the previous wake.
+ *
+ * Returns false if there is none that hasn't been published yet.
+ */
+bool getLastWakeProfile(wake_profile_t &profile)
+{
+  std::lock_guard<std::mutex> lock(profileMutex);
+  profile = last;
+  return lastValid;
+} // end getLastWakeProfile
+
+void markLastWakeProfilePublished()
+{
+  std::lock_guard<std::mutex> lock(profileMutex);
+  lastValid = false;
+} // end markLastWakeProfilePublished
+
+const char *getWakePhaseName(wake_phase_t phase)
+{
+  switch (phase)
+  {
+    case WAKE_PHASE_BOOT:         return "boot";
+    case WAKE_PHASE_WIFI_ASSOC:   return "wifi_assoc";
+    case WAKE_PHASE_DHCP:         return "dhcp";
+    case WAKE_PHASE_DNS:          return "dns";
+    case WAKE_PHASE_TLS:          return "tls";
+    case WAKE_PHASE_HTTP_ONECALL: return "http_onecall";
+    case WAKE_PHASE_HTTP_AIR:     return "http_air";
+    case WAKE_PHASE_HTTP_HA:      return "http_ha";
+    case WAKE_PHASE_HTTP_IMAGE:   return "http_image";
+    case WAKE_PHASE_PARSE:        return "parse";
+    case WAKE_PHASE_RENDER:       return "render";
+    case WAKE_PHASE_REFRESH:      return "refresh";
+    case WAKE_PHASE_MQTT:         return "mqtt";
+    case WAKE_PHASE_RADIO:        return "radio";
+    case WAKE_PHASE_COUNT:        break;
+  }
+  return "";
+} // end getWakePhaseName
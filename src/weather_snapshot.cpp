@@ -0,0 +1,186 @@
+/* Persisted weather snapshot for TRMNL OG Weather Station
+ * See weather_snapshot.h for the storage layout.
+ */
+
+#include <cstring>
+#include <Arduino.h>
+#include <esp_attr.h>
+#include <esp_rom_crc.h>
+#include <LittleFS.h>
+#include "config.h"
+#include "weather_snapshot.h"
+
+#define WEATHER_SNAPSHOT_MAGIC 0x50414E53 // "SNAP"
+
+typedef struct weather_snapshot_header
+{
+  uint32_t magic;           // WEATHER_SNAPSHOT_MAGIC once a snapshot is saved
+  uint16_t version;         // WEATHER_SNAPSHOT_VERSION
+  uint8_t  inFlash;         // Payload is in WEATHER_SNAPSHOT_FILE, not RTC
+  uint32_t length;          // Payload bytes
+  uint32_t crc;             // CRC-32 of the payload
+  int64_t  fetchedAt;       // Copy of meta.fetchedAt, checked before loading
+} weather_snapshot_header_t;
+
+static RTC_DATA_ATTR weather_snapshot_header_t rtcHeader;
+static RTC_DATA_ATTR uint8_t rtcPayload[WEATHER_SNAPSHOT_RTC_SIZE];
+
+/* Calls part(data, size) for each field of the payload in storage order and
+ * returns false as soon as part does. Only the stored alerts are included, so
+ * the payload is as small as the response allows.
+ *
+ * Instantiated with const arguments to save and non-const ones to load.
+ */
+template <typename OneCall, typename Meta, typename F>
+static bool visitPayload(OneCall &onecall, Meta &meta, F part)
+{
+  if (!part(&meta,                          sizeof(meta))
+   || !part(&onecall.current,               sizeof(onecall.current))
+   || !part(onecall.hourly,                 sizeof(onecall.hourly))
+   || !part(onecall.daily,                  sizeof(onecall.daily))
+   || !part(&onecall.alerts.count,          sizeof(onecall.alerts.count))
+   || !part(&onecall.alerts.dropped,        sizeof(onecall.alerts.dropped))
+   || !part(&onecall.alerts.truncatedEvents,
+            sizeof(onecall.alerts.truncatedEvents))
+   || !part(&onecall.alerts.truncatedTags,  sizeof(onecall.alerts.truncatedTags)))
+  {
+    return false;
+  }
+  if (onecall.alerts.count > OWM_NUM_ALERTS)
+  {
+    return false;
+  }
+  return part(onecall.alerts.alert,
+              onecall.alerts.count * sizeof(onecall.alerts.alert[0]));
+} // end visitPayload
+
+/* Saves the snapshot, replacing the previous one.
+ *
+ * Returns true if the snapshot was saved.
+ */
+bool saveWeatherSnapshot(const owm_resp_onecall_t &onecall,
+                         const weather_snapshot_meta_t &meta)
+{
+  // the previous snapshot is invalid until the new one is complete
+  rtcHeader = {};
+
+  size_t length = 0;
+  visitPayload(onecall, meta, [&](const void *, size_t size) {
+    length += size;
+    return true;
+  });
+
+  uint32_t crc = 0;
+  bool inFlash = length > sizeof(rtcPayload);
+  if (!inFlash)
+  {
+    size_t pos = 0;
+    visitPayload(onecall, meta, [&](const void *data, size_t size) {
+      memcpy(&rtcPayload[pos], data, size);
+      pos += size;
+      return true;
+    });
+    crc = esp_rom_crc32_le(0, rtcPayload, length);
+  }
+  else
+  {
+    if (!LittleFS.begin(true))
+    {
+      Serial.println("Snapshot: LittleFS mount failed");
+      return false;
+    }
+    File f = LittleFS.open(WEATHER_SNAPSHOT_FILE, FILE_WRITE);
+    bool ok = f && visitPayload(onecall, meta,
+                                [&](const void *data, size_t size) {
+      const uint8_t *bytes = static_cast<const uint8_t *>(data);
+      crc = esp_rom_crc32_le(crc, bytes, size);
+      return f.write(bytes, size) == size;
+    });
+    f.close();
+    LittleFS.end();
+    if (!ok)
+    {
+      Serial.println("Snapshot: write failed");
+      return false;
+    }
+  }
+
+  rtcHeader.version   = WEATHER_SNAPSHOT_VERSION;
+  rtcHeader.inFlash   = inFlash;
+  rtcHeader.length    = length;
+  rtcHeader.crc       = crc;
+  rtcHeader.fetchedAt = meta.fetchedAt;
+  rtcHeader.magic     = WEATHER_SNAPSHOT_MAGIC;
+#if DEBUG_LEVEL >= 1
+  Serial.println("[debug] Snapshot saved  : " + String(length) + " B in "
+                 + (inFlash ? "LittleFS" : "RTC memory"));
+#endif
+  return true;
+} // end saveWeatherSnapshot
+
+/* Loads the snapshot if one was saved by this firmware version no more than
+ * maxAgeMinutes ago. The system time must be valid, which it remains across
+ * deep sleep.
+ *
+ * Returns true if onecall and meta were loaded. On false their contents are
+ * unspecified.
+ */
+bool loadWeatherSnapshot(owm_resp_onecall_t &onecall,
+                         weather_snapshot_meta_t &meta, int maxAgeMinutes)
+{
+  if (rtcHeader.magic != WEATHER_SNAPSHOT_MAGIC
+   || rtcHeader.version != WEATHER_SNAPSHOT_VERSION)
+  {
+    return false;
+  }
+  int64_t age = static_cast<int64_t>(time(nullptr)) - rtcHeader.fetchedAt;
+  if (age < 0 || age > maxAgeMinutes * 60LL)
+  {
+    Serial.println("Snapshot: too old (" + String(age / 60) + "min)");
+    return false;
+  }
+
+  size_t pos = 0;
+  uint32_t crc = 0;
+  bool ok;
+  if (!rtcHeader.inFlash)
+  {
+    if (rtcHeader.length > sizeof(rtcPayload)
+     || esp_rom_crc32_le(0, rtcPayload, rtcHeader.length) != rtcHeader.crc)
+    {
+      return false;
+    }
+    crc = rtcHeader.crc;
+    ok = visitPayload(onecall, meta, [&](void *data, size_t size) {
+      if (pos + size > rtcHeader.length)
+      {
+        return false;
+      }
+      memcpy(data, &rtcPayload[pos], size);
+      pos += size;
+      return true;
+    });
+  }
+  else
+  {
+    if (!LittleFS.begin(false))
+    {
+      return false;
+    }
+    File f = LittleFS.open(WEATHER_SNAPSHOT_FILE, FILE_READ);
+    ok = f && visitPayload(onecall, meta, [&](void *data, size_t size) {
+      uint8_t *bytes = static_cast<uint8_t *>(data);
+      if (pos + size > rtcHeader.length || f.read(bytes, size) != size)
+      {
+        return false;
+      }
+      crc = esp_rom_crc32_le(crc, bytes, size);
+      pos += size;
+      return true;
+    });
+    f.close();
+    LittleFS.end();
+  }
+
+  return ok && pos == rtcHeader.length && crc == rtcHeader.crc;
+} // end loadWeatherSnapshot
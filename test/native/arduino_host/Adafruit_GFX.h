@@ -0,0 +1,162 @@
+/* Adafruit GFX stand-in for the native test environment
+ * The font types and the text measurement of Adafruit_GFX, with the members
+ * the sources reach through subclasses (gfxFont, wrap, textsize_x/y and
+ * charBounds()) declared as in the library. charBounds() and getTextBounds()
+ * follow Adafruit_GFX.cpp so host results match the device's.
+ */
+
+#ifndef __ADAFRUIT_GFX_H__
+#define __ADAFRUIT_GFX_H__
+
+#include <Arduino.h>
+
+typedef struct
+{
+  uint16_t bitmapOffset;
+  uint8_t  width;
+  uint8_t  height;
+  uint8_t  xAdvance;
+  int8_t   xOffset;
+  int8_t   yOffset;
+} GFXglyph;
+
+typedef struct
+{
+  uint8_t  *bitmap;
+  GFXglyph *glyph;
+  uint16_t  first;
+  uint16_t  last;
+  uint8_t   yAdvance;
+} GFXfont;
+
+class Adafruit_GFX
+{
+public:
+  Adafruit_GFX(int16_t w, int16_t h)
+    : WIDTH(w), HEIGHT(h), _width(w), _height(h), rotation(0),
+      textsize_x(1), textsize_y(1), wrap(true), gfxFont(nullptr) {}
+  virtual ~Adafruit_GFX() {}
+
+  virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+  virtual void fillScreen(uint16_t color)
+  {
+    for (int16_t y = 0; y < _height; ++y)
+    {
+      for (int16_t x = 0; x < _width; ++x)
+      {
+        drawPixel(x, y, color);
+      }
+    }
+  }
+
+  int16_t width() const { return _width; }
+  int16_t height() const { return _height; }
+  uint8_t getRotation() const { return rotation; }
+  void setRotation(uint8_t r)
+  {
+    rotation = r & 3;
+    _width = rotation & 1 ? HEIGHT : WIDTH;
+    _height = rotation & 1 ? WIDTH : HEIGHT;
+  }
+
+  void setFont(const GFXfont *f) { gfxFont = const_cast<GFXfont *>(f); }
+  void setTextWrap(bool w) { wrap = w; }
+  void setTextSize(uint8_t s) { textsize_x = textsize_y = s > 0 ? s : 1; }
+
+  void getTextBounds(const char *str, int16_t x, int16_t y, int16_t *x1,
+                     int16_t *y1, uint16_t *w, uint16_t *h)
+  {
+    uint8_t c;
+    int16_t minx = 0x7FFF, miny = 0x7FFF, maxx = -1, maxy = -1;
+    *x1 = x;
+    *y1 = y;
+    *w = *h = 0;
+    while ((c = *str++))
+    {
+      charBounds(c, &x, &y, &minx, &miny, &maxx, &maxy);
+    }
+    if (maxx >= minx)
+    {
+      *x1 = minx;
+      *w = maxx - minx + 1;
+    }
+    if (maxy >= miny)
+    {
+      *y1 = miny;
+      *h = maxy - miny + 1;
+    }
+  }
+  void getTextBounds(const String &str, int16_t x, int16_t y, int16_t *x1,
+                     int16_t *y1, uint16_t *w, uint16_t *h)
+  {
+    getTextBounds(str.c_str(), x, y, x1, y1, w, h);
+  }
+
+protected:
+  void charBounds(unsigned char c, int16_t *x, int16_t *y, int16_t *minx,
+                  int16_t *miny, int16_t *maxx, int16_t *maxy)
+  {
+    if (gfxFont == nullptr)
+    {
+      // classic 6x8 font
+      if (c == '\n')
+      {
+        *x = 0;
+        *y += textsize_y * 8;
+      }
+      else if (c != '\r')
+      {
+        if (wrap && ((*x + textsize_x * 6) > _width))
+        {
+          *x = 0;
+          *y += textsize_y * 8;
+        }
+        int x2 = *x + textsize_x * 6 - 1, y2 = *y + textsize_y * 8 - 1;
+        if (x2 > *maxx) *maxx = x2;
+        if (y2 > *maxy) *maxy = y2;
+        if (*x < *minx) *minx = *x;
+        if (*y < *miny) *miny = *y;
+        *x += textsize_x * 6;
+      }
+      return;
+    }
+    if (c == '\n')
+    {
+      *x = 0;
+      *y += textsize_y * static_cast<uint8_t>(gfxFont->yAdvance);
+    }
+    else if (c != '\r')
+    {
+      uint8_t first = gfxFont->first, last = gfxFont->last;
+      if ((c >= first) && (c <= last))
+      {
+        const GFXglyph *glyph = &gfxFont->glyph[c - first];
+        uint8_t gw = glyph->width, gh = glyph->height, xa = glyph->xAdvance;
+        int8_t xo = glyph->xOffset, yo = glyph->yOffset;
+        if (wrap && ((*x + ((static_cast<int16_t>(xo) + gw) * textsize_x))
+                     > _width))
+        {
+          *x = 0;
+          *y += textsize_y * static_cast<uint8_t>(gfxFont->yAdvance);
+        }
+        int16_t tsx = textsize_x, tsy = textsize_y,
+                x1 = *x + xo * tsx, y1 = *y + yo * tsy,
+                x2 = x1 + gw * tsx - 1, y2 = y1 + gh * tsy - 1;
+        if (x1 < *minx) *minx = x1;
+        if (y1 < *miny) *miny = y1;
+        if (x2 > *maxx) *maxx = x2;
+        if (y2 > *maxy) *maxy = y2;
+        *x += xa * tsx;
+      }
+    }
+  }
+
+  const int16_t WIDTH, HEIGHT;
+  int16_t _width, _height;
+  uint8_t rotation;
+  uint8_t textsize_x, textsize_y;
+  bool wrap;
+  GFXfont *gfxFont;
+};
+
+#endif
@@ -0,0 +1,74 @@
+/* Arduino core stand-in for the native test environment
+ * See Arduino.h and arduino_host.h.
+ */
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include "Arduino.h"
+#include "arduino_host.h"
+#include "esp_system.h"
+
+HostSerial Serial;
+
+static unsigned long hostMillis = 0;
+static uint32_t randomState = 1;
+
+unsigned long millis()
+{
+  return hostMillis;
+}
+
+unsigned long micros()
+{
+  using namespace std::chrono;
+  static const steady_clock::time_point start = steady_clock::now();
+  return static_cast<unsigned long>(
+    duration_cast<microseconds>(steady_clock::now() - start).count());
+}
+
+void delay(unsigned long ms)
+{
+  hostMillis += ms;
+}
+
+void hostSetMillis(unsigned long ms)
+{
+  hostMillis = ms;
+}
+
+void hostAdvanceMillis(unsigned long ms)
+{
+  hostMillis += ms;
+}
+
+void hostSeedRandom(uint32_t seed)
+{
+  randomState = seed != 0 ? seed : 1;
+}
+
+/* xorshift32, repeatable from the seed.
+ */
+uint32_t esp_random()
+{
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+bool hostLoadFixture(const char *name, std::string &data)
+{
+  const char *dir = getenv("TRMNL_FIXTURES");
+  std::string path = std::string(dir != nullptr ? dir : "test/fixtures")
+                     + "/" + name;
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+  {
+    return false;
+  }
+  std::ostringstream buf;
+  buf << in.rdbuf();
+  data = buf.str();
+  return true;
+}
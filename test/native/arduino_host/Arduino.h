@@ -0,0 +1,309 @@
+/* Arduino core stand-in for the native test environment
+ * Just enough of the ESP32 Arduino core (String, Print, Stream, Serial and
+ * the time functions) to build the device-independent sources on the host.
+ * Behaviour follows the ESP32 core where the sources depend on it.
+ *
+ * millis() is a simulated clock that only moves when delay() is called or the
+ * test moves it, see arduino_host.h. micros() is the real clock, for timing.
+ */
+
+#ifndef __ARDUINO_H__
+#define __ARDUINO_H__
+
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using std::max;
+using std::min;
+
+#define PROGMEM
+#define F(s)                (s)
+#define pgm_read_byte(p)    (*reinterpret_cast<const uint8_t *>(p))
+#define pgm_read_word(p)    (*reinterpret_cast<const uint16_t *>(p))
+#define pgm_read_dword(p)   (*reinterpret_cast<const uint32_t *>(p))
+#define pgm_read_ptr(p)     (*reinterpret_cast<void * const *>(p))
+
+#define DEC 10
+#define HEX 16
+
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+inline size_t strlcpy(char *dst, const char *src, size_t size)
+{
+  size_t len = strlen(src);
+  if (size > 0)
+  {
+    size_t n = len < size - 1 ? len : size - 1;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+  }
+  return len;
+}
+#endif
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+inline void yield() {}
+
+class String
+{
+public:
+  String() {}
+  String(const char *s) : _s(s != nullptr ? s : "") {}
+  String(const std::string &s) : _s(s) {}
+  explicit String(char c) : _s(1, c) {}
+  String(int v, unsigned char base = DEC) : _s(fromLong(v, base)) {}
+  String(unsigned v, unsigned char base = DEC) : _s(fromULong(v, base)) {}
+  String(long v, unsigned char base = DEC) : _s(fromLong(v, base)) {}
+  String(unsigned long v, unsigned char base = DEC)
+    : _s(fromULong(v, base)) {}
+  String(long long v) : _s(std::to_string(v)) {}
+  String(unsigned long long v) : _s(std::to_string(v)) {}
+  String(float v, unsigned char decimals = 2) : _s(fromDouble(v, decimals)) {}
+  String(double v, unsigned char decimals = 2) : _s(fromDouble(v, decimals))
+  {}
+
+  const char *c_str() const { return _s.c_str(); }
+  unsigned length() const { return _s.size(); }
+  bool isEmpty() const { return _s.empty(); }
+  void reserve(unsigned size) { _s.reserve(size); }
+
+  char charAt(unsigned i) const { return i < _s.size() ? _s[i] : 0; }
+  char operator[](unsigned i) const { return charAt(i); }
+  char &operator[](unsigned i) { return _s[i]; }
+
+  int indexOf(char c, unsigned from = 0) const
+  {
+    return toIndex(_s.find(c, from));
+  }
+  int indexOf(const String &s, unsigned from = 0) const
+  {
+    return toIndex(_s.find(s._s, from));
+  }
+  int lastIndexOf(char c) const { return toIndex(_s.rfind(c)); }
+  int lastIndexOf(const String &s) const { return toIndex(_s.rfind(s._s)); }
+  bool startsWith(const String &s) const { return _s.rfind(s._s, 0) == 0; }
+  bool endsWith(const String &s) const
+  {
+    return _s.size() >= s._s.size()
+        && _s.compare(_s.size() - s._s.size(), s._s.size(), s._s) == 0;
+  }
+
+  // Like the core, the bounds are swapped if left > right and clamped to
+  // the length.
+  String substring(unsigned left) const
+  {
+    return left < _s.size() ? String(_s.substr(left)) : String();
+  }
+  String substring(unsigned left, unsigned right) const
+  {
+    if (left > right)
+    {
+      std::swap(left, right);
+    }
+    if (left >= _s.size())
+    {
+      return String();
+    }
+    return String(_s.substr(left, std::min<size_t>(right, _s.size()) - left));
+  }
+  void remove(unsigned index)
+  {
+    if (index < _s.size())
+    {
+      _s.erase(index);
+    }
+  }
+  void remove(unsigned index, unsigned count)
+  {
+    if (index < _s.size())
+    {
+      _s.erase(index, count);
+    }
+  }
+  void trim()
+  {
+    size_t b = _s.find_first_not_of(" \t\r\n");
+    size_t e = _s.find_last_not_of(" \t\r\n");
+    _s = b == std::string::npos ? std::string() : _s.substr(b, e - b + 1);
+  }
+  long toInt() const { return strtol(_s.c_str(), nullptr, 10); }
+  float toFloat() const { return strtof(_s.c_str(), nullptr); }
+
+  bool concat(const String &s) { _s += s._s; return true; }
+  bool concat(const char *s) { _s += s != nullptr ? s : ""; return true; }
+  bool concat(char c) { _s += c; return true; }
+  String &operator+=(const String &s) { _s += s._s; return *this; }
+  String &operator+=(const char *s) { concat(s); return *this; }
+  String &operator+=(char c) { _s += c; return *this; }
+
+  bool operator==(const String &s) const { return _s == s._s; }
+  bool operator==(const char *s) const { return _s == (s != nullptr ? s : ""); }
+  bool operator!=(const String &s) const { return _s != s._s; }
+  bool operator!=(const char *s) const { return !(*this == s); }
+  bool operator<(const String &s) const { return _s < s._s; }
+
+  friend String operator+(const String &a, const String &b)
+  {
+    return String(a._s + b._s);
+  }
+  friend String operator+(const String &a, const char *b)
+  {
+    return String(a._s + (b != nullptr ? b : ""));
+  }
+  friend String operator+(const char *a, const String &b)
+  {
+    return String((a != nullptr ? a : "") + b._s);
+  }
+  friend String operator+(const String &a, char b) { return String(a._s + b); }
+
+private:
+  static int toIndex(size_t pos)
+  {
+    return pos == std::string::npos ? -1 : static_cast<int>(pos);
+  }
+  static std::string fromULong(unsigned long v, unsigned char base)
+  {
+    char buf[8 * sizeof(v) + 1];
+    char *p = buf + sizeof(buf) - 1;
+    *p = '\0';
+    do
+    {
+      unsigned d = v % base;
+      *--p = d < 10 ? '0' + d : 'a' + d - 10;
+      v /= base;
+    } while (v != 0);
+    return p;
+  }
+  static std::string fromLong(long v, unsigned char base)
+  {
+    if (v < 0 && base == DEC)
+    {
+      return "-" + fromULong(-static_cast<unsigned long>(v), base);
+    }
+    return fromULong(static_cast<unsigned long>(v), base);
+  }
+  static std::string fromDouble(double v, unsigned char decimals)
+  {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+    return buf;
+  }
+
+  std::string _s;
+};
+
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size)
+  {
+    size_t n = 0;
+    while (size-- > 0 && write(*buffer++) == 1)
+    {
+      ++n;
+    }
+    return n;
+  }
+  size_t write(const char *s)
+  {
+    return write(reinterpret_cast<const uint8_t *>(s), strlen(s));
+  }
+
+  size_t print(const char *s) { return write(s); }
+  size_t print(const String &s) { return write(s.c_str()); }
+  size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+  size_t print(int v, int base = DEC) { return print(String(v, base)); }
+  size_t print(unsigned v, int base = DEC) { return print(String(v, base)); }
+  size_t print(long v, int base = DEC) { return print(String(v, base)); }
+  size_t print(unsigned long v, int base = DEC)
+  {
+    return print(String(v, base));
+  }
+  size_t print(double v, int decimals = 2) { return print(String(v, decimals)); }
+  size_t println() { return write("\n"); }
+  template <typename T>
+  size_t println(const T &v)
+  {
+    return print(v) + println();
+  }
+  template <typename T>
+  size_t println(const T &v, int format)
+  {
+    return print(v, format) + println();
+  }
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)))
+  {
+    char buf[512];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (len < 0)
+    {
+      return 0;
+    }
+    return write(reinterpret_cast<const uint8_t *>(buf),
+                 std::min<size_t>(len, sizeof(buf) - 1));
+  }
+};
+
+class Stream : public Print
+{
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeout) { _timeout = timeout; }
+  unsigned long getTimeout() const { return _timeout; }
+
+  virtual size_t readBytes(char *buffer, size_t length)
+  {
+    size_t n = 0;
+    int c;
+    while (n < length && (c = read()) >= 0)
+    {
+      buffer[n++] = static_cast<char>(c);
+    }
+    return n;
+  }
+  size_t readBytes(uint8_t *buffer, size_t length)
+  {
+    return readBytes(reinterpret_cast<char *>(buffer), length);
+  }
+
+protected:
+  unsigned long _timeout = 1000;
+};
+
+/* Serial writes to stdout and never has input.
+ */
+class HostSerial : public Stream
+{
+public:
+  void begin(unsigned long) {}
+  void flush() { fflush(stdout); }
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+  size_t write(const uint8_t *buffer, size_t size) override
+  {
+    return fwrite(buffer, 1, size, stdout);
+  }
+  using Print::write;
+};
+
+extern HostSerial Serial;
+
+#endif
@@ -0,0 +1,169 @@
+/* GxEPD2_BW stand-in for the native test environment
+ * The paged buffer of GxEPD2_BW without the panel: drawing, windows and pages
+ * behave as in the library, refreshes do nothing. The private members are
+ * declared with the library's names and types, as frame_buffer.cpp names
+ * them.
+ *
+ * The host* members are additions for tests.
+ */
+
+#ifndef __GXEPD2_BW_H__
+#define __GXEPD2_BW_H__
+
+#include <Adafruit_GFX.h>
+
+#define GxEPD_BLACK 0x0000
+#define GxEPD_WHITE 0xFFFF
+
+struct GxEPD2_750_T7
+{
+  static const uint16_t WIDTH = 800;
+  static const uint16_t HEIGHT = 480;
+};
+
+struct GxEPD2_750
+{
+  static const uint16_t WIDTH = 640;
+  static const uint16_t HEIGHT = 384;
+};
+
+template <typename GxEPD2_Type, const uint16_t page_height>
+class GxEPD2_BW : public Adafruit_GFX
+{
+public:
+  GxEPD2_BW() : Adafruit_GFX(GxEPD2_Type::WIDTH, GxEPD2_Type::HEIGHT)
+  {
+    _page_height = page_height;
+    _pages = (HEIGHT / _page_height) + ((HEIGHT % _page_height) > 0);
+    _mirror = false;
+    _reverse = false;
+    _using_partial_mode = false;
+    _second_phase = false;
+    _width_bytes = WIDTH / 8;
+    _pixel_bytes = 1;
+    _current_page = 0;
+    setFullWindow();
+    fillScreen(GxEPD_WHITE);
+  }
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override
+  {
+    if ((x < 0) || (x >= width()) || (y < 0) || (y >= height())) return;
+    if (_mirror) x = width() - x - 1;
+    switch (getRotation())
+    {
+      case 1:
+        std::swap(x, y);
+        x = WIDTH - x - 1;
+        break;
+      case 2:
+        x = WIDTH - x - 1;
+        y = HEIGHT - y - 1;
+        break;
+      case 3:
+        std::swap(x, y);
+        y = HEIGHT - y - 1;
+        break;
+    }
+    // adjust for current partial window and page
+    x -= _pw_x;
+    y -= _pw_y;
+    if ((x < 0) || (x >= int16_t(_pw_w)) || (y < 0) || (y >= int16_t(_pw_h)))
+      return;
+    y -= _current_page * _page_height;
+    if ((y < 0) || (y >= int16_t(_page_height))) return;
+    if (_reverse) y = _page_height - y - 1;
+    uint16_t i = x / 8 + y * (_pw_w / 8);
+    if (color)
+      _buffer[i] = (_buffer[i] | (1 << (7 - x % 8)));
+    else
+      _buffer[i] = (_buffer[i] & (0xFF ^ (1 << (7 - x % 8))));
+  }
+
+  void fillScreen(uint16_t color) override
+  {
+    memset(_buffer, color == GxEPD_BLACK ? 0x00 : 0xFF, sizeof(_buffer));
+  }
+
+  void drawInvertedBitmap(int16_t x, int16_t y, const uint8_t bitmap[],
+                          int16_t w, int16_t h, uint16_t color)
+  {
+    int16_t byteWidth = (w + 7) / 8;
+    uint8_t byte = 0;
+    for (int16_t j = 0; j < h; j++)
+    {
+      for (int16_t i = 0; i < w; i++)
+      {
+        if (i & 7) byte <<= 1;
+        else byte = pgm_read_byte(&bitmap[j * byteWidth + i / 8]);
+        if (!(byte & 0x80)) drawPixel(x + i, y + j, color);
+      }
+    }
+  }
+
+  void setFullWindow()
+  {
+    _using_partial_mode = false;
+    _pw_x = 0;
+    _pw_y = 0;
+    _pw_w = WIDTH;
+    _pw_h = HEIGHT;
+    _pages = (HEIGHT / _page_height) + ((HEIGHT % _page_height) > 0);
+  }
+
+  void setPartialWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+  {
+    _pw_x = std::min<uint16_t>(x, WIDTH);
+    _pw_y = std::min<uint16_t>(y, HEIGHT);
+    _pw_w = std::min<uint16_t>(w, WIDTH - _pw_x);
+    _pw_h = std::min<uint16_t>(h, HEIGHT - _pw_y);
+    _using_partial_mode = true;
+    // make _pw_x, _pw_w multiple of 8
+    _pw_w += _pw_x % 8;
+    if (_pw_w % 8 > 0) _pw_w += 8 - _pw_w % 8;
+    _pw_x -= _pw_x % 8;
+    _pages = 1 + ((_pw_h - 1) / _page_height);
+  }
+
+  void firstPage()
+  {
+    fillScreen(GxEPD_WHITE);
+    _current_page = 0;
+    _second_phase = false;
+  }
+
+  bool nextPage()
+  {
+    if (++_current_page < _pages)
+    {
+      fillScreen(GxEPD_WHITE);
+      return true;
+    }
+    return false;
+  }
+
+  uint16_t pages() const { return _pages; }
+  uint16_t pageHeight() const { return _page_height; }
+
+  // Pages of fewer rows than page_height, to draw as a display with a
+  // smaller buffer would.
+  void hostSetPageHeight(uint16_t rows)
+  {
+    _page_height = std::min(rows, page_height);
+    _pages = 1 + ((_pw_h - 1) / _page_height);
+  }
+  void hostSetPage(int16_t page) { _current_page = page; }
+  void hostSetMirror(bool mirror) { _mirror = mirror; }
+  uint8_t *hostBuffer() { return _buffer; }
+  size_t hostBufferSize() const { return sizeof(_buffer); }
+
+private:
+  uint8_t _buffer[(GxEPD2_Type::WIDTH / 8) * page_height];
+  bool _using_partial_mode, _second_phase, _mirror, _reverse;
+  uint16_t _width_bytes, _pixel_bytes;
+  int16_t _current_page;
+  uint16_t _pages, _page_height;
+  uint16_t _pw_x, _pw_y, _pw_w, _pw_h;
+};
+
+#endif
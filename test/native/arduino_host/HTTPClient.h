@@ -0,0 +1,10 @@
+/* HTTPClient.h stand-in for the native test environment
+ * The sources built on the host only need the header to exist.
+ */
+
+#ifndef __HTTP_CLIENT_H__
+#define __HTTP_CLIENT_H__
+
+#include <Arduino.h>
+
+#endif
@@ -0,0 +1,10 @@
+/* WiFi.h stand-in for the native test environment
+ * The sources built on the host only need the header to exist.
+ */
+
+#ifndef __WIFI_H__
+#define __WIFI_H__
+
+#include <Arduino.h>
+
+#endif
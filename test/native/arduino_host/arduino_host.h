@@ -0,0 +1,82 @@
+/* Test controls of the native Arduino stand-in
+ * The simulated millis() clock, the counted heap behind esp_heap_caps.h, the
+ * esp_random() sequence and an in-memory Stream for recorded responses.
+ */
+
+#ifndef __ARDUINO_HOST_H__
+#define __ARDUINO_HOST_H__
+
+#include <cstdint>
+#include <string>
+#include <Arduino.h>
+
+// millis() starts at 0 and only moves with delay() or these.
+void hostSetMillis(unsigned long ms);
+void hostAdvanceMillis(unsigned long ms);
+
+// esp_random() is a fixed pseudo-random sequence restarted by this.
+void hostSeedRandom(uint32_t seed);
+
+/* Heap use, counted by wrapping malloc() and friends (the native environment
+ * links with -Wl,--wrap=malloc,...) and reported through heap_caps_get_info()
+ * as a heap of HOST_HEAP_SIZE bytes without fragmentation.
+ */
+#define HOST_HEAP_SIZE (320 * 1024)
+
+typedef struct host_heap_stats
+{
+  size_t inUse;             // Bytes allocated
+  size_t peak;              // Most bytes allocated since the last reset
+  size_t blocks;            // Live allocations
+  size_t allocs;            // Allocations made since the last reset
+} host_heap_stats_t;
+
+host_heap_stats_t hostHeapStats();
+// Starts a new peak (and low-water mark) at the current use.
+void hostHeapResetPeak();
+
+/* Reads test/fixtures/<name>, or <name> under $TRMNL_FIXTURES if set.
+ * Returns false if the file can't be read.
+ */
+bool hostLoadFixture(const char *name, std::string &data);
+
+/* Stream over bytes in memory. available() reports at most chunk bytes at a
+ * time, like a socket that receives the response one TCP segment at a time.
+ */
+class MemoryStream : public Stream
+{
+public:
+  MemoryStream(const std::string &data, size_t chunk = 1460)
+    : _data(data), _pos(0), _chunk(chunk) {}
+
+  size_t position() const { return _pos; }
+  void rewind() { _pos = 0; }
+
+  int available() override
+  {
+    return static_cast<int>(std::min(_data.size() - _pos, _chunk));
+  }
+  int read() override
+  {
+    return _pos < _data.size() ? static_cast<uint8_t>(_data[_pos++]) : -1;
+  }
+  int peek() override
+  {
+    return _pos < _data.size() ? static_cast<uint8_t>(_data[_pos]) : -1;
+  }
+  size_t readBytes(char *buffer, size_t length) override
+  {
+    size_t n = std::min(length, _data.size() - _pos);
+    memcpy(buffer, _data.data() + _pos, n);
+    _pos += n;
+    return n;
+  }
+  size_t write(uint8_t) override { return 0; }
+
+private:
+  const std::string &_data;
+  size_t _pos;
+  size_t _chunk;
+};
+
+#endif
@@ -0,0 +1,30 @@
+/* ESP-IDF esp_heap_caps.h stand-in for the native test environment
+ * Reports the heap counted by host_heap.cpp, see arduino_host.h.
+ */
+
+#ifndef __ESP_HEAP_CAPS_H__
+#define __ESP_HEAP_CAPS_H__
+
+#include <cstddef>
+#include <cstdint>
+
+#define MALLOC_CAP_8BIT    (1 << 2)
+#define MALLOC_CAP_SPIRAM  (1 << 10)
+#define MALLOC_CAP_DEFAULT (1 << 12)
+
+typedef struct multi_heap_info
+{
+  size_t total_free_bytes;
+  size_t total_allocated_bytes;
+  size_t largest_free_block;
+  size_t minimum_free_bytes;
+  size_t allocated_blocks;
+  size_t free_blocks;
+  size_t total_blocks;
+} multi_heap_info_t;
+
+void heap_caps_get_info(multi_heap_info_t *info, uint32_t caps);
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+
+#endif
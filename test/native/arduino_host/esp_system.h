@@ -0,0 +1,12 @@
+/* ESP-IDF esp_system.h stand-in for the native test environment
+ */
+
+#ifndef __ESP_SYSTEM_H__
+#define __ESP_SYSTEM_H__
+
+#include <cstdint>
+
+// Repeatable sequence, see hostSeedRandom()
+uint32_t esp_random();
+
+#endif
@@ -0,0 +1,10 @@
+/* Configuration values used by the sources built for the native test
+ * environment. config.cpp needs secrets.h and a board, so the few values the
+ * host-built sources read are repeated here; keep them in step with
+ * config.cpp.
+ */
+
+#include "config.h"
+
+const unsigned long WAKE_BUDGET = 30000; // 30 seconds
+const unsigned long WAKE_RENDER_RESERVE = 8000; // 8 seconds
@@ -0,0 +1,12 @@
+/* The display the sources draw to, defined by renderer.cpp on the device
+ */
+
+#include "renderer.h"
+
+#if defined(DISP_BW_V2)
+GxEPD2_BW<GxEPD2_750_T7, GxEPD2_750_T7::HEIGHT> display;
+#elif defined(DISP_BW_V1)
+GxEPD2_BW<GxEPD2_750, GxEPD2_750::HEIGHT> display;
+#else
+#error "The native environment only stands in for black and white panels"
+#endif
@@ -0,0 +1,171 @@
+/* Counted heap for the native test environment
+ * The native environment links with --wrap for malloc, free, realloc and
+ * calloc, so every allocation made by the code under test (ArduinoJson's
+ * included, and operator new below) comes through here and is counted by its
+ * usable size.
+ */
+
+#include <malloc.h>
+#include <new>
+#include "arduino_host.h"
+#include "esp_heap_caps.h"
+
+extern "C" {
+void *__real_malloc(size_t size);
+void  __real_free(void *ptr);
+void *__real_realloc(void *ptr, size_t size);
+void *__real_calloc(size_t n, size_t size);
+}
+
+static host_heap_stats_t heap;
+
+static void countAlloc(void *ptr)
+{
+  if (ptr == nullptr)
+  {
+    return;
+  }
+  heap.inUse += malloc_usable_size(ptr);
+  heap.peak = std::max(heap.peak, heap.inUse);
+  ++heap.blocks;
+  ++heap.allocs;
+}
+
+static void countFree(void *ptr)
+{
+  if (ptr == nullptr)
+  {
+    return;
+  }
+  heap.inUse -= malloc_usable_size(ptr);
+  --heap.blocks;
+}
+
+extern "C" {
+
+void *__wrap_malloc(size_t size)
+{
+  void *ptr = __real_malloc(size);
+  countAlloc(ptr);
+  return ptr;
+}
+
+void __wrap_free(void *ptr)
+{
+  countFree(ptr);
+  __real_free(ptr);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+  size_t before = ptr != nullptr ? malloc_usable_size(ptr) : 0;
+  void *moved = __real_realloc(ptr, size);
+  if (moved == nullptr)
+  {
+    // realloc(ptr, 0) may free ptr, a failed realloc leaves it as it was
+    if (size == 0 && ptr != nullptr)
+    {
+      heap.inUse -= before;
+      --heap.blocks;
+    }
+    return moved;
+  }
+  if (ptr == nullptr)
+  {
+    countAlloc(moved);
+    return moved;
+  }
+  heap.inUse = heap.inUse - before + malloc_usable_size(moved);
+  heap.peak = std::max(heap.peak, heap.inUse);
+  ++heap.allocs;
+  return moved;
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+  void *ptr = __real_calloc(n, size);
+  countAlloc(ptr);
+  return ptr;
+}
+
+} // extern "C"
+
+// new and delete go through the wrapped malloc and free
+
+void *operator new(size_t size)
+{
+  void *ptr = malloc(size != 0 ? size : 1);
+  if (ptr == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void *operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+  return malloc(size != 0 ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+  return malloc(size != 0 ? size : 1);
+}
+
+void operator delete(void *ptr) noexcept
+{
+  free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+  free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+  free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+  free(ptr);
+}
+
+host_heap_stats_t hostHeapStats()
+{
+  return heap;
+}
+
+void hostHeapResetPeak()
+{
+  heap.peak = heap.inUse;
+  heap.allocs = 0;
+}
+
+void heap_caps_get_info(multi_heap_info_t *info, uint32_t)
+{
+  *info = {};
+  info->total_allocated_bytes = heap.inUse;
+  info->total_free_bytes      = HOST_HEAP_SIZE - heap.inUse;
+  info->largest_free_block    = info->total_free_bytes;
+  info->minimum_free_bytes    = HOST_HEAP_SIZE - heap.peak;
+  info->allocated_blocks      = heap.blocks;
+  info->free_blocks           = 1;
+  info->total_blocks          = heap.blocks + 1;
+}
+
+size_t heap_caps_get_free_size(uint32_t)
+{
+  return HOST_HEAP_SIZE - heap.inUse;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t)
+{
+  return HOST_HEAP_SIZE - heap.inUse;
+}
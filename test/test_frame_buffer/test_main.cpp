@@ -0,0 +1,335 @@
+/* Tests of the frame buffer kernels for TRMNL OG Weather Station
+ * blitInvertedBitmap() pixel for pixel against GxEPD2's drawInvertedBitmap(),
+ * and fillPattern() and the dashed lines against drawPixel() loops, over
+ * random positions, sizes and clipping, with the full window, partial windows
+ * and pages of a smaller buffer. The reference draws to a second display of
+ * the same type, both buffers must match byte for byte after every call.
+ *
+ * test_benchmark prints the time of the kernels and of the drawPixel() loops
+ * they replace, it checks nothing.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <unity.h>
+#include "arduino_host.h"
+#include "frame_buffer.h"
+#include "renderer.h"
+
+#define FB_BITMAP_MAX 200
+#define FB_BENCH_RUNS 200
+
+static decltype(display) ref;
+static uint8_t bitmap[FB_BITMAP_MAX * (FB_BITMAP_MAX / 8)];
+
+/* Sets the same random window on both displays: the full window, a partial
+ * window or one page of a buffer of fewer rows. Returns which.
+ */
+static int setRandomWindow()
+{
+  int mode = rand() % 3;
+  if (mode == 1)
+  {
+    int x = rand() % DISP_WIDTH;
+    int y = rand() % DISP_HEIGHT;
+    int w = 1 + rand() % 300;
+    int h = 1 + rand() % 200;
+    display.setPartialWindow(x, y, w, h);
+    ref.setPartialWindow(x, y, w, h);
+    display.hostSetPageHeight(DISP_HEIGHT);
+    ref.hostSetPageHeight(DISP_HEIGHT);
+    display.hostSetPage(0);
+    ref.hostSetPage(0);
+  }
+  else
+  {
+    int rows = mode == 2 ? 60 + rand() % 100 : DISP_HEIGHT;
+    int page = rand() % ((DISP_HEIGHT + rows - 1) / rows);
+    display.setFullWindow();
+    ref.setFullWindow();
+    display.hostSetPageHeight(rows);
+    ref.hostSetPageHeight(rows);
+    display.hostSetPage(page);
+    ref.hostSetPage(page);
+  }
+  return mode;
+} // end setRandomWindow
+
+static void setWholeScreen()
+{
+  display.setFullWindow();
+  ref.setFullWindow();
+  display.hostSetPageHeight(DISP_HEIGHT);
+  ref.hostSetPageHeight(DISP_HEIGHT);
+  display.hostSetPage(0);
+  ref.hostSetPage(0);
+} // end setWholeScreen
+
+/* Sets or clears pixel (x, y) of ref's buffer in the geometry fb describes
+ * for display, as the drawPixel() loops the kernels replace would.
+ */
+static void refRasterOp(const frame_buffer_t &fb, int x, int y,
+                        raster_op_t op)
+{
+  x -= fb.x;
+  y -= fb.y;
+  if (x < 0 || x >= fb.w || y < 0 || y >= fb.h)
+  {
+    return;
+  }
+  uint8_t &b = ref.hostBuffer()[y * fb.stride + x / 8];
+  uint8_t bit = 0x80 >> (x & 7);
+  if (op == RASTER_AND)
+  {
+    b &= ~bit;
+  }
+  else if (op == RASTER_OR)
+  {
+    b |= bit;
+  }
+  else
+  {
+    b ^= bit;
+  }
+} // end refRasterOp
+
+static void expectBuffersEqual(int t)
+{
+  char msg[32];
+  snprintf(msg, sizeof(msg), "t=%d", t);
+  TEST_ASSERT_EQUAL_MEMORY_MESSAGE(ref.hostBuffer(), display.hostBuffer(),
+                                   display.hostBufferSize(), msg);
+} // end expectBuffersEqual
+
+void setUp()
+{
+  srand(1);
+  setWholeScreen();
+  display.fillScreen(GxEPD_WHITE);
+  ref.fillScreen(GxEPD_WHITE);
+}
+
+void tearDown()
+{
+}
+
+static void test_blit_matches_draw_inverted_bitmap()
+{
+  for (int t = 0; t < 20000; ++t)
+  {
+    int w = 1 + rand() % FB_BITMAP_MAX;
+    int h = 1 + rand() % FB_BITMAP_MAX;
+    for (uint8_t &b : bitmap)
+    {
+      b = rand();
+    }
+    int x = rand() % (DISP_WIDTH + 200) - 200;
+    int y = rand() % (DISP_HEIGHT + 220) - 200;
+    bool white = rand() & 1;
+    setRandomWindow();
+
+    ref.drawInvertedBitmap(x, y, bitmap, w, h,
+                           white ? GxEPD_WHITE : GxEPD_BLACK);
+    frame_buffer_t fb;
+    TEST_ASSERT_TRUE(getFrameBuffer(fb));
+    blitInvertedBitmap(fb, x, y, bitmap, w, h, white);
+    expectBuffersEqual(t);
+  }
+}
+
+static void test_no_frame_buffer_when_mirrored()
+{
+  frame_buffer_t fb;
+  display.hostSetMirror(true);
+  TEST_ASSERT_FALSE(getFrameBuffer(fb));
+  display.hostSetMirror(false);
+  display.setRotation(1);
+  TEST_ASSERT_FALSE(getFrameBuffer(fb));
+  display.setRotation(0);
+  TEST_ASSERT_TRUE(getFrameBuffer(fb));
+}
+
+static void test_fill_pattern_matches_pixels()
+{
+  for (int t = 0; t < 100000; ++t)
+  {
+    setRandomWindow();
+    frame_buffer_t fb;
+    TEST_ASSERT_TRUE(getFrameBuffer(fb));
+    if (t % 50 == 0)
+    {
+      for (size_t i = 0; i < display.hostBufferSize(); ++i)
+      {
+        display.hostBuffer()[i] = ref.hostBuffer()[i] = rand();
+      }
+    }
+    raster_op_t op = static_cast<raster_op_t>(rand() % 3);
+    int x = rand() % (DISP_WIDTH + 200) - 200;
+    int y = rand() % (DISP_HEIGHT + 220) - 200;
+    int w = rand() % 300 - 5; // including empty and negative sizes
+    int h = rand() % 100 - 5;
+    uint8_t pattern[8];
+    for (uint8_t &p : pattern)
+    {
+      p = rand();
+    }
+
+    fillPattern(fb, x, y, w, h, pattern, op);
+    for (int j = y; j < y + h; ++j)
+    {
+      for (int i = x; i < x + w; ++i)
+      {
+        if (pattern[j & 7] & (0x80 >> (i & 7)))
+        {
+          refRasterOp(fb, i, j, op);
+        }
+      }
+    }
+    expectBuffersEqual(t);
+  }
+}
+
+static void test_dashed_lines_match_pixels()
+{
+  for (int t = 0; t < 100000; ++t)
+  {
+    setRandomWindow();
+    frame_buffer_t fb;
+    TEST_ASSERT_TRUE(getFrameBuffer(fb));
+    raster_op_t op = static_cast<raster_op_t>(rand() % 3);
+    int x = rand() % (DISP_WIDTH + 200) - 200;
+    int y = rand() % (DISP_HEIGHT + 220) - 200;
+    int len = rand() % 400 - 5;
+    uint8_t dashes = rand();
+    int period = 1 + rand() % 8;
+
+    if (t & 1)
+    {
+      drawDashedHLine(fb, x, y, len, dashes, period, op);
+      for (int i = 0; i < len; ++i)
+      {
+        if (dashes & (0x80 >> (i % period)))
+        {
+          refRasterOp(fb, x + i, y, op);
+        }
+      }
+    }
+    else
+    {
+      drawDashedVLine(fb, x, y, len, dashes, period, op);
+      for (int j = 0; j < len; ++j)
+      {
+        if (dashes & (0x80 >> (j % period)))
+        {
+          refRasterOp(fb, x, y + j, op);
+        }
+      }
+    }
+    expectBuffersEqual(t);
+  }
+}
+
+static void test_graph_matches_draw_pixel()
+{
+  // the precipitation bar dither and the dotted x axis ticks of the
+  // outlook graph, as drawPixel() loops and as the kernels draw them
+  frame_buffer_t fb;
+  TEST_ASSERT_TRUE(getFrameBuffer(fb));
+  for (int t = 0; t < 20000; ++t)
+  {
+    int x0 = rand() % (DISP_WIDTH - 20);
+    int x1 = x0 + rand() % 20;
+    int y1 = 100 + rand() % 300;
+    int y0 = y1 - rand() % 100;
+    for (int y = y1 - 1; y > y0; y -= 2)
+    {
+      for (int x = x0 + (x0 % 2); x < x1; x += 2)
+      {
+        ref.drawPixel(x, y, GxEPD_BLACK);
+      }
+    }
+    uint8_t dither[8];
+    for (int row = 0; row < 8; ++row)
+    {
+      dither[row] = ((y1 - 1 - row) & 1) ? 0x00 : 0xAA;
+    }
+    fillPattern(fb, x0, y0 + 1, x1 - x0, y1 - 1 - y0, dither, RASTER_AND);
+
+    int xPos0 = rand() % 300;
+    int xPos1 = xPos0 + rand() % 400;
+    int yTick = rand() % (DISP_HEIGHT - 10);
+    for (int x = xPos0; x <= xPos1 + 1; x += 3)
+    {
+      ref.drawPixel(x, yTick + (yTick % 2), GxEPD_BLACK);
+    }
+    drawDashedHLine(fb, xPos0, yTick + (yTick % 2), xPos1 + 2 - xPos0, 0x80,
+                    3, RASTER_AND);
+    expectBuffersEqual(t);
+  }
+}
+
+static double elapsedUs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::micro>(
+           std::chrono::steady_clock::now() - start).count() / FB_BENCH_RUNS;
+} // end elapsedUs
+
+static void test_benchmark()
+{
+  for (uint8_t &b : bitmap)
+  {
+    b = rand();
+  }
+  frame_buffer_t fb;
+  TEST_ASSERT_TRUE(getFrameBuffer(fb));
+
+  auto start = std::chrono::steady_clock::now();
+  for (int k = 0; k < FB_BENCH_RUNS; ++k)
+  {
+    ref.drawInvertedBitmap(13 + k % 5, 20, bitmap, 196, 196, GxEPD_BLACK);
+  }
+  double drawUs = elapsedUs(start);
+  start = std::chrono::steady_clock::now();
+  for (int k = 0; k < FB_BENCH_RUNS; ++k)
+  {
+    blitInvertedBitmap(fb, 13 + k % 5, 20, bitmap, 196, 196, false);
+  }
+  double blitUs = elapsedUs(start);
+  printf("196x196 bitmap: drawInvertedBitmap %.1f us, "
+         "blitInvertedBitmap %.1f us\n", drawUs, blitUs);
+
+  const uint8_t dither[8] = {0xAA, 0x00, 0xAA, 0x00, 0xAA, 0x00, 0xAA, 0x00};
+  start = std::chrono::steady_clock::now();
+  for (int k = 0; k < FB_BENCH_RUNS; ++k)
+  {
+    for (int y = 249; y > 100; y -= 2)
+    {
+      for (int x = 62; x < 661; x += 2)
+      {
+        ref.drawPixel(x, y, k & 1);
+      }
+    }
+  }
+  double pixelUs = elapsedUs(start);
+  start = std::chrono::steady_clock::now();
+  for (int k = 0; k < FB_BENCH_RUNS; ++k)
+  {
+    fillPattern(fb, 61, 100, 600, 150, dither, RASTER_XOR);
+  }
+  double fillUs = elapsedUs(start);
+  printf("600x150 dither: drawPixel %.1f us, fillPattern %.1f us\n", pixelUs,
+         fillUs);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_blit_matches_draw_inverted_bitmap);
+  RUN_TEST(test_no_frame_buffer_when_mirrored);
+  RUN_TEST(test_fill_pattern_matches_pixels);
+  RUN_TEST(test_dashed_lines_match_pixels);
+  RUN_TEST(test_graph_matches_draw_pixel);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,267 @@
+/* Tests of the streaming JSON reader and parsers for TRMNL OG Weather Station
+ * JsonStreamReader::readString() truncation reporting, and field by field
+ * equivalence of the streaming parsers with the DOM parsers over the bodies
+ * in test/fixtures.
+ */
+
+#include <cmath>
+#include <string>
+#include <unity.h>
+#include "arduino_host.h"
+#include "api_response.h"
+#include "json_stream.h"
+
+static owm_resp_onecall_t       domOneCall;
+static owm_resp_onecall_t       streamOneCall;
+static owm_resp_air_pollution_t domAir;
+static owm_resp_air_pollution_t streamAir;
+
+/* Reads the value of the only member of the object in json with
+ * readString(dst, size) and returns its result.
+ */
+static size_t readMemberString(const std::string &json, char *dst,
+                               size_t size)
+{
+  MemoryStream in(json);
+  JsonStreamReader rd(in);
+  size_t len = 0;
+  TEST_ASSERT_EQUAL_INT(JSON_STREAM_OBJECT_BEGIN, rd.next());
+  TEST_ASSERT_EQUAL_INT(JSON_STREAM_KEY, rd.next());
+  len = rd.readString(dst, size);
+  TEST_ASSERT_EQUAL_INT(JSON_STREAM_OBJECT_END, rd.next());
+  TEST_ASSERT_EQUAL_INT(DeserializationError::Ok, rd.error());
+  return len;
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static void test_read_string_fits()
+{
+  char buf[16];
+  TEST_ASSERT_EQUAL_UINT(5, readMemberString("{\"k\":\"hello\"}", buf,
+                                             sizeof(buf)));
+  TEST_ASSERT_EQUAL_STRING("hello", buf);
+}
+
+static void test_read_string_truncated_by_dst()
+{
+  char buf[8];
+  size_t len = readMemberString("{\"k\":\"abcdefghijklmnopqrst\"}", buf,
+                                sizeof(buf));
+  TEST_ASSERT_EQUAL_UINT(20, len);
+  TEST_ASSERT_EQUAL_STRING("abcdefg", buf);
+}
+
+static void test_read_string_truncated_by_token()
+{
+  // longer than the token buffer, but dst would have room for all of it
+  std::string value(150, 'x');
+  char buf[200];
+  size_t len = readMemberString("{\"k\":\"" + value + "\"}", buf,
+                                sizeof(buf));
+  TEST_ASSERT_EQUAL_UINT(150, len);
+  TEST_ASSERT_GREATER_OR_EQUAL(JSON_STREAM_TOKEN_SIZE, len);
+  TEST_ASSERT_EQUAL_UINT(JSON_STREAM_TOKEN_SIZE - 1, strlen(buf));
+}
+
+static void test_read_string_counts_decoded_bytes()
+{
+  // 60 escaped u-umlauts decode to 120 bytes of UTF-8
+  std::string value;
+  for (int i = 0; i < 60; ++i)
+  {
+    value += "\\u00fc";
+  }
+  char buf[JSON_STREAM_TOKEN_SIZE];
+  TEST_ASSERT_EQUAL_UINT(120, readMemberString("{\"k\":\"" + value + "\"}",
+                                               buf, sizeof(buf)));
+}
+
+static void test_read_string_of_other_type()
+{
+  char buf[8] = "x";
+  TEST_ASSERT_EQUAL_UINT(0, readMemberString("{\"k\":[1,\"a\"]}", buf,
+                                             sizeof(buf)));
+  TEST_ASSERT_EQUAL_STRING("", buf);
+}
+
+static void test_alert_event_longer_than_token()
+{
+  std::string json = "{\"alerts\":[{\"event\":\"" + std::string(120, 'e')
+                     + "\",\"start\":1,\"end\":2,\"tags\":[\""
+                     + std::string(100, 't') + "\"]}]}";
+  MemoryStream in(json);
+  TEST_ASSERT_EQUAL_INT(DeserializationError::Ok,
+                        deserializeOneCallStream(in, streamOneCall).code());
+  TEST_ASSERT_EQUAL_UINT(1, streamOneCall.alerts.count);
+  TEST_ASSERT_EQUAL_UINT(1, streamOneCall.alerts.truncatedEvents);
+  TEST_ASSERT_EQUAL_UINT(1, streamOneCall.alerts.truncatedTags);
+  TEST_ASSERT_EQUAL_UINT(OWM_ALERT_EVENT_LEN - 1,
+                         strlen(streamOneCall.alerts.alert[0].event));
+}
+
+/* Field comparisons, floats within the rounding of the two number parsers.
+ */
+static void expectEqual(float dom, float stream, const char *what)
+{
+  TEST_ASSERT_FLOAT_WITHIN_MESSAGE(1e-5f * std::fabs(dom) + 1e-6f, dom,
+                                   stream, what);
+}
+
+static void expectEqual(int dom, int stream, const char *what)
+{
+  TEST_ASSERT_EQUAL_INT_MESSAGE(dom, stream, what);
+}
+
+static void expectEqual(int64_t dom, int64_t stream, const char *what)
+{
+  TEST_ASSERT_EQUAL_INT64_MESSAGE(dom, stream, what);
+}
+
+static void expectEqual(const owm_weather_t &dom, const owm_weather_t &stream,
+                        const char *what)
+{
+  TEST_ASSERT_EQUAL_INT_MESSAGE(dom.id, stream.id, what);
+  TEST_ASSERT_EQUAL_INT_MESSAGE(dom.icon, stream.icon, what);
+  TEST_ASSERT_EQUAL_INT_MESSAGE(dom.day, stream.day, what);
+}
+
+static void expectEqual(const owm_temp_t &dom, const owm_temp_t &stream,
+                        const char *)
+{
+#define EXPECT_TEMP_FIELD(type, member, key)                                   \
+  expectEqual(dom.member, stream.member, key);
+  OWM_TEMP_FIELDS(EXPECT_TEMP_FIELD)
+#undef EXPECT_TEMP_FIELD
+}
+
+#define EXPECT_FIELD(type, member, key)                                        \
+  expectEqual(dom.member, stream.member, key);
+#define EXPECT_1H_FIELD(member, key)                                           \
+  expectEqual(dom.member, stream.member, key);
+
+static void expectOneCallEquivalent(const char *fixture)
+{
+  std::string body;
+  TEST_ASSERT_TRUE_MESSAGE(hostLoadFixture(fixture, body), fixture);
+  MemoryStream domIn(body);
+  MemoryStream streamIn(body);
+  TEST_ASSERT_EQUAL_INT(DeserializationError::Ok,
+                        deserializeOneCall(domIn, domOneCall).code());
+  TEST_ASSERT_EQUAL_INT(DeserializationError::Ok,
+                        deserializeOneCallStream(streamIn,
+                                                 streamOneCall).code());
+
+  {
+    const owm_current_t &dom = domOneCall.current;
+    const owm_current_t &stream = streamOneCall.current;
+    OWM_CURRENT_FIELDS(EXPECT_FIELD, EXPECT_1H_FIELD)
+  }
+  for (int i = 0; i < OWM_NUM_HOURLY; ++i)
+  {
+    const owm_hourly_t &dom = domOneCall.hourly[i];
+    const owm_hourly_t &stream = streamOneCall.hourly[i];
+    OWM_HOURLY_FIELDS(EXPECT_FIELD, EXPECT_1H_FIELD)
+  }
+  for (int i = 0; i < OWM_NUM_DAILY; ++i)
+  {
+    const owm_daily_t &dom = domOneCall.daily[i];
+    const owm_daily_t &stream = streamOneCall.daily[i];
+    OWM_DAILY_FIELDS(EXPECT_FIELD, EXPECT_1H_FIELD)
+  }
+
+  // dropped is not compared, the streaming parser stops reading once
+  // OWM_NUM_ALERTS alerts are stored
+  const owm_alert_list_t &dom = domOneCall.alerts;
+  const owm_alert_list_t &stream = streamOneCall.alerts;
+  TEST_ASSERT_EQUAL_UINT(dom.count, stream.count);
+  TEST_ASSERT_EQUAL_UINT(dom.truncatedEvents, stream.truncatedEvents);
+  TEST_ASSERT_EQUAL_UINT(dom.truncatedTags, stream.truncatedTags);
+  for (int i = 0; i < dom.count; ++i)
+  {
+    TEST_ASSERT_EQUAL_STRING(dom.alert[i].event, stream.alert[i].event);
+    TEST_ASSERT_EQUAL_INT64(dom.alert[i].start, stream.alert[i].start);
+    TEST_ASSERT_EQUAL_INT64(dom.alert[i].end, stream.alert[i].end);
+    TEST_ASSERT_EQUAL_STRING(dom.alert[i].tags, stream.alert[i].tags);
+  }
+}
+
+static void expectAirQualityEquivalent(const char *fixture)
+{
+  std::string body;
+  TEST_ASSERT_TRUE_MESSAGE(hostLoadFixture(fixture, body), fixture);
+  MemoryStream domIn(body);
+  MemoryStream streamIn(body);
+  TEST_ASSERT_EQUAL_INT(DeserializationError::Ok,
+                        deserializeAirQuality(domIn, domAir).code());
+  TEST_ASSERT_EQUAL_INT(DeserializationError::Ok,
+                        deserializeAirQualityStream(streamIn,
+                                                    streamAir).code());
+
+  expectEqual(domAir.coord.lat, streamAir.coord.lat, "lat");
+  expectEqual(domAir.coord.lon, streamAir.coord.lon, "lon");
+  expectEqual(domAir.main_aqi, streamAir.main_aqi, "aqi");
+  expectEqual(domAir.dt, streamAir.dt, "dt");
+  expectEqual(domAir.samples, streamAir.samples, "samples");
+  TEST_ASSERT_EQUAL_MEMORY(domAir.slot, streamAir.slot, sizeof(domAir.slot));
+  for (int s = 0; s < OWM_NUM_AQI_POLLUTANTS; ++s)
+  {
+    for (int h = 0; h < OWM_NUM_AIR_POLLUTION; ++h)
+    {
+      expectEqual(domAir.conc[s].ring[h], streamAir.conc[s].ring[h], "ring");
+    }
+    for (int w = 0; w < OWM_NUM_AQI_WINDOWS; ++w)
+    {
+      expectEqual(domAir.conc[s].sum[w], streamAir.conc[s].sum[w], "sum");
+    }
+  }
+}
+
+static void test_onecall_48h_equivalent()
+{
+  expectOneCallEquivalent("onecall_48h.json");
+}
+
+static void test_onecall_full_equivalent()
+{
+  expectOneCallEquivalent("onecall_full.json");
+}
+
+static void test_onecall_alerts_equivalent()
+{
+  expectOneCallEquivalent("onecall_alerts.json");
+  TEST_ASSERT_EQUAL_UINT(OWM_NUM_ALERTS, streamOneCall.alerts.count);
+}
+
+static void test_air_pollution_24h_equivalent()
+{
+  expectAirQualityEquivalent("air_pollution_24h.json");
+}
+
+static void test_air_pollution_72h_equivalent()
+{
+  expectAirQualityEquivalent("air_pollution_72h.json");
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_read_string_fits);
+  RUN_TEST(test_read_string_truncated_by_dst);
+  RUN_TEST(test_read_string_truncated_by_token);
+  RUN_TEST(test_read_string_counts_decoded_bytes);
+  RUN_TEST(test_read_string_of_other_type);
+  RUN_TEST(test_alert_event_longer_than_token);
+  RUN_TEST(test_onecall_48h_equivalent);
+  RUN_TEST(test_onecall_full_equivalent);
+  RUN_TEST(test_onecall_alerts_equivalent);
+  RUN_TEST(test_air_pollution_24h_equivalent);
+  RUN_TEST(test_air_pollution_72h_equivalent);
+  return UNITY_END();
+}
@@ -0,0 +1,219 @@
+/* Parse benchmark for TRMNL OG Weather Station
+ * Runs the DOM and the streaming parser of each OpenWeatherMap response over
+ * the bodies in test/fixtures, PARSE_BENCH_RUNS times each, and checks the
+ * error they return. One JSON line per parser and body is written to
+ * parse_bench.json (or $PARSE_BENCH_OUT), with the keys of the device's
+ * [profile] lines (see parse_profile.h) and
+ *
+ *   "fixture"  body parsed
+ *   "runs"     times it was parsed, "us" is the median and "us_min" the best
+ *   "allocs"   heap allocations made by one parse
+ *
+ * heap_peak is exact here, the heap is counted by the native environment.
+ * Compare two builds with e.g.
+ *   jq -s 'map({(.fn + " " + .fixture): .us}) | add' parse_bench.json
+ */
+
+#include <algorithm>
+#include <vector>
+#include <unity.h>
+#include "arduino_host.h"
+#include "api_response.h"
+#include "parse_profile.h"
+
+#define PARSE_BENCH_RUNS 50
+
+typedef DeserializationError (*parse_fn_t)(Stream &in,
+                                           owm_parse_stats_t &stats);
+
+static owm_resp_onecall_t       onecall;
+static owm_resp_air_pollution_t airPollution;
+static FILE *benchOut = nullptr;
+
+static DeserializationError parseOneCall(Stream &in, owm_parse_stats_t &)
+{
+  return deserializeOneCall(in, onecall);
+}
+
+static DeserializationError parseOneCallStream(Stream &in,
+                                               owm_parse_stats_t &stats)
+{
+  return deserializeOneCallStream(in, onecall, &stats);
+}
+
+static DeserializationError parseAirQuality(Stream &in, owm_parse_stats_t &)
+{
+  return deserializeAirQuality(in, airPollution);
+}
+
+static DeserializationError parseAirQualityStream(Stream &in,
+                                                  owm_parse_stats_t &stats)
+{
+  return deserializeAirQualityStream(in, airPollution, &stats);
+}
+
+/* Parses fixture with parse PARSE_BENCH_RUNS times, checks each result is
+ * expected and writes the figures of the last run with the median time.
+ * Returns the stats of the last run.
+ */
+static owm_parse_stats_t bench(const char *fn, parse_fn_t parse,
+                               const char *fixture,
+                               DeserializationError::Code expected)
+{
+  std::string body;
+  TEST_ASSERT_TRUE_MESSAGE(hostLoadFixture(fixture, body), fixture);
+
+  std::vector<uint32_t> us;
+  parse_profile_t profile = {};
+  owm_parse_stats_t stats = {};
+  DeserializationError err;
+  host_heap_stats_t heap = {};
+  size_t inUseStart = 0;
+  for (int run = 0; run < PARSE_BENCH_RUNS; ++run)
+  {
+    MemoryStream raw(body);
+    CountingStream in(raw);
+    stats = {};
+    hostHeapResetPeak();
+    inUseStart = hostHeapStats().inUse;
+    beginParseProfile(profile);
+    err = parse(in, stats);
+    endParseProfile(profile, in);
+    heap = hostHeapStats();
+    TEST_ASSERT_EQUAL_INT_MESSAGE(expected, err.code(), fixture);
+    us.push_back(profile.us);
+  }
+  std::sort(us.begin(), us.end());
+  profile.heapPeak = static_cast<int32_t>(heap.peak - inUseStart);
+  printParseProfile(fn, profile, err, stats);
+
+  if (benchOut != nullptr)
+  {
+    fprintf(benchOut,
+            "{\"fn\":\"%s\",\"fixture\":\"%s\",\"err\":%d,\"runs\":%d,"
+            "\"us\":%lu,\"us_min\":%lu,\"bytes\":%u,\"skipped\":%u,"
+            "\"early\":%d,\"heap_delta\":%ld,\"block_delta\":%ld,"
+            "\"heap_peak\":%ld,\"heap_min\":%u,\"max_block\":%u,"
+            "\"allocs\":%u}\n",
+            fn, fixture, static_cast<int>(err.code()), PARSE_BENCH_RUNS,
+            static_cast<unsigned long>(us[us.size() / 2]),
+            static_cast<unsigned long>(us[0]),
+            static_cast<unsigned>(profile.bytes),
+            static_cast<unsigned>(stats.bytesSkipped),
+            stats.terminatedEarly ? 1 : 0,
+            static_cast<long>(profile.heapDelta),
+            static_cast<long>(profile.blockDelta),
+            static_cast<long>(profile.heapPeak),
+            static_cast<unsigned>(profile.heapMin),
+            static_cast<unsigned>(profile.maxBlock),
+            static_cast<unsigned>(heap.allocs));
+  }
+  return stats;
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static void test_onecall_48h()
+{
+  bench("deserializeOneCall", parseOneCall, "onecall_48h.json",
+        DeserializationError::Ok);
+  owm_parse_stats_t stats = bench("deserializeOneCallStream",
+                                  parseOneCallStream, "onecall_48h.json",
+                                  DeserializationError::Ok);
+  // fewer than OWM_NUM_ALERTS alerts, so the whole body is read
+  TEST_ASSERT_FALSE(stats.terminatedEarly);
+  TEST_ASSERT_GREATER_THAN(0, stats.bytesSkipped);
+}
+
+static void test_onecall_full()
+{
+  bench("deserializeOneCall", parseOneCall, "onecall_full.json",
+        DeserializationError::Ok);
+  bench("deserializeOneCallStream", parseOneCallStream, "onecall_full.json",
+        DeserializationError::Ok);
+}
+
+static void test_onecall_alerts()
+{
+  bench("deserializeOneCall", parseOneCall, "onecall_alerts.json",
+        DeserializationError::Ok);
+  std::string body;
+  hostLoadFixture("onecall_alerts.json", body);
+  owm_parse_stats_t stats = bench("deserializeOneCallStream",
+                                  parseOneCallStream, "onecall_alerts.json",
+                                  DeserializationError::Ok);
+  // the alerts come last, reading stops after OWM_NUM_ALERTS of them
+  TEST_ASSERT_TRUE(stats.terminatedEarly);
+  TEST_ASSERT_LESS_THAN(body.size(), stats.bytesRead);
+}
+
+static void test_onecall_truncated()
+{
+  bench("deserializeOneCall", parseOneCall, "onecall_truncated.json",
+        DeserializationError::IncompleteInput);
+  bench("deserializeOneCallStream", parseOneCallStream,
+        "onecall_truncated.json", DeserializationError::IncompleteInput);
+}
+
+static void test_onecall_malformed()
+{
+  bench("deserializeOneCall", parseOneCall, "onecall_malformed.json",
+        DeserializationError::InvalidInput);
+  bench("deserializeOneCallStream", parseOneCallStream,
+        "onecall_malformed.json", DeserializationError::InvalidInput);
+}
+
+static void test_air_pollution_24h()
+{
+  bench("deserializeAirQuality", parseAirQuality, "air_pollution_24h.json",
+        DeserializationError::Ok);
+  bench("deserializeAirQualityStream", parseAirQualityStream,
+        "air_pollution_24h.json", DeserializationError::Ok);
+  TEST_ASSERT_EQUAL_INT(24, airPollution.samples);
+}
+
+static void test_air_pollution_72h()
+{
+  bench("deserializeAirQuality", parseAirQuality, "air_pollution_72h.json",
+        DeserializationError::Ok);
+  bench("deserializeAirQualityStream", parseAirQualityStream,
+        "air_pollution_72h.json", DeserializationError::Ok);
+  TEST_ASSERT_EQUAL_INT(72, airPollution.samples);
+}
+
+static void test_air_pollution_truncated()
+{
+  bench("deserializeAirQuality", parseAirQuality,
+        "air_pollution_truncated.json", DeserializationError::IncompleteInput);
+  bench("deserializeAirQualityStream", parseAirQualityStream,
+        "air_pollution_truncated.json", DeserializationError::IncompleteInput);
+}
+
+int main()
+{
+  const char *path = getenv("PARSE_BENCH_OUT");
+  benchOut = fopen(path != nullptr ? path : "parse_bench.json", "w");
+
+  UNITY_BEGIN();
+  RUN_TEST(test_onecall_48h);
+  RUN_TEST(test_onecall_full);
+  RUN_TEST(test_onecall_alerts);
+  RUN_TEST(test_onecall_truncated);
+  RUN_TEST(test_onecall_malformed);
+  RUN_TEST(test_air_pollution_24h);
+  RUN_TEST(test_air_pollution_72h);
+  RUN_TEST(test_air_pollution_truncated);
+  int failures = UNITY_END();
+
+  if (benchOut != nullptr)
+  {
+    fclose(benchOut);
+  }
+  return failures;
+}
@@ -0,0 +1,210 @@
+/* Tests of the request retry policy for TRMNL OG Weather Station
+ * classifyStatus(), getBackoffDelay() and getAttemptTimeout() directly, and
+ * nextAttempt()/endAttempt() against the simulated millis() clock, which
+ * delay() advances, with WAKE_BUDGET and WAKE_RENDER_RESERVE of host_config.
+ */
+
+#include <unity.h>
+#include "arduino_host.h"
+#include "config.h"
+#include "request_scheduler.h"
+
+#define WAKE_START 1000
+#define DEADLINE   (WAKE_START + WAKE_BUDGET - WAKE_RENDER_RESERVE)
+
+void setUp()
+{
+  hostSetMillis(WAKE_START);
+  hostSeedRandom(1);
+  beginWakeBudget(WAKE_START);
+}
+
+void tearDown()
+{
+}
+
+static void test_classify_status()
+{
+  TEST_ASSERT_EQUAL_INT(REQUEST_OK, classifyStatus(200));
+  TEST_ASSERT_EQUAL_INT(REQUEST_REJECTED, classifyStatus(400));
+  TEST_ASSERT_EQUAL_INT(REQUEST_REJECTED, classifyStatus(401));
+  TEST_ASSERT_EQUAL_INT(REQUEST_REJECTED, classifyStatus(404));
+  // worth retrying: timeouts, rate limits, server errors, connection and
+  // parse errors
+  TEST_ASSERT_EQUAL_INT(REQUEST_PENDING, classifyStatus(408));
+  TEST_ASSERT_EQUAL_INT(REQUEST_PENDING, classifyStatus(429));
+  TEST_ASSERT_EQUAL_INT(REQUEST_PENDING, classifyStatus(500));
+  TEST_ASSERT_EQUAL_INT(REQUEST_PENDING, classifyStatus(503));
+  TEST_ASSERT_EQUAL_INT(REQUEST_PENDING, classifyStatus(-1));  // refused
+  TEST_ASSERT_EQUAL_INT(REQUEST_PENDING, classifyStatus(-11)); // read timeout
+  TEST_ASSERT_EQUAL_INT(REQUEST_PENDING, classifyStatus(-256 - 2));
+  TEST_ASSERT_EQUAL_INT(REQUEST_NO_WIFI, classifyStatus(-512));
+  TEST_ASSERT_EQUAL_INT(REQUEST_NO_WIFI, classifyStatus(-512 - 6));
+}
+
+static void test_backoff_delay()
+{
+  // no jitter: half the step
+  TEST_ASSERT_EQUAL_UINT(REQUEST_BACKOFF_BASE / 2, getBackoffDelay(1, 0));
+  TEST_ASSERT_EQUAL_UINT(REQUEST_BACKOFF_BASE, getBackoffDelay(2, 0));
+  TEST_ASSERT_EQUAL_UINT(REQUEST_BACKOFF_BASE * 2, getBackoffDelay(3, 0));
+  // capped at REQUEST_BACKOFF_MAX, also for attempts the doubling would
+  // overflow
+  TEST_ASSERT_EQUAL_UINT(REQUEST_BACKOFF_MAX / 2, getBackoffDelay(10, 0));
+  TEST_ASSERT_EQUAL_UINT(REQUEST_BACKOFF_MAX / 2, getBackoffDelay(255, 0));
+  // jitter spans 0.5 to 1.5 times the step
+  TEST_ASSERT_EQUAL_UINT(REQUEST_BACKOFF_BASE * 3 / 2,
+                         getBackoffDelay(1, REQUEST_BACKOFF_BASE));
+  for (uint8_t attempt = 1; attempt < 12; ++attempt)
+  {
+    for (uint32_t r = 0; r < 100000; r += 997)
+    {
+      unsigned long d = getBackoffDelay(attempt, r);
+      TEST_ASSERT_GREATER_OR_EQUAL(REQUEST_BACKOFF_BASE / 2, d);
+      TEST_ASSERT_LESS_OR_EQUAL(REQUEST_BACKOFF_MAX * 3 / 2, d);
+    }
+  }
+}
+
+static void test_attempt_timeout()
+{
+  request_schedule_t req;
+  beginRequest(req, "test", 3, 10000);
+  TEST_ASSERT_EQUAL_UINT(DEADLINE, req.deadline);
+  TEST_ASSERT_EQUAL_UINT(10000, getAttemptTimeout(req, WAKE_START));
+  // shrinks to the time left
+  TEST_ASSERT_EQUAL_UINT(5000, getAttemptTimeout(req, DEADLINE - 5000));
+  TEST_ASSERT_EQUAL_UINT(REQUEST_MIN_TIMEOUT,
+                         getAttemptTimeout(req, DEADLINE
+                                                - REQUEST_MIN_TIMEOUT));
+  // not worth starting
+  TEST_ASSERT_EQUAL_UINT(0, getAttemptTimeout(req, DEADLINE
+                                                   - REQUEST_MIN_TIMEOUT + 1));
+  TEST_ASSERT_EQUAL_UINT(0, getAttemptTimeout(req, DEADLINE));
+  TEST_ASSERT_EQUAL_UINT(0, getAttemptTimeout(req, DEADLINE + 60000));
+}
+
+static void test_ok_first_attempt()
+{
+  request_schedule_t req;
+  beginRequest(req, "test", 3, 10000);
+  TEST_ASSERT_EQUAL_UINT(10000, nextAttempt(req));
+  TEST_ASSERT_EQUAL_UINT(1, req.attempts);
+  hostAdvanceMillis(300);
+  endAttempt(req, 200);
+  TEST_ASSERT_EQUAL_UINT(0, nextAttempt(req));
+  TEST_ASSERT_EQUAL_INT(REQUEST_OK, req.outcome);
+  TEST_ASSERT_EQUAL_UINT(1, req.attempts);
+}
+
+static void test_retry_waits_for_backoff()
+{
+  request_schedule_t req;
+  beginRequest(req, "test", 3, 10000);
+  nextAttempt(req);
+  hostAdvanceMillis(100);
+  endAttempt(req, 503);
+  unsigned long failedAt = millis();
+  unsigned long retryAt = req.nextAt;
+  TEST_ASSERT_GREATER_OR_EQUAL(failedAt + REQUEST_BACKOFF_BASE / 2, retryAt);
+  TEST_ASSERT_LESS_OR_EQUAL(failedAt + REQUEST_BACKOFF_BASE * 3 / 2, retryAt);
+
+  TEST_ASSERT_EQUAL_UINT(10000, nextAttempt(req));
+  TEST_ASSERT_EQUAL_UINT(retryAt, millis()); // delay() ran the clock
+  TEST_ASSERT_EQUAL_UINT(2, req.attempts);
+  endAttempt(req, 200);
+  TEST_ASSERT_EQUAL_UINT(0, nextAttempt(req));
+  TEST_ASSERT_EQUAL_INT(REQUEST_OK, req.outcome);
+}
+
+static void test_rejected_is_not_retried()
+{
+  request_schedule_t req;
+  beginRequest(req, "test", 3, 10000);
+  nextAttempt(req);
+  endAttempt(req, 401);
+  unsigned long now = millis();
+  TEST_ASSERT_EQUAL_UINT(0, nextAttempt(req));
+  TEST_ASSERT_EQUAL_INT(REQUEST_REJECTED, req.outcome);
+  TEST_ASSERT_EQUAL_UINT(1, req.attempts);
+  TEST_ASSERT_EQUAL_UINT(now, millis()); // gave up without waiting
+}
+
+static void test_no_wifi_is_not_retried()
+{
+  request_schedule_t req;
+  beginRequest(req, "test", 3, 10000);
+  nextAttempt(req);
+  endAttempt(req, -512 - 1);
+  TEST_ASSERT_EQUAL_UINT(0, nextAttempt(req));
+  TEST_ASSERT_EQUAL_INT(REQUEST_NO_WIFI, req.outcome);
+}
+
+static void test_out_of_attempts()
+{
+  request_schedule_t req;
+  beginRequest(req, "test", 2, 5000);
+  TEST_ASSERT_GREATER_THAN(0, nextAttempt(req));
+  endAttempt(req, 500);
+  TEST_ASSERT_GREATER_THAN(0, nextAttempt(req));
+  endAttempt(req, 500);
+  TEST_ASSERT_EQUAL_UINT(0, nextAttempt(req));
+  TEST_ASSERT_EQUAL_INT(REQUEST_OUT_OF_ATTEMPTS, req.outcome);
+  TEST_ASSERT_EQUAL_UINT(2, req.attempts);
+  TEST_ASSERT_EQUAL_INT(500, req.status);
+}
+
+static void test_timeouts_end_at_deadline()
+{
+  // a server that never answers: every attempt runs into its timeout
+  request_schedule_t req;
+  beginRequest(req, "test", 10, 15000);
+  unsigned timeout;
+  unsigned attempts = 0;
+  while ((timeout = nextAttempt(req)) > 0)
+  {
+    ++attempts;
+    TEST_ASSERT_GREATER_OR_EQUAL(REQUEST_MIN_TIMEOUT, timeout);
+    TEST_ASSERT_LESS_OR_EQUAL(DEADLINE, millis() + timeout);
+    hostAdvanceMillis(timeout);
+    endAttempt(req, -11);
+  }
+  TEST_ASSERT_EQUAL_INT(REQUEST_OUT_OF_TIME, req.outcome);
+  TEST_ASSERT_GREATER_THAN(1, attempts);
+  TEST_ASSERT_LESS_OR_EQUAL(DEADLINE, millis());
+}
+
+static void test_late_start_is_out_of_time()
+{
+  hostSetMillis(DEADLINE - REQUEST_MIN_TIMEOUT + 1);
+  request_schedule_t req;
+  beginRequest(req, "test", 3, 10000);
+  TEST_ASSERT_EQUAL_UINT(0, nextAttempt(req));
+  TEST_ASSERT_EQUAL_INT(REQUEST_OUT_OF_TIME, req.outcome);
+  TEST_ASSERT_EQUAL_UINT(0, req.attempts);
+}
+
+static void test_time_left()
+{
+  TEST_ASSERT_EQUAL_UINT(DEADLINE, getRequestDeadline());
+  TEST_ASSERT_EQUAL_UINT(DEADLINE - WAKE_START, getRequestTimeLeft());
+  hostSetMillis(DEADLINE + 1);
+  TEST_ASSERT_EQUAL_UINT(0, getRequestTimeLeft());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_classify_status);
+  RUN_TEST(test_backoff_delay);
+  RUN_TEST(test_attempt_timeout);
+  RUN_TEST(test_ok_first_attempt);
+  RUN_TEST(test_retry_waits_for_backoff);
+  RUN_TEST(test_rejected_is_not_retried);
+  RUN_TEST(test_no_wifi_is_not_retried);
+  RUN_TEST(test_out_of_attempts);
+  RUN_TEST(test_timeouts_end_at_deadline);
+  RUN_TEST(test_late_start_is_out_of_time);
+  RUN_TEST(test_time_left);
+  return UNITY_END();
+}
@@ -0,0 +1,292 @@
+/* Tests of text measurement and line breaking for TRMNL OG Weather Station
+ * measureText() against getTextBounds(), and breakTextLine() line for line
+ * against the getTextBounds() loop that drawMultiLnString() used before it,
+ * over random strings of words, spaces and hyphens in the FreeSans fonts, and
+ * the cases that loop handles specially: the ellipsis on the last line when
+ * max_lines cuts the text short, and words wider than max_width.
+ */
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <unity.h>
+#include "arduino_host.h"
+#include "renderer.h"
+#include "text_layout.h"
+#include "fonts/FreeSans.h"
+
+// A line as drawMultiLnString() draws it: width and characters, with the
+// ellipsis
+typedef struct drawn_line
+{
+  uint16_t    w;
+  std::string text;
+} drawn_line_t;
+
+typedef std::vector<drawn_line_t> drawn_text_t;
+
+static uint16_t textWidth(const String &s)
+{
+  int16_t x1, y1;
+  uint16_t w, h;
+  display.getTextBounds(s, 0, 0, &x1, &y1, &w, &h);
+  return w;
+} // end textWidth
+
+/* The line breaking of drawMultiLnString() before breakTextLine(): measure
+ * the rest of the text, and while it is too wide cut it back to the last
+ * space or hyphen and measure again.
+ */
+static drawn_text_t breakLinesBefore(const String &text, uint16_t max_width,
+                                     uint16_t max_lines)
+{
+  drawn_text_t out;
+  uint16_t current_line = 0;
+  String textRemaining = text;
+  while (current_line < max_lines && !textRemaining.isEmpty())
+  {
+    int16_t x1, y1;
+    uint16_t w, h;
+    display.getTextBounds(textRemaining, 0, 0, &x1, &y1, &w, &h);
+    int endIndex = textRemaining.length();
+    String subStr = textRemaining;
+    int splitAt = 0;
+    int keepLastChar = 0;
+    while (w > max_width && splitAt != -1)
+    {
+      if (keepLastChar)
+      {
+        subStr.remove(subStr.length() - 1);
+      }
+      if (current_line < max_lines - 1)
+      {
+        splitAt = std::max(subStr.lastIndexOf(" "), subStr.lastIndexOf("-"));
+      }
+      else
+      {
+        splitAt = subStr.lastIndexOf(" ");
+      }
+      if (splitAt != -1)
+      {
+        endIndex = splitAt;
+        subStr = subStr.substring(0, endIndex + 1);
+        char lastChar = subStr.charAt(endIndex);
+        if (lastChar == ' ')
+        {
+          keepLastChar = 0;
+          subStr.remove(endIndex);
+          --endIndex;
+        }
+        else if (lastChar == '-')
+        {
+          keepLastChar = 1;
+        }
+        if (current_line < max_lines - 1)
+        {
+          display.getTextBounds(subStr, 0, 0, &x1, &y1, &w, &h);
+        }
+        else
+        {
+          display.getTextBounds(subStr + "...", 0, 0, &x1, &y1, &w, &h);
+          if (w <= max_width)
+          {
+            subStr = subStr + "...";
+          }
+        }
+      }
+    }
+    out.push_back({textWidth(subStr), subStr.c_str()});
+    textRemaining = textRemaining.substring(endIndex + 2 - keepLastChar);
+    ++current_line;
+  }
+  return out;
+} // end breakLinesBefore
+
+static drawn_text_t breakLines(const String &text, uint16_t max_width,
+                               uint16_t max_lines)
+{
+  drawn_text_t out;
+  const char *textRemaining = text.c_str();
+  for (uint16_t current_line = 0;
+       current_line < max_lines && *textRemaining != '\0'; ++current_line)
+  {
+    text_line_t line = breakTextLine(textRemaining, max_width,
+                                     current_line == max_lines - 1);
+    std::string s(textRemaining, line.len);
+    if (line.ellipsis)
+    {
+      s += "...";
+    }
+    out.push_back({line.w, s});
+    textRemaining += line.next;
+  }
+  return out;
+} // end breakLines
+
+static void expectSameLines(const String &text, uint16_t max_width,
+                            uint16_t max_lines)
+{
+  drawn_text_t before = breakLinesBefore(text, max_width, max_lines);
+  drawn_text_t after = breakLines(text, max_width, max_lines);
+  char msg[160];
+  snprintf(msg, sizeof(msg), "'%s' max_width=%u max_lines=%u", text.c_str(),
+           max_width, max_lines);
+  TEST_ASSERT_EQUAL_UINT_MESSAGE(before.size(), after.size(), msg);
+  for (size_t i = 0; i < before.size(); ++i)
+  {
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(before[i].text.c_str(),
+                                     after[i].text.c_str(), msg);
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(before[i].w, after[i].w, msg);
+  }
+} // end expectSameLines
+
+void setUp()
+{
+  srand(7);
+  display.setTextWrap(false);
+  display.setFont(&FreeSans_12pt8b);
+}
+
+void tearDown()
+{
+}
+
+static void test_measure_text_matches_get_text_bounds()
+{
+  const GFXfont *fonts[] = {&FreeSans_5pt8b, &FreeSans_8pt8b,
+                            &FreeSans_12pt8b, &FreeSans_26pt8b};
+  for (int t = 0; t < 20000; ++t)
+  {
+    display.setFont(fonts[rand() % 4]);
+    String text;
+    int len = rand() % 20;
+    for (int i = 0; i < len; ++i)
+    {
+      // printable ASCII and Latin-1, spaces, newlines and control characters
+      char c = static_cast<char>(rand() % 256);
+      text += c == '\0' ? ' ' : c;
+    }
+    text_bounds_t b = measureText(text);
+    int16_t x1, y1;
+    uint16_t w, h;
+    display.getTextBounds(text, 0, 0, &x1, &y1, &w, &h);
+    TEST_ASSERT_EQUAL_INT(x1, b.x1);
+    TEST_ASSERT_EQUAL_INT(y1, b.y1);
+    TEST_ASSERT_EQUAL_UINT(w, b.w);
+    TEST_ASSERT_EQUAL_UINT(h, b.h);
+  }
+}
+
+static void test_random_text_matches_before()
+{
+  const GFXfont *fonts[] = {&FreeSans_5pt8b, &FreeSans_8pt8b,
+                            &FreeSans_12pt8b, &FreeSans_26pt8b};
+  const char *words[] = {"Severe", "Thunderstorm", "Warning", "-", "Flood",
+                         "Wind-chill", "a", "", " ", "heat-", "-x", "\260C",
+                         "Yellow", "rain", "Excessive-Heat-Warning"};
+  const int numWords = sizeof(words) / sizeof(words[0]);
+  for (int t = 0; t < 100000; ++t)
+  {
+    display.setFont(fonts[rand() % 4]);
+    String text;
+    int count = rand() % 10;
+    for (int i = 0; i < count; ++i)
+    {
+      text += words[rand() % numWords];
+      if (rand() % 4)
+      {
+        text += rand() % 6 ? " " : "-";
+      }
+    }
+    expectSameLines(text, rand() % 400, rand() % 5);
+  }
+}
+
+static void test_alert_titles_match_before()
+{
+  const char *alerts[] = {
+    "Small Craft Advisory",
+    "Coastal Flood Warning",
+    "Excessive Heat Warning",
+    "Severe Thunderstorm Watch",
+    "Wind-chill Advisory in effect until Tuesday morning",
+    "Yellow warning for thunderstorms - Weather Warning for Northern Areas",
+  };
+  for (const char *alert : alerts)
+  {
+    for (uint16_t w = 0; w < 500; w += 7)
+    {
+      for (uint16_t lines = 1; lines <= 3; ++lines)
+      {
+        expectSameLines(alert, w, lines);
+      }
+    }
+  }
+}
+
+static void test_max_lines_ends_in_ellipsis()
+{
+  const char *text = "Severe Thunderstorm Warning until 9 PM tonight";
+  drawn_text_t lines = breakLines(text, 250, 2);
+  TEST_ASSERT_EQUAL_UINT(2, lines.size());
+  TEST_ASSERT_EQUAL_STRING("Severe Thunderstorm", lines[0].text.c_str());
+  TEST_ASSERT_EQUAL_STRING("Warning until 9 PM...", lines[1].text.c_str());
+  TEST_ASSERT_LESS_OR_EQUAL(250, lines[1].w);
+  TEST_ASSERT_EQUAL_UINT(textWidth("Warning until 9 PM..."), lines[1].w);
+
+  // the ellipsis is left out when it doesn't fit either
+  lines = breakLines(text, 150, 2);
+  TEST_ASSERT_EQUAL_UINT(2, lines.size());
+  TEST_ASSERT_EQUAL_STRING("Thunderstorm", lines[1].text.c_str());
+
+  // the last line breaks only at spaces
+  text_line_t line = breakTextLine("Wind-chill Advisory", 150, true);
+  TEST_ASSERT_TRUE(line.ellipsis);
+  TEST_ASSERT_EQUAL_UINT(10, line.len);
+  TEST_ASSERT_EQUAL_UINT(11, line.next);
+
+  // no ellipsis when the whole text fits
+  line = breakTextLine("Flood Watch", 400, true);
+  TEST_ASSERT_FALSE(line.ellipsis);
+  TEST_ASSERT_EQUAL_UINT(11, line.len);
+  TEST_ASSERT_EQUAL_UINT(11, line.next);
+}
+
+static void test_word_wider_than_max_width()
+{
+  // runs up to its break, and the next line starts after the space
+  text_line_t line = breakTextLine("Thunderstorm Warning", 20, false);
+  TEST_ASSERT_EQUAL_UINT(12, line.len);
+  TEST_ASSERT_EQUAL_UINT(13, line.next);
+  TEST_ASSERT_FALSE(line.ellipsis);
+  TEST_ASSERT_EQUAL_UINT(textWidth("Thunderstorm"), line.w);
+  TEST_ASSERT_GREATER_THAN(20, line.w);
+
+  // a hyphenated word that doesn't fit loses its hyphen
+  line = breakTextLine("Wind-chill", 20, false);
+  TEST_ASSERT_EQUAL_UINT(4, line.len);
+  TEST_ASSERT_EQUAL_UINT(5, line.next);
+  TEST_ASSERT_EQUAL_UINT(textWidth("Wind"), line.w);
+
+  // without a break it is drawn whole
+  line = breakTextLine("Thunderstorm", 20, true);
+  TEST_ASSERT_EQUAL_UINT(12, line.len);
+  TEST_ASSERT_EQUAL_UINT(12, line.next);
+  TEST_ASSERT_FALSE(line.ellipsis);
+
+  for (uint16_t w = 0; w < 60; ++w)
+  {
+    expectSameLines("Thunderstorm Wind-chill Excessive-Heat", w, 4);
+  }
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_measure_text_matches_get_text_bounds);
+  RUN_TEST(test_random_text_matches_before);
+  RUN_TEST(test_alert_titles_match_before);
+  RUN_TEST(test_max_lines_ends_in_ellipsis);
+  RUN_TEST(test_word_wider_than_max_width);
+  return UNITY_END();
+}
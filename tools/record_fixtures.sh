@@ -0,0 +1,42 @@
+#!/bin/sh
+# Records the OpenWeatherMap responses the native tests and the parse
+# benchmark read from test/fixtures, replacing the ones checked in.
+#
+#   OWM_APIKEY=... LAT=53.4458 LON=-2.3144 tools/record_fixtures.sh
+#
+# The requests are the ones the firmware makes (see client_utils.cpp), plus
+# onecall_full.json without exclude=minutely. onecall_alerts.json is only
+# replaced when ALERTS=1 is set, do that while a warning is in force.
+set -eu
+
+: "${OWM_APIKEY:?set OWM_APIKEY}"
+: "${LAT:?set LAT}"
+: "${LON:?set LON}"
+OWM_ENDPOINT=${OWM_ENDPOINT:-https://api.openweathermap.org}
+OWM_LANG=${OWM_LANG:-de}
+DIR=$(dirname "$0")/../test/fixtures
+
+get() {
+  # plain bodies, the firmware's gzip decoding is not under test here
+  curl --fail --silent --show-error --output "$DIR/$1" "$OWM_ENDPOINT$2&appid=$OWM_APIKEY"
+  echo "$1: $(wc -c < "$DIR/$1") bytes"
+}
+
+ONECALL="/data/3.0/onecall?lat=$LAT&lon=$LON&lang=$OWM_LANG&units=standard"
+get onecall_48h.json "$ONECALL&exclude=minutely"
+get onecall_full.json "$ONECALL"
+if [ "${ALERTS:-0}" = 1 ]; then
+  get onecall_alerts.json "$ONECALL&exclude=minutely"
+fi
+
+END=$(date +%s)
+get air_pollution_24h.json "/data/2.5/air_pollution/history?lat=$LAT&lon=$LON&start=$((END - 24 * 3600 + 1))&end=$END"
+get air_pollution_72h.json "/data/2.5/air_pollution/history?lat=$LAT&lon=$LON&start=$((END - 72 * 3600 + 1))&end=$END"
+
+# damaged copies for the error paths: cut inside the hourly forecast (or
+# halfway), and a missing colon after "current"
+SIZE=$(wc -c < "$DIR/onecall_48h.json")
+head -c $((SIZE / 6)) "$DIR/onecall_48h.json" > "$DIR/onecall_truncated.json"
+sed 's/"current":{/"current"{/' "$DIR/onecall_48h.json" > "$DIR/onecall_malformed.json"
+SIZE=$(wc -c < "$DIR/air_pollution_24h.json")
+head -c $((SIZE / 2)) "$DIR/air_pollution_24h.json" > "$DIR/air_pollution_truncated.json"
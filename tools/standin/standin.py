@@ -0,0 +1,627 @@
+#!/usr/bin/env python3
+"""Local stand-ins for the servers the weather station talks to, and a
+wake-cycle report over a station built with env:trmnl_og_standin.
+
+  OWM        https :8443  /data/3.0/onecall and /data/2.5/air_pollution/history
+                          replay test/fixtures
+  HA         http  :8123  /api/template and /api/states/<entity>
+  Nextcloud  https :8444  GET of any *.png under /remote.php/dav/
+  MQTT       tcp   :1883  a broker that records what is published
+
+The station numbers its wakes from power on and, built for the stand-ins,
+sends the number with every request in an X-Wake header (see wake_profile.h).
+Its MQTT telemetry carries it too: trmnl_weather/state is this wake's and
+trmnl_weather/wake has the phase timings of an earlier one. Requests and
+telemetry are grouped by that number, however the requests of a wake overlap
+with each other or with the telemetry, so one report line per wake gives the
+device's phase timings, awake time and the bytes the stand-ins served.
+
+  STANDIN_HOST=192.168.1.20 pio run -e trmnl_og_standin -t upload
+  tools/standin/standin.py --wakes 3 --max-awake-ms 9000 --out standin.json
+
+Exits 1 if a wake stayed awake longer than --max-awake-ms or, with
+--expect-resumed, made a full TLS handshake though it wasn't the first since
+power on or since the stand-ins started; 2 if --wakes wakes weren't reported
+within --timeout seconds.
+
+TLS session resumption (tls_session.h): the servers log every handshake as
+full or resumed, and count it towards the wake of the first request on its
+connection (a handshake that fails goes to the wake of the next request). The
+report puts that next to the station's own tls_full and tls_resumed counts. The station's 2 minute sleep is well within the 5
+minute session lifetime of OpenSSL, so every wake after the first should
+resume; --no-tickets turns session tickets off to exercise session IDs.
+
+Faults make a service misbehave, e.g. --fault owm=status:503@2 fails the first
+two OneCall requests, --fault air=stall never answers the Air Pollution
+requests. Services: owm, air, ha, image. Kinds:
+  delay:MS      answer after MS milliseconds
+  status:CODE   answer with an empty CODE response
+  stall         read the request and never answer
+  drop          read the request and close the connection
+  slow:BPS      send the body at BPS bytes per second
+Adding @N applies the fault to the first N requests only. Each request is
+reported with the time since the previous one to the same service ended, so
+with e.g.
+  --fault owm=status:503@1   the retry follows after the jittered backoff
+                             (250 to 750 ms, see request_scheduler.h)
+  --fault owm=stall          the attempts shrink to end by the wake deadline
+                             (WAKE_BUDGET - WAKE_RENDER_RESERVE, 22 s), and
+                             --max-awake-ms 30000 checks the wake still ends
+                             within WAKE_BUDGET
+
+Python standard library only; the certificates are made with openssl.
+"""
+
+import argparse
+import gzip
+import http.server
+import json
+import os
+import re
+import socket
+import socketserver
+import ssl
+import struct
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import urllib.parse
+import zlib
+
+ROOT = os.path.normpath(os.path.join(os.path.dirname(__file__), "..", ".."))
+FIXTURES = os.path.join(ROOT, "test", "fixtures")
+
+
+class Wakes:
+    """Requests and telemetry grouped by the station's wake number, shared by
+    all servers."""
+
+    def __init__(self):
+        self.lock = threading.Condition()
+        self.orphans = []       # failed TLS handshakes, for the next request
+        self.wakes = []         # one dict per wake, oldest first
+        self.complete = 0       # wakes whose profile has arrived
+
+    def _wake(self, number):
+        """The wake numbered number, a new one unless it is the latest. Wakes
+        don't overlap, and the numbers start over at power on. Call with the
+        lock held."""
+        if not self.wakes or (number is not None
+                              and self.wakes[-1]["number"] != number):
+            self.wakes.append({"wake": len(self.wakes), "number": number,
+                               "requests": [], "handshakes": [],
+                               "state": None, "profile": None})
+        wake = self.wakes[-1]
+        wake["handshakes"] += self.orphans
+        self.orphans = []
+        return wake
+
+    def request(self, number, entry, handshake=None):
+        """Adds a request of wake number (None if it wasn't sent) and the
+        handshake of its connection, if it is the first on it."""
+        with self.lock:
+            wake = self._wake(number)
+            wake["requests"].append(entry)
+            if handshake is not None:
+                wake["handshakes"].append(handshake)
+
+    def handshake_failed(self, entry):
+        with self.lock:
+            self.orphans.append(entry)
+
+    def mqtt_publish(self, topic, payload):
+        try:
+            value = json.loads(payload)
+        except ValueError:
+            return
+        if not isinstance(value, dict):
+            return
+        with self.lock:
+            if topic == "trmnl_weather/state":
+                self._wake(value.get("wake"))["state"] = value
+            elif topic == "trmnl_weather/wake":
+                # profile of an earlier wake, the latest with its number
+                for wake in reversed(self.wakes):
+                    if wake["number"] == value.get("wake"):
+                        if wake["profile"] is None:
+                            wake["profile"] = value
+                            self.complete += 1
+                            self.lock.notify_all()
+                        break
+
+    def wait(self, count, timeout):
+        deadline = time.monotonic() + timeout
+        with self.lock:
+            while self.complete < count:
+                left = deadline - time.monotonic()
+                if left <= 0:
+                    return False
+                self.lock.wait(left)
+            return True
+
+
+class Faults:
+    """--fault options by service, counted down per request."""
+
+    def __init__(self, specs):
+        self.lock = threading.Lock()
+        self.faults = {}
+        for spec in specs:
+            m = re.fullmatch(r"(owm|air|ha|image)=(delay|status|stall|drop|slow)"
+                             r"(?::(\d+))?(?:@(\d+))?", spec)
+            if not m:
+                sys.exit("bad --fault %r" % spec)
+            service, kind, arg, count = m.groups()
+            if kind in ("delay", "status", "slow") and arg is None:
+                sys.exit("--fault %s needs a value" % spec)
+            self.faults[service] = [kind, int(arg or 0),
+                                    int(count) if count else None]
+
+    def take(self, service):
+        """Returns (kind, arg) for the next request to service, or None."""
+        with self.lock:
+            fault = self.faults.get(service)
+            if fault is None or fault[2] == 0:
+                return None
+            if fault[2] is not None:
+                fault[2] -= 1
+            return fault[0], fault[1]
+
+
+class States(dict):
+    """Home Assistant states from --state, with defaults for the entities the
+    station reads."""
+
+    def get(self, entity, default="unknown"):
+        if entity in self:
+            return self[entity]
+        if "temperature" in entity:
+            return "21.5"
+        if "humidity" in entity:
+            return "48"
+        return default
+
+
+class Handler(http.server.BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"   # keep-alive, as the OWM requests use it
+    server_version = "standin"
+
+    def log_message(self, fmt, *args):
+        if self.server.verbose:
+            sys.stderr.write("%s %s\n" % (self.server.name, fmt % args))
+
+    def setup(self):
+        # the handshake counts towards the wake of the first request
+        self.handshake = None
+        if isinstance(self.request, ssl.SSLSocket):
+            start = time.monotonic()
+            entry = {"service": self.server.name, "at": time.time()}
+            try:
+                self.request.do_handshake()
+                entry["tls"] = ("resumed" if self.request.session_reused
+                                else "full")
+                self.handshake = entry
+            except (OSError, ssl.SSLError):
+                entry["tls"] = "failed"
+                self.server.wakes.handshake_failed(entry)
+                raise
+            finally:
+                entry["ms"] = round((time.monotonic() - start) * 1000)
+                if self.server.verbose:
+                    sys.stderr.write("%s tls %s %d ms\n" % (
+                        self.server.name, entry["tls"], entry["ms"]))
+        super().setup()
+
+    def send_body(self, service, code, body, content_type):
+        """Sends body (bytes), applying the service's fault, and records the
+        request."""
+        start = time.monotonic()
+        fault = self.server.faults.take(service)
+        kind, arg = fault if fault else (None, 0)
+        if kind == "delay":
+            time.sleep(arg / 1000)
+        elif kind == "status":
+            code, body = arg, b""
+        elif kind == "stall":
+            # until the station gives up and closes the connection
+            self.connection.settimeout(120)
+            try:
+                while self.connection.recv(1024):
+                    pass
+            except (OSError, socket.timeout):
+                pass
+            self.close_connection = True
+            self.record(service, start, "stall", 0)
+            return
+        elif kind == "drop":
+            self.close_connection = True
+            self.record(service, start, "drop", 0)
+            return
+
+        encoding = None
+        accept = self.headers.get("Accept-Encoding", "")
+        if body and "gzip" in accept and not self.server.no_gzip:
+            body = gzip.compress(body, 6)
+            encoding = "gzip"
+        self.send_response(code)
+        self.send_header("Content-Type", content_type)
+        self.send_header("Content-Length", str(len(body)))
+        if encoding:
+            self.send_header("Content-Encoding", encoding)
+        self.end_headers()
+        try:
+            if kind == "slow":
+                for i in range(0, len(body), max(1, arg // 10)):
+                    self.wfile.write(body[i:i + max(1, arg // 10)])
+                    self.wfile.flush()
+                    time.sleep(0.1)
+            else:
+                self.wfile.write(body)
+        except OSError:
+            self.close_connection = True
+        self.record(service, start, code, len(body))
+
+    def record(self, service, start, status, size):
+        elapsed = time.monotonic() - start
+        try:
+            number = int(self.headers.get("X-Wake"))
+        except (TypeError, ValueError):
+            number = None
+        self.server.wakes.request(number, {
+            "service": service, "path": self.path.split("?")[0],
+            "status": status, "bytes": size, "ms": round(elapsed * 1000),
+            "at": time.time() - elapsed}, self.handshake)
+        self.handshake = None
+
+    def unauthorized(self, service):
+        self.send_body(service, 401, b'{"message":"unauthorized"}',
+                       "application/json")
+
+
+class OwmHandler(Handler):
+    def do_GET(self):
+        url = urllib.parse.urlsplit(self.path)
+        query = urllib.parse.parse_qs(url.query)
+        if "appid" not in query:
+            return self.unauthorized("owm")
+        if url.path.endswith("/onecall"):
+            self.send_body("owm", 200, self.server.fixture("onecall"),
+                           "application/json; charset=utf-8")
+        elif url.path == "/data/2.5/air_pollution/history":
+            self.send_body("air", 200, self.server.fixture("air"),
+                           "application/json; charset=utf-8")
+        else:
+            self.send_body("owm", 404, b'{"cod":"404"}', "application/json")
+
+
+class HaHandler(Handler):
+    def authorized(self):
+        return self.headers.get("Authorization", "").startswith("Bearer ")
+
+    def state(self, entity):
+        return self.server.states.get(entity)
+
+    def do_POST(self):
+        length = int(self.headers.get("Content-Length", 0))
+        request = self.rfile.read(length)
+        if not self.authorized():
+            return self.unauthorized("ha")
+        if self.path != "/api/template":
+            return self.send_body("ha", 404, b"", "text/plain")
+        try:
+            template = json.loads(request)["template"]
+        except (ValueError, KeyError):
+            return self.send_body("ha", 400, b"", "text/plain")
+        # only the template getHomeAssistantStates() sends is understood
+        m = re.search(r"\{% for e in \[(.*?)\] %\}", template)
+        if not m:
+            return self.send_body("ha", 400, b"", "text/plain")
+        entities = re.findall(r"'([^']*)'", m.group(1))
+        # Home Assistant strips the rendered template
+        body = ";".join(self.state(e) for e in entities).strip()
+        self.send_body("ha", 200, body.encode(), "text/plain; charset=utf-8")
+
+    def do_GET(self):
+        if not self.authorized():
+            return self.unauthorized("ha")
+        m = re.fullmatch(r"/api/states/([\w.]+)", self.path)
+        if not m:
+            return self.send_body("ha", 404, b"", "text/plain")
+        body = json.dumps({"entity_id": m.group(1),
+                           "state": self.state(m.group(1))})
+        self.send_body("ha", 200, body.encode(), "application/json")
+
+
+class ImageHandler(Handler):
+    def do_GET(self):
+        if not self.headers.get("Authorization", "").startswith("Basic "):
+            return self.unauthorized("image")
+        if not (self.path.startswith("/remote.php/dav/")
+                and self.path.endswith(".png")):
+            return self.send_body("image", 404, b"", "text/plain")
+        self.send_body("image", 200, self.server.png, "image/png")
+
+
+class Server(socketserver.ThreadingMixIn, http.server.HTTPServer):
+    daemon_threads = True
+    allow_reuse_address = True
+
+    def __init__(self, name, port, handler, args, wakes, faults, tls=None):
+        super().__init__(("", port), handler)
+        self.name = name
+        self.verbose = args.verbose
+        self.no_gzip = args.no_gzip
+        self.wakes = wakes
+        self.faults = faults
+        self.args = args
+        if tls is not None:
+            # the handshake runs in the connection's thread, on first read
+            self.socket = tls.wrap_socket(self.socket, server_side=True,
+                                          do_handshake_on_connect=False)
+
+    def fixture(self, kind):
+        name = self.args.onecall if kind == "onecall" else self.args.air
+        with open(os.path.join(self.args.fixtures, name), "rb") as f:
+            return f.read()
+
+    def shutdown_request(self, request):
+        # OpenSSL drops a session from its cache if the connection ends
+        # without close_notify, and session IDs could not be resumed
+        if isinstance(request, ssl.SSLSocket):
+            try:
+                request.settimeout(1)
+                request.unwrap()
+            except (OSError, ValueError):
+                pass
+        super().shutdown_request(request)
+
+    def handle_error(self, request, client_address):
+        if self.verbose:
+            super().handle_error(request, client_address)
+
+
+class MqttHandler(socketserver.BaseRequestHandler):
+    """Just enough MQTT 3.1.1 for PubSubClient: CONNECT, PUBLISH (QoS 0/1),
+    SUBSCRIBE, PINGREQ and DISCONNECT."""
+
+    def read(self, n):
+        data = b""
+        while len(data) < n:
+            chunk = self.request.recv(n - len(data))
+            if not chunk:
+                raise EOFError
+            data += chunk
+        return data
+
+    def handle(self):
+        try:
+            while True:
+                header = self.read(1)[0]
+                length, shift = 0, 0
+                while True:
+                    byte = self.read(1)[0]
+                    length |= (byte & 0x7F) << shift
+                    shift += 7
+                    if not byte & 0x80:
+                        break
+                body = self.read(length)
+                kind = header >> 4
+                if kind == 1:       # CONNECT
+                    self.request.sendall(b"\x20\x02\x00\x00")
+                elif kind == 3:     # PUBLISH
+                    qos = (header >> 1) & 3
+                    size = struct.unpack(">H", body[:2])[0]
+                    topic = body[2:2 + size].decode()
+                    rest = body[2 + size:]
+                    if qos:
+                        self.request.sendall(b"\x40\x02" + rest[:2])
+                        rest = rest[2:]
+                    if self.server.verbose:
+                        sys.stderr.write("mqtt %s %s\n" % (topic, rest[:200]))
+                    self.server.wakes.mqtt_publish(topic, rest.decode())
+                elif kind == 8:     # SUBSCRIBE
+                    self.request.sendall(b"\x90\x03" + body[:2] + b"\x00")
+                elif kind == 12:    # PINGREQ
+                    self.request.sendall(b"\xd0\x00")
+                elif kind == 14:    # DISCONNECT
+                    return
+        except (EOFError, OSError):
+            pass
+
+
+class MqttServer(socketserver.ThreadingTCPServer):
+    daemon_threads = True
+    allow_reuse_address = True
+
+
+def make_cert(directory):
+    """Self-signed certificate, as the station doesn't verify it."""
+    cert = os.path.join(directory, "cert.pem")
+    key = os.path.join(directory, "key.pem")
+    subprocess.run(["openssl", "req", "-x509", "-newkey", "rsa:2048",
+                    "-nodes", "-days", "30", "-subj", "/CN=standin",
+                    "-keyout", key, "-out", cert],
+                   check=True, stdout=subprocess.DEVNULL,
+                   stderr=subprocess.DEVNULL)
+    return cert, key
+
+
+def make_tls(cert, key, tickets):
+    tls = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    tls.load_cert_chain(cert, key)
+    if not tickets:
+        tls.options |= ssl.OP_NO_TICKET
+    return tls
+
+
+def make_png(width=800, height=480):
+    """8-bit greyscale test card: diagonal bands and a frame."""
+    rows = bytearray()
+    for y in range(height):
+        rows.append(0)      # filter: none
+        for x in range(width):
+            edge = x < 8 or y < 8 or x >= width - 8 or y >= height - 8
+            rows.append(0 if edge or ((x + y) // 40) % 2 else 255)
+
+    def chunk(kind, data):
+        return (struct.pack(">I", len(data)) + kind + data
+                + struct.pack(">I", zlib.crc32(kind + data) & 0xFFFFFFFF))
+
+    return (b"\x89PNG\r\n\x1a\n"
+            + chunk(b"IHDR", struct.pack(">IIBBBBB", width, height, 8, 0, 0,
+                                         0, 0))
+            + chunk(b"IDAT", zlib.compress(bytes(rows), 9))
+            + chunk(b"IEND", b""))
+
+
+def annotate(wake, previous):
+    """Adds to each request of wake the ms since the previous request to the
+    same service ended, and to wake the station's handshakes since the
+    previous wake (its counts run from power on)."""
+    ended = {}
+    for r in wake["requests"]:
+        if r["service"] in ended:
+            r["after_ms"] = round((r["at"] - ended[r["service"]]) * 1000)
+        ended[r["service"]] = r["at"] + r["ms"] / 1000
+    state = wake["state"] or {}
+    if "tls_full" not in state or wake["number"] is None:
+        return
+    if wake["number"] == 1:
+        before = {}
+    elif (previous and previous["number"] == wake["number"] - 1
+          and previous["state"]):
+        before = previous["state"]
+    else:
+        return  # a wake is missing, its handshakes can't be told apart
+    wake["tls_device"] = {
+        k: state.get("tls_" + k, 0) - before.get("tls_" + k, 0)
+        for k in ("full", "resumed", "failed")}
+
+
+def report(wakes, args):
+    """Prints one line per wake whose profile arrived, writes them to --out
+    and returns the exit status of the gates."""
+    status = 0
+    out = open(args.out, "w") if args.out else None
+    with wakes.lock:
+        for i, w in enumerate(wakes.wakes):
+            annotate(w, wakes.wakes[i - 1] if i else None)
+        done = [w for w in wakes.wakes if w["profile"] is not None]
+    for w in done:
+        profile = w["profile"]
+        served = sum(r["bytes"] for r in w["requests"])
+        phases = " ".join("%s=%d" % (k[:-3], v) for k, v in profile.items()
+                          if k.endswith("_ms") and k != "awake_ms" and v)
+        line = "wake %d (#%s): awake %d ms, %d requests, %d bytes; %s" % (
+            w["wake"], w["number"], profile.get("awake_ms", 0),
+            len(w["requests"]), served, phases)
+        awake = profile.get("awake_ms", 0)
+        if args.max_awake_ms and awake > args.max_awake_ms:
+            line += "  OVER %d ms" % args.max_awake_ms
+            status = 1
+        print(line)
+
+        tls = " ".join("%s %s %d ms" % (h["service"], h["tls"], h["ms"])
+                       for h in w["handshakes"])
+        device = w.get("tls_device")
+        if device:
+            tls += "; station: %d full, %d resumed, %d failed" % (
+                device["full"], device["resumed"], device["failed"])
+        full = sum(h["tls"] != "resumed" for h in w["handshakes"])
+        first = w["wake"] == 0 or w["number"] == 1
+        if args.expect_resumed and not first and full:
+            tls += "  NOT RESUMED"
+            status = 1
+        if tls:
+            print("    tls: " + tls)
+        for r in w["requests"]:
+            after = ("+%d ms" % r["after_ms"]) if "after_ms" in r else ""
+            print("    %-5s %-34s %-5s %7d B %6d ms %s" % (
+                r["service"], r["path"], r["status"], r["bytes"], r["ms"],
+                after))
+        if out:
+            out.write(json.dumps({
+                "wake": w["wake"], "number": w["number"],
+                "awake_ms": awake, "bytes": served,
+                "requests": w["requests"], "handshakes": w["handshakes"],
+                "tls_device": device, "profile": profile,
+                "state": w["state"]}) + "\n")
+    if out:
+        out.close()
+    return status
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__.split("\n\n")[0],
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--owm-port", type=int, default=8443)
+    parser.add_argument("--ha-port", type=int, default=8123)
+    parser.add_argument("--image-port", type=int, default=8444)
+    parser.add_argument("--mqtt-port", type=int, default=1883)
+    parser.add_argument("--fixtures", default=FIXTURES)
+    parser.add_argument("--onecall", default="onecall_48h.json",
+                        help="OneCall body in --fixtures")
+    parser.add_argument("--air", default="air_pollution_24h.json",
+                        help="Air Pollution body in --fixtures")
+    parser.add_argument("--state", action="append", default=[],
+                        metavar="ENTITY=VALUE", help="Home Assistant state, "
+                        "default 21.5 for *temperature*, 48 for *humidity*")
+    parser.add_argument("--fault", action="append", default=[],
+                        metavar="SERVICE=KIND[:ARG][@N]")
+    parser.add_argument("--no-gzip", action="store_true",
+                        help="ignore Accept-Encoding")
+    parser.add_argument("--no-tickets", action="store_true",
+                        help="resume TLS sessions by session ID only")
+    parser.add_argument("--expect-resumed", action="store_true",
+                        help="fail if a wake after the first made a full "
+                        "TLS handshake")
+    parser.add_argument("--wakes", type=int, default=0,
+                        help="report after this many wakes and exit")
+    parser.add_argument("--timeout", type=int, default=1800,
+                        help="seconds to wait for --wakes")
+    parser.add_argument("--max-awake-ms", type=int, default=0)
+    parser.add_argument("--out", help="JSON line per wake")
+    parser.add_argument("-v", "--verbose", action="store_true")
+    args = parser.parse_args()
+
+    wakes = Wakes()
+    faults = Faults(args.fault)
+    cert_dir = tempfile.mkdtemp(prefix="standin-")
+    cert, key = make_cert(cert_dir)
+
+    owm = Server("owm", args.owm_port, OwmHandler, args, wakes, faults,
+                 make_tls(cert, key, not args.no_tickets))
+    ha = Server("ha", args.ha_port, HaHandler, args, wakes, faults)
+    ha.states = States(s.split("=", 1) for s in args.state)
+    image = Server("image", args.image_port, ImageHandler, args, wakes, faults,
+                   make_tls(cert, key, not args.no_tickets))
+    image.png = make_png()
+    mqtt = MqttServer(("", args.mqtt_port), MqttHandler)
+    mqtt.wakes = wakes
+    mqtt.verbose = args.verbose
+    for server in (owm, ha, image, mqtt):
+        threading.Thread(target=server.serve_forever, daemon=True).start()
+    print("stand-ins up: owm https :%d, ha http :%d, nextcloud https :%d, "
+          "mqtt :%d" % (args.owm_port, args.ha_port, args.image_port,
+                        args.mqtt_port))
+
+    try:
+        if args.wakes:
+            if not wakes.wait(args.wakes, args.timeout):
+                print("only %d of %d wakes reported within %d s"
+                      % (wakes.complete, args.wakes, args.timeout))
+                report(wakes, args)
+                return 2
+        else:
+            while True:
+                time.sleep(3600)
+    except KeyboardInterrupt:
+        pass
+    return report(wakes, args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())